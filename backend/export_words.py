@@ -0,0 +1,39 @@
+# export_words.py - Dump the words table for the C++ server's word dictionary
+#
+#   python export_words.py words.tsv
+#   cpp-server --build-words words.tsv words.dict
+import sqlite3
+import os
+import sys
+
+db_path = "game.db"
+out_path = sys.argv[1] if len(sys.argv) > 1 else "words.tsv"
+
+if not os.path.exists(db_path):
+    print("❌ Database not found. Please run your backend first to create it.")
+    exit(1)
+
+conn = sqlite3.connect(db_path)
+cursor = conn.cursor()
+
+def export_words():
+    cursor.execute("SELECT COALESCE(theme, 'random'), word FROM words ORDER BY theme, word")
+    rows = cursor.fetchall()
+
+    with open(out_path, "w", encoding="utf-8") as f:
+        f.write("# theme<TAB>word\n")
+        for theme, word in rows:
+            # Tabs and newlines would break the line format
+            word = " ".join(word.split())
+            if word:
+                f.write(f"{theme}\t{word}\n")
+
+    print(f"✅ Exported {len(rows)} words to {out_path}")
+
+if __name__ == "__main__":
+    try:
+        export_words()
+    except Exception as e:
+        print(f"❌ Error exporting words: {e}")
+    finally:
+        conn.close()
@@ -0,0 +1,80 @@
+"""Stand-in for POST /scores/batch, for testing the game server's result
+writer without the database. Keeps connections alive like the real backend
+and can fail or stall on purpose.
+
+    python results_stub.py --port 8000 --fail-rate 0.2 --delay-ms 50
+
+Point the "PERSIST" block of the game server's config.json at it.
+"""
+import argparse
+import json
+import random
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+totals = {"requests": 0, "scores": 0, "history": 0, "failed": 0}
+lock = threading.Lock()
+
+
+def make_handler(args):
+    class Handler(BaseHTTPRequestHandler):
+        protocol_version = "HTTP/1.1"  # keep-alive
+        disable_nagle_algorithm = True  # headers and body go out as separate writes
+
+        def do_POST(self):
+            body = self.rfile.read(int(self.headers.get("Content-Length", 0)))
+            if args.delay_ms:
+                time.sleep(args.delay_ms / 1000)
+            if random.random() < args.fail_rate:
+                with lock:
+                    totals["failed"] += 1
+                return self.reply(503, {"detail": "stub failure"})
+
+            batch = json.loads(body)
+            with lock:
+                totals["requests"] += 1
+                totals["scores"] += len(batch.get("scores", []))
+                totals["history"] += len(batch.get("history", []))
+            if args.verbose:
+                print(json.dumps(batch))
+            received = len(batch.get("scores", [])) + len(batch.get("history", []))
+            self.reply(200, {"received": received, "saved": received, "skipped": 0})
+
+        def reply(self, status, payload):
+            data = json.dumps(payload).encode()
+            self.send_response(status)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(data)))
+            self.end_headers()
+            self.wfile.write(data)
+
+        def log_message(self, *_):
+            pass
+
+    return Handler
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=8000)
+    parser.add_argument("--fail-rate", type=float, default=0.0, help="share of requests answered 503")
+    parser.add_argument("--delay-ms", type=int, default=0, help="stall before answering")
+    parser.add_argument("--verbose", action="store_true", help="print every batch")
+    args = parser.parse_args()
+
+    server = ThreadingHTTPServer(("127.0.0.1", args.port), make_handler(args))
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    print(f"Results stub on 127.0.0.1:{args.port}")
+    try:
+        while True:
+            time.sleep(5)
+            with lock:
+                print(f"requests={totals['requests']} scores={totals['scores']} "
+                      f"history={totals['history']} failed={totals['failed']}")
+    except KeyboardInterrupt:
+        server.shutdown()
+
+
+if __name__ == "__main__":
+    main()
@@ -1,9 +1,14 @@
-from fastapi import APIRouter, Depends
+import os
+from typing import Optional
+from fastapi import APIRouter, Depends, Header, HTTPException
+from sqlalchemy import func
 from sqlalchemy.orm import Session
 from db import get_db
 from models.score import Score
 from models.user import User
-from schemas.score import ScoreCreate, ScoreResponse
+from models.word import Word
+from models.history import History
+from schemas.score import ScoreCreate, ScoreResponse, ResultBatch
 
 router = APIRouter(prefix="/scores", tags=["scores"])
 
@@ -15,6 +20,42 @@ def save_score(score: ScoreCreate, db: Session = Depends(get_db)):
     db.refresh(new_score)
     return new_score
 
+@router.post("/batch")
+def save_results(batch: ResultBatch, db: Session = Depends(get_db),
+                 x_guessio_key: Optional[str] = Header(default=None)):
+    """Scores and guess history written behind by the game server"""
+    key = os.environ.get("GAME_SERVER_KEY")
+    if key and x_guessio_key != key:
+        raise HTTPException(401, "Bad game server key")
+
+    # One lookup per batch; chatters without an account are skipped
+    names = {r.username.lower() for r in batch.scores} | {r.username.lower() for r in batch.history}
+    users = {}
+    if names:
+        for user_id, username in db.query(User.id, User.username).filter(func.lower(User.username).in_(names)):
+            users[username.lower()] = user_id
+    words = {}
+    guessed = {r.word.lower() for r in batch.history}
+    if guessed:
+        for word_id, word in db.query(Word.id, Word.word).filter(func.lower(Word.word).in_(guessed)):
+            words[word.lower()] = word_id
+
+    rows = []
+    for r in batch.scores:
+        user_id = users.get(r.username.lower())
+        if user_id is not None:
+            rows.append(Score(user_id=user_id, score=r.score))
+    for r in batch.history:
+        user_id = users.get(r.username.lower())
+        word_id = words.get(r.word.lower())
+        if user_id is not None and word_id is not None:
+            rows.append(History(user_id=user_id, word_id=word_id, correct=r.correct))
+
+    db.add_all(rows)
+    db.commit()
+    received = len(batch.scores) + len(batch.history)
+    return {"received": received, "saved": len(rows), "skipped": received - len(rows)}
+
 @router.get("/leaderboard")
 def leaderboard(limit: int = 10, db: Session = Depends(get_db)):
     results = (
@@ -1,4 +1,5 @@
 from pydantic import BaseModel
+from typing import List
 
 class ScoreCreate(BaseModel):
     user_id: int
@@ -8,3 +9,19 @@ class ScoreResponse(ScoreCreate):
     id: int
     class Config:
         from_attributes = True
+
+# Batches written by the game server, which knows usernames and words rather than ids
+class ScoreRecord(BaseModel):
+    username: str
+    room: str = ""
+    score: int
+
+class GuessRecord(BaseModel):
+    username: str
+    room: str = ""
+    word: str
+    correct: bool
+
+class ResultBatch(BaseModel):
+    scores: List[ScoreRecord] = []
+    history: List[GuessRecord] = []
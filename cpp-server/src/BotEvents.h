@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <string>
+
+// Typed events from Twitch bot connections to rooms. They are posted straight
+// to the target room's executor instead of being dumped to JSON and parsed
+// back by RoomManager::onMessage.
+
+struct ChatEvent {
+    std::string room;
+    std::string username; // empty for aggregated summaries
+    std::string text;
+    uint32_t count = 1;   // >1 when identical messages were collapsed
+};
+
+struct JoinEvent {
+    std::string room;
+    std::string username;
+};
+
+struct GuessEvent {
+    std::string room;
+    std::string username;
+    std::string guess;
+};
@@ -0,0 +1,60 @@
+#include "ChannelRouter.h"
+#include "TwitchClient.h"
+
+ChannelRouter::ChannelRouter()
+    : m_table(std::make_shared<const Table>()) {}
+
+template <class F>
+void ChannelRouter::update(F&& change) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    auto next = std::make_shared<Table>(*m_table.load(std::memory_order_relaxed));
+    change(*next);
+    m_table.store(std::move(next), std::memory_order_release);
+}
+
+ChannelRoute ChannelRouter::find(std::string_view channel) const {
+    Snapshot table = snapshot();
+    auto it = table->channels.find(channel);
+    return it == table->channels.end() ? ChannelRoute() : it->second;
+}
+
+void ChannelRouter::setConnection(const std::string& channel, std::shared_ptr<TwitchClient> connection) {
+    update([&](Table& table) {
+        if (connection) {
+            table.channels[channel].connection = std::move(connection);
+            return;
+        }
+        auto it = table.channels.find(channel);
+        if (it == table.channels.end()) return;
+        it->second.connection.reset();
+        // Keep the room claim so a restarted bot routes to it straight away
+        if (it->second.room.empty()) table.channels.erase(it);
+    });
+}
+
+void ChannelRouter::setRoom(const std::string& channel, const std::string& room) {
+    update([&](Table& table) {
+        ChannelRoute& route = table.channels[channel];
+        if (!route.room.empty()) table.roomChannels.erase(route.room);
+        route.room = room;
+        if (!room.empty()) table.roomChannels[room] = channel;
+    });
+}
+
+void ChannelRouter::removeRoom(const std::string& room) {
+    // Rooms come and go without a bot; skip the copy when nothing changes
+    {
+        Snapshot table = snapshot();
+        if (table->roomChannels.find(room) == table->roomChannels.end()) return;
+    }
+    update([&](Table& table) {
+        auto owner = table.roomChannels.find(room);
+        if (owner == table.roomChannels.end()) return;
+        auto it = table.channels.find(owner->second);
+        if (it != table.channels.end()) {
+            it->second.room.clear();
+            if (!it->second.connection) table.channels.erase(it);
+        }
+        table.roomChannels.erase(owner);
+    });
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "StringHash.h"
+
+class TwitchClient; // forward declare
+
+// Where a Twitch channel's chat goes: the room its streamer opened and the
+// bot connection that has JOINed it.
+struct ChannelRoute {
+    std::string room;                         // empty until a room claims the channel
+    std::shared_ptr<TwitchClient> connection; // null when no bot is in the channel
+};
+
+// Channel ("#name") -> route table, read on every chat line and changed only
+// when bots start/stop, connections rebalance or rooms open/close.
+//
+// Readers load an immutable snapshot without locking and keep using it for
+// as long as they hold the pointer, so a line is routed against one
+// consistent version. Writers copy the current table under a mutex, change
+// the copy and publish it; the old version is freed when its last reader
+// lets go.
+class ChannelRouter {
+public:
+    using Routes = std::unordered_map<std::string, ChannelRoute, StringHash, std::equal_to<>>;
+
+    struct Table {
+        Routes channels;
+        std::unordered_map<std::string, std::string> roomChannels; // room -> channel
+    };
+    using Snapshot = std::shared_ptr<const Table>;
+
+    ChannelRouter();
+
+    Snapshot snapshot() const { return m_table.load(std::memory_order_acquire); }
+
+    // Copy of one route, empty route if the channel is unknown
+    ChannelRoute find(std::string_view channel) const;
+
+    // Bot connection now carrying `channel`; null drops the bot
+    void setConnection(const std::string& channel, std::shared_ptr<TwitchClient> connection);
+    // `room` becomes the active room for `channel`
+    void setRoom(const std::string& channel, const std::string& room);
+    // `room` is gone; its channel falls back to no tracked room
+    void removeRoom(const std::string& room);
+
+private:
+    template <class F>
+    void update(F&& change);
+
+    std::mutex m_writeMutex;
+    std::atomic<Snapshot> m_table;
+};
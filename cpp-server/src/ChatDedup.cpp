@@ -0,0 +1,88 @@
+#include "ChatDedup.h"
+#include <algorithm>
+#include <cstring>
+
+ChatDedup::ChatDedup() : ChatDedup(Config()) {}
+
+ChatDedup::ChatDedup(const Config& cfg)
+    : m_config(cfg),
+    m_windowStart(Clock::now()) {
+    size_t width = 1;
+    while (width < m_config.sketchWidth) width <<= 1;
+    m_config.sketchWidth = width;
+    m_config.sketchDepth = std::max<size_t>(m_config.sketchDepth, 1);
+    m_config.slots = std::max<size_t>(m_config.slots, kProbe);
+
+    m_sketch.assign(m_config.sketchWidth * m_config.sketchDepth, 0);
+    m_slots.resize(m_config.slots);
+}
+
+uint64_t ChatDedup::hashKey(std::string_view key) {
+    // FNV-1a with a final mix; never returns 0 so 0 can mark empty slots
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : key) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h ? h : 1;
+}
+
+uint32_t ChatDedup::sketchAdd(uint64_t hash) {
+    uint32_t estimate = UINT32_MAX;
+    uint64_t h = hash;
+    for (size_t row = 0; row < m_config.sketchDepth; ++row) {
+        // Derive one index per row from the same hash
+        h = h * 0x9e3779b97f4a7c15ull + row;
+        size_t idx = row * m_config.sketchWidth + ((h >> 17) & (m_config.sketchWidth - 1));
+        uint32_t& counter = m_sketch[idx];
+        if (counter != UINT32_MAX) ++counter;
+        estimate = std::min(estimate, counter);
+    }
+    return estimate;
+}
+
+void ChatDedup::decaySketch() {
+    // Halving keeps a few windows of history without ever growing
+    for (auto& counter : m_sketch) counter >>= 1;
+}
+
+ChatDedup::Verdict ChatDedup::offer(std::string_view key, std::string_view text) {
+    if (key.empty()) return Verdict::Forward;
+
+    uint64_t hash = hashKey(key);
+    uint32_t heat = sketchAdd(hash);
+
+    size_t slotCount = m_slots.size();
+    size_t start = hash % slotCount;
+    Slot* free = nullptr;
+    for (size_t i = 0; i < kProbe; ++i) {
+        Slot& slot = m_slots[(start + i) % slotCount];
+        if (slot.hash == hash) {
+            ++slot.count;
+            ++m_suppressed;
+            return Verdict::Suppress;
+        }
+        if (slot.hash == 0 && !free) free = &slot;
+    }
+
+    // Table full around this hash: forward rather than lose the message
+    if (!free) return Verdict::Forward;
+
+    free->hash = hash;
+    free->count = 1;
+    size_t length = std::min(text.size(), kMaxText);
+    // Don't cut a UTF-8 sequence in half
+    while (length < text.size() && length > 0 && (static_cast<unsigned char>(text[length]) & 0xC0) == 0x80) --length;
+    free->length = static_cast<uint8_t>(length);
+    std::memcpy(free->text.data(), text.data(), free->length);
+    free->spam = heat >= m_config.spamThreshold;
+
+    if (free->spam) {
+        ++m_suppressed;
+        return Verdict::Suppress;
+    }
+    return Verdict::Forward;
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Collapses repeated chat in one channel before it is fanned out to a room.
+//
+// A small fixed table holds the messages seen in the current window; a
+// repeat only bumps its counter and is suppressed, and when the window
+// closes every repeated message is reported once as "text xN". A count-min
+// sketch, halved every window, remembers how hot a message has been across
+// recent windows so copy-paste spam is suppressed even on its first copy.
+// Memory is fixed at construction whatever the chat volume.
+class ChatDedup {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    struct Config {
+        std::chrono::milliseconds window{ 2000 };
+        size_t sketchWidth = 2048;   // counters per row, power of two
+        size_t sketchDepth = 4;
+        size_t slots = 256;          // distinct messages tracked per window
+        uint32_t spamThreshold = 50; // sketch estimate that marks spam
+    };
+
+    enum class Verdict : uint8_t {
+        Forward,  // first copy, send it on
+        Suppress  // repeat or spam, it will show up in a summary
+    };
+
+    ChatDedup();
+    explicit ChatDedup(const Config& cfg);
+
+    // `key` is the normalised text used for matching, `text` what users see.
+    // Call flush() first so the message lands in the right window.
+    Verdict offer(std::string_view key, std::string_view text);
+
+    // Reports repeated messages from a finished window as f(text, count)
+    template <class F>
+    void flush(Clock::time_point now, F&& emit);
+
+    uint64_t suppressed() const { return m_suppressed; }
+
+private:
+    static constexpr size_t kMaxText = 200;
+    static constexpr size_t kProbe = 8;
+
+    struct Slot {
+        uint64_t hash = 0;       // 0 = empty
+        uint32_t count = 0;
+        bool spam = false;
+        uint8_t length = 0;
+        std::array<char, kMaxText> text{};
+    };
+
+    static uint64_t hashKey(std::string_view key);
+    uint32_t sketchAdd(uint64_t hash);
+    void decaySketch();
+
+    Config m_config;
+    std::vector<uint32_t> m_sketch; // depth rows of width counters
+    std::vector<Slot> m_slots;
+    Clock::time_point m_windowStart;
+    uint64_t m_suppressed = 0;
+};
+
+template <class F>
+void ChatDedup::flush(Clock::time_point now, F&& emit) {
+    if (now - m_windowStart < m_config.window) return;
+    m_windowStart = now;
+
+    for (auto& slot : m_slots) {
+        if (slot.hash == 0) continue;
+        // A message that was forwarded and never repeated needs no summary
+        if (slot.count > 1 || slot.spam) {
+            emit(std::string_view(slot.text.data(), slot.length), slot.count);
+        }
+        slot.hash = 0;
+        slot.count = 0;
+        slot.spam = false;
+    }
+    decaySketch();
+}
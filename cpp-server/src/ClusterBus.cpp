@@ -0,0 +1,322 @@
+#include "ClusterBus.h"
+#include <algorithm>
+#include <deque>
+#include <iostream>
+
+using boost::asio::ip::tcp;
+
+namespace {
+constexpr size_t kFrameHeader = 4 + 1 + 8;
+constexpr uint32_t kMaxFrame = 256 * 1024 * 1024; // anything longer is a broken link
+constexpr std::chrono::milliseconds kReconnectDelay{ 500 };
+
+uint64_t fnv1a(std::string_view bytes) {
+    uint64_t h = 1469598103934665603ull;
+    for (unsigned char c : bytes) {
+        h ^= c;
+        h *= 1099511628211ull;
+    }
+    // FNV alone clusters similar ids; finish with the splitmix64 mixer
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ull;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebull;
+    return h ^ (h >> 31);
+}
+
+void putLE(char* p, uint64_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) p[i] = static_cast<char>(v >> (8 * i));
+}
+
+uint64_t getLE(const char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | static_cast<unsigned char>(p[i]);
+    return v;
+}
+
+std::string frame(ClusterBus::Frame type, uint64_t client, std::string_view body) {
+    std::string out(kFrameHeader, '\0');
+    putLE(out.data(), 1 + 8 + body.size(), 4);
+    out[4] = static_cast<char>(type);
+    putLE(out.data() + 5, client, 8);
+    out += body;
+    return out;
+}
+}
+
+ClusterConfig ClusterConfig::fromJson(const nlohmann::json& j) {
+    ClusterConfig cfg;
+    cfg.enabled = j.value("enabled", cfg.enabled);
+    cfg.virtualNodes = std::max<size_t>(j.value("virtual_nodes", cfg.virtualNodes), 1);
+    cfg.maxQueued = std::max<size_t>(j.value("max_queued_mb", cfg.maxQueued >> 20), 1) << 20;
+    for (const auto& n : j.value("nodes", nlohmann::json::array())) {
+        ClusterNodeConfig node;
+        node.id = n.value("id", "");
+        node.host = n.value("host", node.host);
+        node.wsPort = n.value("ws_port", node.wsPort);
+        node.busPort = n.value("bus_port", node.busPort);
+        if (!node.id.empty()) cfg.nodes.push_back(std::move(node));
+    }
+    return cfg;
+}
+
+size_t ClusterConfig::indexOf(const std::string& id) const {
+    for (size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].id == id) return i;
+    }
+    return nodes.size();
+}
+
+HashRing::HashRing(const std::vector<ClusterNodeConfig>& nodes, size_t virtualNodes) {
+    m_points.reserve(nodes.size() * virtualNodes);
+    for (uint32_t n = 0; n < nodes.size(); ++n) {
+        for (size_t v = 0; v < virtualNodes; ++v)
+            m_points.emplace_back(fnv1a(nodes[n].id + "#" + std::to_string(v)), n);
+    }
+    std::sort(m_points.begin(), m_points.end());
+}
+
+size_t HashRing::owner(std::string_view key) const {
+    if (m_points.empty()) return 0;
+    auto it = std::lower_bound(m_points.begin(), m_points.end(), std::make_pair(fnv1a(key), uint32_t(0)));
+    return it == m_points.end() ? m_points.front().second : it->second;
+}
+
+// Outgoing link to one node; everything runs on its strand
+class ClusterBus::Peer : public std::enable_shared_from_this<Peer> {
+public:
+    Peer(boost::asio::io_context& io, const ClusterNodeConfig& node, size_t self, size_t maxQueued)
+        : m_strand(boost::asio::make_strand(io)), m_socket(m_strand), m_resolver(m_strand), m_timer(m_strand),
+        m_node(node), m_self(self), m_maxQueued(maxQueued) {}
+
+    void start() {
+        boost::asio::post(m_strand, [self = shared_from_this()]() { self->connect(); });
+    }
+
+    void stop() {
+        boost::asio::post(m_strand, [self = shared_from_this()]() {
+            self->m_stopped = true;
+            boost::system::error_code ignored;
+            self->m_timer.cancel();
+            self->m_socket.close(ignored);
+        });
+    }
+
+    void send(std::string bytes) {
+        boost::asio::post(m_strand, [self = shared_from_this(), bytes = std::move(bytes)]() mutable {
+            if (self->m_queuedBytes + bytes.size() > self->m_maxQueued) {
+                if (self->m_dropped++ % 1000 == 0)
+                    std::cerr << "[CLUSTER] Link to " << self->m_node.id << " is backed up, dropping frames\n";
+                return;
+            }
+            self->m_queuedBytes += bytes.size();
+            self->m_queue.push_back(std::move(bytes));
+            if (self->m_connected && !self->m_writing) self->doWrite();
+        });
+    }
+
+private:
+    void connect() {
+        if (m_stopped) return;
+        m_resolver.async_resolve(m_node.host, std::to_string(m_node.busPort),
+            [self = shared_from_this()](boost::system::error_code ec, tcp::resolver::results_type results) {
+                if (ec) {
+                    self->retry();
+                    return;
+                }
+                boost::asio::async_connect(self->m_socket, results,
+                    [self](boost::system::error_code ec, const tcp::endpoint&) {
+                        if (ec) {
+                            self->retry();
+                            return;
+                        }
+                        self->m_socket.set_option(tcp::no_delay(true), ec);
+                        std::cout << "[CLUSTER] Connected to node " << self->m_node.id << "\n";
+                        self->m_connected = true;
+                        ++self->m_link;
+                        // Hello goes ahead of whatever queued up meanwhile
+                        std::string hello = frame(Frame::Hello, self->m_self, {});
+                        self->m_queuedBytes += hello.size();
+                        self->m_queue.push_front(std::move(hello));
+                        self->watch();
+                        self->doWrite();
+                    });
+            });
+    }
+
+    // Nothing is ever sent back on this link, so a read completing means
+    // it closed; otherwise only the next write would notice
+    void watch() {
+        m_socket.async_read_some(boost::asio::buffer(m_probe),
+            [self = shared_from_this(), link = m_link](boost::system::error_code ec, std::size_t) {
+                if (link == self->m_link) self->linkDown(ec ? ec : boost::asio::error::eof);
+            });
+    }
+
+    void linkDown(boost::system::error_code ec) {
+        if (!m_connected) return;
+        if (!m_stopped) std::cerr << "[CLUSTER] Lost link to node " << m_node.id << ": " << ec.message() << "\n";
+        ++m_link;
+        retry();
+    }
+
+    void retry() {
+        boost::system::error_code ignored;
+        m_socket.close(ignored);
+        m_connected = false;
+        m_writing = false;
+        if (m_stopped) return;
+        m_timer.expires_after(kReconnectDelay);
+        m_timer.async_wait([self = shared_from_this()](boost::system::error_code ec) {
+            if (!ec) self->connect();
+        });
+    }
+
+    void doWrite() {
+        if (m_queue.empty()) {
+            m_writing = false;
+            return;
+        }
+        m_writing = true;
+        boost::asio::async_write(m_socket, boost::asio::buffer(m_queue.front()),
+            [self = shared_from_this(), link = m_link](boost::system::error_code ec, std::size_t) {
+                if (link != self->m_link) return; // written on a link that is already gone
+                if (ec) {
+                    // The frame stays queued and goes out whole on the next link
+                    self->linkDown(ec);
+                    return;
+                }
+                self->m_queuedBytes -= self->m_queue.front().size();
+                self->m_queue.pop_front();
+                self->doWrite();
+            });
+    }
+
+    boost::asio::strand<boost::asio::io_context::executor_type> m_strand;
+    tcp::socket m_socket;
+    tcp::resolver m_resolver;
+    boost::asio::steady_timer m_timer;
+    ClusterNodeConfig m_node;
+    size_t m_self;
+    size_t m_maxQueued;
+    std::deque<std::string> m_queue;
+    size_t m_queuedBytes = 0;
+    uint64_t m_dropped = 0;
+    uint64_t m_link = 0; // bumped whenever a link comes up or goes down
+    char m_probe[1];
+    bool m_connected = false;
+    bool m_writing = false;
+    bool m_stopped = false;
+};
+
+// Link another node opened to us; read only
+class ClusterBus::Inbound : public std::enable_shared_from_this<Inbound> {
+public:
+    Inbound(tcp::socket socket, const Handlers& handlers, size_t nodes)
+        : m_socket(std::move(socket)), m_handlers(handlers), m_nodes(nodes) {}
+
+    void start() { readHeader(); }
+
+private:
+    void readHeader() {
+        boost::asio::async_read(m_socket, boost::asio::buffer(m_header),
+            [self = shared_from_this()](boost::system::error_code ec, std::size_t) {
+                if (ec) return self->lost();
+                uint32_t length = static_cast<uint32_t>(getLE(self->m_header, 4));
+                if (length < 9 || length > kMaxFrame) return self->lost();
+                self->m_body.resize(length - 9);
+                self->readBody();
+            });
+    }
+
+    void readBody() {
+        boost::asio::async_read(m_socket, boost::asio::buffer(m_body),
+            [self = shared_from_this()](boost::system::error_code ec, std::size_t) {
+                if (ec) return self->lost();
+                auto type = static_cast<Frame>(self->m_header[4]);
+                uint64_t client = getLE(self->m_header + 5, 8);
+                if (type == Frame::Hello) {
+                    if (client >= self->m_nodes) return self->lost();
+                    self->m_from = client;
+                }
+                else if (self->m_from == kUnknown) {
+                    return self->lost(); // must say who it is first
+                }
+                else {
+                    self->m_handlers.onFrame(self->m_from, type, client, self->m_body);
+                }
+                self->readHeader();
+            });
+    }
+
+    void lost() {
+        boost::system::error_code ignored;
+        m_socket.close(ignored);
+        if (m_from != kUnknown && m_handlers.onPeerLost) m_handlers.onPeerLost(m_from);
+    }
+
+    static constexpr size_t kUnknown = SIZE_MAX;
+    tcp::socket m_socket;
+    const Handlers& m_handlers;
+    size_t m_nodes;
+    size_t m_from = kUnknown;
+    char m_header[kFrameHeader];
+    std::string m_body;
+};
+
+ClusterBus::ClusterBus(boost::asio::io_context& io, const ClusterConfig& cfg, size_t self, Handlers handlers)
+    : m_io(io), m_config(cfg), m_self(self), m_handlers(std::move(handlers)), m_acceptor(io) {
+    for (size_t i = 0; i < m_config.nodes.size(); ++i) {
+        m_peers.push_back(i == m_self ? nullptr
+            : std::make_shared<Peer>(io, m_config.nodes[i], m_self, m_config.maxQueued));
+    }
+}
+
+ClusterBus::~ClusterBus() {
+    stop();
+}
+
+void ClusterBus::start() {
+    tcp::endpoint endpoint(tcp::v4(), m_config.nodes[m_self].busPort);
+    m_acceptor.open(endpoint.protocol());
+    m_acceptor.set_option(boost::asio::socket_base::reuse_address(true));
+    m_acceptor.bind(endpoint);
+    m_acceptor.listen();
+    doAccept();
+    for (auto& peer : m_peers) {
+        if (peer) peer->start();
+    }
+    std::cout << "[CLUSTER] Node " << m_config.nodes[m_self].id << " listening for nodes on port "
+        << m_config.nodes[m_self].busPort << "\n";
+}
+
+void ClusterBus::stop() {
+    boost::system::error_code ignored;
+    m_acceptor.close(ignored);
+    for (auto& peer : m_peers) {
+        if (peer) peer->stop();
+    }
+}
+
+void ClusterBus::doAccept() {
+    m_acceptor.async_accept([this](boost::system::error_code ec, tcp::socket socket) {
+        if (ec == boost::asio::error::operation_aborted) return;
+        if (!ec) {
+            socket.set_option(tcp::no_delay(true), ec);
+            std::make_shared<Inbound>(std::move(socket), m_handlers, m_config.nodes.size())->start();
+        }
+        doAccept();
+    });
+}
+
+void ClusterBus::send(size_t node, Frame type, uint64_t client, std::string_view body) {
+    if (node >= m_peers.size() || !m_peers[node]) return;
+    m_peers[node]->send(frame(type, client, body));
+}
+
+void ClusterBus::broadcast(Frame type, uint64_t client, std::string_view body) {
+    std::string bytes = frame(type, client, body);
+    for (auto& peer : m_peers) {
+        if (peer) peer->send(bytes);
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <nlohmann/json.hpp>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// One server process of a sharded deployment
+struct ClusterNodeConfig {
+    std::string id;
+    std::string host = "127.0.0.1";
+    int wsPort = 9001;  // clients
+    int busPort = 9101; // other nodes
+};
+
+// Sharding, read from the "CLUSTER" block of config.json. Every node gets
+// the same list and picks itself with --node <id>.
+struct ClusterConfig {
+    bool enabled = false;
+    std::vector<ClusterNodeConfig> nodes;
+    size_t virtualNodes = 128;                 // ring points per node
+    size_t maxQueued = 64 * 1024 * 1024;       // bytes waiting for a peer; frames past this are dropped
+
+    static ClusterConfig fromJson(const nlohmann::json& j);
+    // Index of node `id`, or nodes.size() if there is none
+    size_t indexOf(const std::string& id) const;
+};
+
+// Consistent hashing of room ids onto nodes. Each node puts virtualNodes
+// points on a 64-bit ring and owns the keys that hash up to each of its
+// points, so adding or removing a node only moves the rooms next to its
+// points instead of reshuffling everything.
+class HashRing {
+public:
+    HashRing(const std::vector<ClusterNodeConfig>& nodes, size_t virtualNodes);
+    size_t owner(std::string_view key) const;
+
+private:
+    std::vector<std::pair<uint64_t, uint32_t>> m_points; // hash, node; sorted
+};
+
+// TCP links between nodes. Each node connects out to every other node
+// and sends only on those links; it reads only from the links others
+// opened to it. Frames are
+//
+//   u32 length | u8 type | u64 client | body      (little endian)
+//
+// with length covering everything after itself. A link starts with a
+// Hello whose client field is the sender's node index. Frames for a peer
+// wait in memory while its link (re)connects.
+class ClusterBus {
+public:
+    enum class Frame : uint8_t {
+        Hello = 1,
+        ClientMessage = 2, // edge -> owner: body is the client's message
+        ClientClosed = 3,  // edge -> owner: the client is gone
+        Deliver = 4,       // owner -> edge: u8 priority, then the message
+        CloseClient = 5,   // owner -> edge: u16 close code, then the reason
+        Command = 6,       // either way: JSON (bots and their events)
+    };
+
+    struct Handlers {
+        // Runs on an io thread; frames from one node arrive in order
+        std::function<void(size_t from, Frame type, uint64_t client, std::string_view body)> onFrame;
+        // The link node `from` opened to us is closed
+        std::function<void(size_t from)> onPeerLost;
+    };
+
+    ClusterBus(boost::asio::io_context& io, const ClusterConfig& cfg, size_t self, Handlers handlers);
+    ~ClusterBus();
+
+    ClusterBus(const ClusterBus&) = delete;
+    ClusterBus& operator=(const ClusterBus&) = delete;
+
+    void start();
+    void stop();
+    // Safe from any thread
+    void send(size_t node, Frame type, uint64_t client, std::string_view body);
+    void broadcast(Frame type, uint64_t client, std::string_view body);
+
+private:
+    class Peer;
+    class Inbound;
+
+    void doAccept();
+
+    boost::asio::io_context& m_io;
+    ClusterConfig m_config;
+    size_t m_self;
+    Handlers m_handlers;
+    boost::asio::ip::tcp::acceptor m_acceptor;
+    std::vector<std::shared_ptr<Peer>> m_peers; // by node index, null for ourselves
+};
@@ -0,0 +1,237 @@
+#include "ClusterNode.h"
+#include "server.h"
+#include "session.h"
+#include "DrawMessage.h"
+#include "RateLimiter.h"
+#include <algorithm>
+#include <iostream>
+
+using json = nlohmann::json;
+using Frame = ClusterBus::Frame;
+
+namespace {
+std::string_view normalizeRoom(std::string_view room) {
+    if (!room.empty() && room[0] == '#') room.remove_prefix(1);
+    return room;
+}
+
+// The room a client message is for, or empty if it isn't for one
+std::string roomOf(const std::string& msg) {
+    DrawEnvelope draw;
+    if (classifyMessage(msg) == MessageKind::Draw && parseDrawEnvelope(msg, draw))
+        return std::string(draw.room);
+    json j = json::parse(msg, nullptr, false);
+    if (!j.is_object()) return "";
+    auto room = j.find("room");
+    return room != j.end() && room->is_string() ? room->get<std::string>() : "";
+}
+}
+
+ClusterNode::ClusterNode(boost::asio::io_context& io, Server& server, const ClusterConfig& cfg, size_t self)
+    : m_io(io), m_server(server), m_config(cfg), m_self(self),
+    m_ring(cfg.nodes, cfg.virtualNodes),
+    m_bus(io, cfg, self, ClusterBus::Handlers{
+        [this](size_t from, Frame type, uint64_t client, std::string_view body) { onFrame(from, type, client, body); },
+        [this](size_t from) { onPeerLost(from); } }) {}
+
+void ClusterNode::start() {
+    m_bus.start();
+    std::cout << "[CLUSTER] Node " << self().id << " of " << m_config.nodes.size() << " started\n";
+}
+
+void ClusterNode::stop() {
+    m_bus.stop();
+}
+
+size_t ClusterNode::ownerOf(std::string_view room) const {
+    return m_ring.owner(normalizeRoom(room));
+}
+
+bool ClusterNode::forward(const std::shared_ptr<Session>& s, const std::string& msg) {
+    std::string room = roomOf(msg);
+    if (normalizeRoom(room).empty()) return false;
+    size_t owner = ownerOf(room);
+    if (owner == m_self) return false;
+
+    {
+        std::lock_guard<std::mutex> lock(m_remotesMutex);
+        Remote& remote = m_remotes[s->id()];
+        remote.session = s;
+        if (std::find(remote.nodes.begin(), remote.nodes.end(), owner) == remote.nodes.end())
+            remote.nodes.push_back(owner);
+    }
+    m_bus.send(owner, Frame::ClientMessage, s->id(), msg);
+    return true;
+}
+
+void ClusterNode::clientClosed(const std::shared_ptr<Session>& s) {
+    std::vector<size_t> nodes;
+    {
+        std::lock_guard<std::mutex> lock(m_remotesMutex);
+        auto it = m_remotes.find(s->id());
+        if (it == m_remotes.end()) return;
+        nodes = std::move(it->second.nodes);
+        m_remotes.erase(it);
+    }
+    for (size_t node : nodes) m_bus.send(node, Frame::ClientClosed, s->id(), {});
+}
+
+std::shared_ptr<Session> ClusterNode::edgeSession(uint64_t client) {
+    std::lock_guard<std::mutex> lock(m_remotesMutex);
+    auto it = m_remotes.find(client);
+    return it != m_remotes.end() ? it->second.session.lock() : nullptr;
+}
+
+bool ClusterNode::forward(const ChatEvent& ev) {
+    size_t owner = ownerOf(ev.room);
+    if (owner == m_self) return false;
+    command(owner, { {"type", "bot_chat"}, {"room", ev.room}, {"username", ev.username}, {"text", ev.text}, {"count", ev.count} });
+    return true;
+}
+
+bool ClusterNode::forward(const JoinEvent& ev) {
+    size_t owner = ownerOf(ev.room);
+    if (owner == m_self) return false;
+    command(owner, { {"type", "bot_join"}, {"room", ev.room}, {"username", ev.username} });
+    return true;
+}
+
+bool ClusterNode::forward(const GuessEvent& ev) {
+    size_t owner = ownerOf(ev.room);
+    if (owner == m_self) return false;
+    command(owner, { {"type", "bot_guess"}, {"room", ev.room}, {"username", ev.username}, {"guess", ev.guess} });
+    return true;
+}
+
+void ClusterNode::command(size_t node, const json& cmd) {
+    m_bus.send(node, Frame::Command, 0, cmd.dump());
+}
+
+void ClusterNode::broadcastCommand(const json& cmd) {
+    m_bus.broadcast(Frame::Command, 0, cmd.dump());
+}
+
+void ClusterNode::onFrame(size_t from, Frame type, uint64_t client, std::string_view body) {
+    switch (type) {
+    case Frame::ClientMessage:
+        onClientMessage(from, client, body);
+        break;
+    case Frame::ClientClosed:
+        dropProxy({ from, client });
+        break;
+    case Frame::Deliver: {
+        auto s = edgeSession(client);
+        if (!s || body.empty()) break;
+        auto priority = static_cast<SendPriority>(std::min<uint8_t>(static_cast<uint8_t>(body[0]), static_cast<uint8_t>(SendPriority::Critical)));
+        s->send(std::string(body.substr(1)), priority);
+        break;
+    }
+    case Frame::CloseClient: {
+        auto s = edgeSession(client);
+        if (!s || body.size() < 2) break;
+        auto code = static_cast<uint16_t>(static_cast<unsigned char>(body[0]) | (static_cast<unsigned char>(body[1]) << 8));
+        s->close(static_cast<boost::beast::websocket::close_code>(code), std::string(body.substr(2)));
+        break;
+    }
+    case Frame::Command:
+        onCommand(from, body);
+        break;
+    default:
+        std::cerr << "[CLUSTER] Ignoring frame type " << static_cast<int>(type) << " from node " << m_config.nodes[from].id << "\n";
+    }
+}
+
+void ClusterNode::onClientMessage(size_t from, uint64_t client, std::string_view msg) {
+    std::shared_ptr<Session> proxy;
+    {
+        std::lock_guard<std::mutex> lock(m_proxiesMutex);
+        auto& slot = m_proxies[{ from, client }];
+        if (!slot) {
+            slot = std::make_shared<Session>(boost::asio::ip::tcp::socket(m_io), m_server);
+            slot->makeRemote(RemoteLink{
+                [this, from, client](const std::string& out, SendPriority priority) {
+                    std::string body(1, static_cast<char>(priority));
+                    body += out;
+                    m_bus.send(from, Frame::Deliver, client, body);
+                },
+                [this, from, client](boost::beast::websocket::close_code code, const std::string& reason) {
+                    std::string body(2, '\0');
+                    body[0] = static_cast<char>(static_cast<uint16_t>(code) & 0xFF);
+                    body[1] = static_cast<char>(static_cast<uint16_t>(code) >> 8);
+                    body += reason;
+                    m_bus.send(from, Frame::CloseClient, client, body);
+                    dropProxy({ from, client });
+                } });
+        }
+        proxy = slot;
+    }
+    // Exactly what a local session's read loop does with it
+    m_server.roomManager().onMessage(proxy, std::string(msg));
+}
+
+void ClusterNode::dropProxy(const ProxyKey& key) {
+    std::shared_ptr<Session> proxy;
+    {
+        std::lock_guard<std::mutex> lock(m_proxiesMutex);
+        auto it = m_proxies.find(key);
+        if (it == m_proxies.end()) return;
+        proxy = std::move(it->second);
+        m_proxies.erase(it);
+    }
+    // Rooms may still hold it, like any dropped session
+    proxy->markDisconnected();
+}
+
+void ClusterNode::onPeerLost(size_t from) {
+    std::vector<std::shared_ptr<Session>> lost;
+    {
+        std::lock_guard<std::mutex> lock(m_proxiesMutex);
+        for (auto it = m_proxies.lower_bound({ from, 0 }); it != m_proxies.end() && it->first.first == from;) {
+            lost.push_back(std::move(it->second));
+            it = m_proxies.erase(it);
+        }
+    }
+    for (auto& proxy : lost) proxy->markDisconnected();
+    std::cerr << "[CLUSTER] Node " << m_config.nodes[from].id << " went away, dropped " << lost.size() << " of its clients\n";
+}
+
+// Commands between nodes:
+//   spawn_bot {oauth, nick, channel, room?}  run this bot here
+//   stop_bot {channel}                      stop it if it runs here
+//   claim_bot {channel, room}               the sender owns the channel's room now; hand the bot over
+//   bot_chat / bot_join / bot_guess         a bot's event for a room owned here
+void ClusterNode::onCommand(size_t from, std::string_view body) {
+    json cmd = json::parse(body, nullptr, false);
+    if (!cmd.is_object()) return;
+    std::string type = cmd.value("type", "");
+    RoomManager& rooms = m_server.roomManager();
+
+    if (type == "bot_chat") {
+        rooms.post(ChatEvent{ cmd.value("room", ""), cmd.value("username", ""), cmd.value("text", ""), cmd.value("count", 1u) });
+    }
+    else if (type == "bot_join") {
+        rooms.post(JoinEvent{ cmd.value("room", ""), cmd.value("username", "") });
+    }
+    else if (type == "bot_guess") {
+        rooms.post(GuessEvent{ cmd.value("room", ""), cmd.value("username", ""), cmd.value("guess", "") });
+    }
+    else if (type == "spawn_bot") {
+        std::string channel = cmd.value("channel", "");
+        std::string room = cmd.value("room", "");
+        if (!room.empty()) m_server.routes().setRoom(channel, room);
+        m_server.spawnLocalBot(cmd.value("oauth", ""), cmd.value("nick", ""), channel);
+    }
+    else if (type == "stop_bot") {
+        m_server.stopLocalBot(cmd.value("channel", ""));
+    }
+    else if (type == "claim_bot") {
+        std::string channel = cmd.value("channel", "");
+        std::string oauth, nick;
+        if (!m_server.takeLocalBot(channel, oauth, nick)) return;
+        std::cout << "[CLUSTER] Moving bot for " << channel << " to node " << m_config.nodes[from].id << "\n";
+        command(from, { {"type", "spawn_bot"}, {"oauth", oauth}, {"nick", nick}, {"channel", channel}, {"room", cmd.value("room", "")} });
+    }
+    else {
+        std::cerr << "[CLUSTER] Unknown command " << type << " from node " << m_config.nodes[from].id << "\n";
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ClusterBus.h"
+#include "BotEvents.h"
+
+class Server;
+class Session;
+
+// This process's part in a sharded deployment. Every room id hashes onto
+// one node (its owner) and lives only there. Clients may connect to any
+// node: messages for rooms owned elsewhere are forwarded over the bus, and
+// the owner plays them through a stand-in Session whose output comes back
+// the same way. A Twitch bot runs on the node that owns its channel's room.
+class ClusterNode {
+public:
+    ClusterNode(boost::asio::io_context& io, Server& server, const ClusterConfig& cfg, size_t self);
+
+    void start();
+    void stop();
+
+    const ClusterNodeConfig& self() const { return m_config.nodes[m_self]; }
+    // Node index owning `room` ('#' prefix ignored)
+    size_t ownerOf(std::string_view room) const;
+    bool ownsRoom(std::string_view room) const { return ownerOf(room) == m_self; }
+
+    // Client side. True if the message was for a room owned elsewhere and
+    // has been sent there; false means handle it here.
+    bool forward(const std::shared_ptr<Session>& s, const std::string& msg);
+    // The client is gone; owners that saw it drop their stand-ins
+    void clientClosed(const std::shared_ptr<Session>& s);
+
+    // Bot events for rooms owned elsewhere; false means post them here
+    bool forward(const ChatEvent& ev);
+    bool forward(const JoinEvent& ev);
+    bool forward(const GuessEvent& ev);
+
+    // Bot control, JSON commands on the bus (see ClusterNode.cpp)
+    void command(size_t node, const nlohmann::json& cmd);
+    void broadcastCommand(const nlohmann::json& cmd);
+
+private:
+    using ProxyKey = std::pair<size_t, uint64_t>; // node, client id there
+
+    struct Remote {
+        std::weak_ptr<Session> session;
+        std::vector<size_t> nodes; // owners it has talked to
+    };
+
+    void onFrame(size_t from, ClusterBus::Frame type, uint64_t client, std::string_view body);
+    void onPeerLost(size_t from);
+    void onClientMessage(size_t from, uint64_t client, std::string_view msg);
+    void onCommand(size_t from, std::string_view body);
+    void dropProxy(const ProxyKey& key);
+    std::shared_ptr<Session> edgeSession(uint64_t client);
+
+    boost::asio::io_context& m_io;
+    Server& m_server;
+    ClusterConfig m_config;
+    size_t m_self;
+    HashRing m_ring;
+    ClusterBus m_bus;
+
+    std::mutex m_remotesMutex;
+    std::unordered_map<uint64_t, Remote> m_remotes; // our clients in rooms elsewhere, by Session::id()
+    std::mutex m_proxiesMutex;
+    std::map<ProxyKey, std::shared_ptr<Session>> m_proxies; // stand-ins for clients elsewhere
+};
@@ -0,0 +1,162 @@
+#include "DrawMessage.h"
+#include <cctype>
+#include <charconv>
+#include <cmath>
+
+namespace {
+// Just enough of a JSON reader to walk one object level in place
+struct Cursor {
+    std::string_view s;
+    size_t i = 0;
+
+    void ws() {
+        while (i < s.size() && (s[i] == ' ' || s[i] == '\t' || s[i] == '\n' || s[i] == '\r')) ++i;
+    }
+
+    bool eat(char c) {
+        ws();
+        if (i < s.size() && s[i] == c) {
+            ++i;
+            return true;
+        }
+        return false;
+    }
+
+    bool atEnd() {
+        ws();
+        return i == s.size();
+    }
+
+    // Contents between the quotes; `escaped` if they need unescaping
+    bool string(std::string_view& out, bool& escaped) {
+        ws();
+        if (i >= s.size() || s[i] != '"') return false;
+        size_t start = ++i;
+        escaped = false;
+        while (i < s.size()) {
+            char c = s[i];
+            if (c == '"') {
+                out = s.substr(start, i - start);
+                ++i;
+                return true;
+            }
+            if (c == '\\') {
+                escaped = true;
+                i += 2;
+                continue;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) return false;
+            ++i;
+        }
+        return false;
+    }
+
+    bool number(double& value) {
+        ws();
+        if (i >= s.size() || (s[i] != '-' && !std::isdigit(static_cast<unsigned char>(s[i])))) return false;
+        auto [ptr, ec] = std::from_chars(s.data() + i, s.data() + s.size(), value);
+        if (ec != std::errc()) return false;
+        i = static_cast<size_t>(ptr - s.data());
+        return std::isfinite(value);
+    }
+
+    // Steps over any value; nested containers only need to balance
+    bool skip() {
+        ws();
+        if (i >= s.size()) return false;
+        std::string_view str;
+        bool escaped;
+        char c = s[i];
+        if (c == '"') return string(str, escaped);
+        if (c == '{' || c == '[') {
+            int depth = 0;
+            while (i < s.size()) {
+                char d = s[i];
+                if (d == '"') {
+                    if (!string(str, escaped)) return false;
+                    continue;
+                }
+                if (d == '{' || d == '[') ++depth;
+                else if ((d == '}' || d == ']') && --depth == 0) {
+                    ++i;
+                    return true;
+                }
+                ++i;
+            }
+            return false;
+        }
+        size_t start = i;
+        while (i < s.size() && s[i] != ',' && s[i] != '}' && s[i] != ']'
+            && s[i] != ' ' && s[i] != '\t' && s[i] != '\n' && s[i] != '\r') ++i;
+        return i > start;
+    }
+};
+
+bool validColor(std::string_view color) {
+    if (color.empty() || color.size() > 32) return false;
+    for (char c : color) {
+        if (!std::isalnum(static_cast<unsigned char>(c)) && c != '#' && c != '(' && c != ')'
+            && c != ',' && c != '.' && c != ' ' && c != '%') return false;
+    }
+    return true;
+}
+}
+
+bool parseDrawEnvelope(std::string_view raw, DrawEnvelope& out) {
+    Cursor c{ raw };
+    if (!c.eat('{') || c.eat('}')) return false;
+
+    bool haveRoom = false, havePayload = false;
+    do {
+        std::string_view key;
+        bool escaped;
+        if (!c.string(key, escaped) || !c.eat(':')) return false;
+        if (key == "room") {
+            if (!c.string(out.room, escaped) || escaped) return false;
+            haveRoom = true;
+        }
+        else if (key == "payload") {
+            c.ws();
+            size_t start = c.i;
+            if (!c.skip()) return false;
+            out.payload = raw.substr(start, c.i - start);
+            havePayload = true;
+        }
+        else if (!c.skip()) {
+            return false;
+        }
+    } while (c.eat(','));
+
+    return c.eat('}') && c.atEnd() && haveRoom && havePayload;
+}
+
+bool validDrawPayload(std::string_view payload) {
+    Cursor c{ payload };
+    if (!c.eat('{') || c.eat('}')) return false;
+
+    bool haveAction = false;
+    do {
+        std::string_view key, text;
+        bool escaped;
+        double number;
+        if (!c.string(key, escaped) || escaped || !c.eat(':')) return false;
+        if (key == "action") {
+            if (!c.string(text, escaped) || (text != "start" && text != "draw" && text != "end")) return false;
+            haveAction = true;
+        }
+        else if (key == "x" || key == "y") {
+            if (!c.number(number) || std::fabs(number) > kDrawMaxCoordinate) return false;
+        }
+        else if (key == "width") {
+            if (!c.number(number) || number <= 0 || number > kDrawMaxWidth) return false;
+        }
+        else if (key == "color") {
+            if (!c.string(text, escaped) || escaped || !validColor(text)) return false;
+        }
+        else {
+            return false;
+        }
+    } while (c.eat(','));
+
+    return c.eat('}') && c.atEnd() && haveAction;
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <string_view>
+
+// Draw messages are most of the inbound traffic, so they skip the JSON DOM:
+// the envelope is scanned in place, the payload is checked against the one
+// shape the canvas sends, and its original bytes are forwarded as they are.
+//
+//   {"type":"draw","room":"<id>","payload":{"action":"start"|"draw"|"end",
+//    "x":<num>,"y":<num>,"color":"<css color>","width":<num>}}
+
+// Inclusive limits for coordinates and line width
+constexpr double kDrawMaxCoordinate = 10000.0;
+constexpr double kDrawMaxWidth = 200.0;
+
+struct DrawEnvelope {
+    std::string_view room;    // raw string contents, no escapes
+    std::string_view payload; // the whole payload value, braces included
+};
+
+// Finds "room" and "payload" in a top-level object without building a DOM.
+// False if the text isn't a well-formed object, either key is missing, or
+// the room name uses escapes; callers fall back to the full parser then.
+bool parseDrawEnvelope(std::string_view raw, DrawEnvelope& out);
+
+// True if `payload` is an object with only the keys above, a known action,
+// finite numbers within range and a plain color string
+bool validDrawPayload(std::string_view payload);
@@ -0,0 +1,560 @@
+#include "EventLog.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace {
+constexpr char kMagic[8] = { 'G', 'I', 'O', 'R', 'O', 'O', 'M', '1' };
+constexpr size_t kFileHeader = 16;              // magic + u64 generation
+constexpr size_t kFrameHeader = 8;              // length + crc
+constexpr uint32_t kMaxRecord = 16 * 1024 * 1024; // anything longer is corruption
+constexpr size_t kMaxOpenFiles = 256;
+
+constexpr std::array<uint32_t, 256> makeCrcTable() {
+    std::array<uint32_t, 256> table{};
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        table[i] = c;
+    }
+    return table;
+}
+constexpr auto kCrcTable = makeCrcTable();
+
+uint32_t crc32(uint32_t crc, std::string_view bytes) {
+    crc = ~crc;
+    for (unsigned char b : bytes) crc = kCrcTable[(crc ^ b) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+void putU32(char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = static_cast<char>(v >> (8 * i));
+}
+
+void putI64(char* p, int64_t v) {
+    for (int i = 0; i < 8; ++i) p[i] = static_cast<char>(static_cast<uint64_t>(v) >> (8 * i));
+}
+
+uint64_t getLE(const char* p, int bytes) {
+    uint64_t v = 0;
+    for (int i = bytes - 1; i >= 0; --i) v = (v << 8) | static_cast<unsigned char>(p[i]);
+    return v;
+}
+
+bool syncFile(std::FILE* f) {
+#ifdef _WIN32
+    return _commit(_fileno(f)) == 0;
+#else
+    return fsync(fileno(f)) == 0;
+#endif
+}
+
+// A rename only survives a crash once the directory itself is synced
+void syncDir(const std::string& dir) {
+#ifndef _WIN32
+    int fd = ::open(dir.c_str(), O_RDONLY);
+    if (fd >= 0) {
+        ::fsync(fd);
+        ::close(fd);
+    }
+#endif
+}
+
+// Room names are arbitrary; anything but [a-z0-9_-] becomes %XX, which
+// also keeps names distinct on case-insensitive file systems
+std::string encodeName(const std::string& room) {
+    static constexpr char kHex[] = "0123456789ABCDEF";
+    std::string out;
+    for (unsigned char c : room) {
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_' || c == '-') {
+            out += static_cast<char>(c);
+        }
+        else {
+            out += '%';
+            out += kHex[c >> 4];
+            out += kHex[c & 0xF];
+        }
+    }
+    return out;
+}
+
+bool decodeName(const std::string& file, std::string& room) {
+    room.clear();
+    for (size_t i = 0; i < file.size(); ++i) {
+        if (file[i] != '%') {
+            room += file[i];
+            continue;
+        }
+        if (i + 2 >= file.size()) return false;
+        int v = 0;
+        for (int k = 1; k <= 2; ++k) {
+            char h = file[i + k];
+            v <<= 4;
+            if (h >= '0' && h <= '9') v |= h - '0';
+            else if (h >= 'A' && h <= 'F') v |= h - 'A' + 10;
+            else return false;
+        }
+        room += static_cast<char>(v);
+        i += 2;
+    }
+    return !room.empty();
+}
+
+bool writeAll(std::FILE* f, std::string_view bytes) {
+    return std::fwrite(bytes.data(), 1, bytes.size(), f) == bytes.size() && std::fflush(f) == 0;
+}
+}
+
+EventLogConfig EventLogConfig::fromJson(const nlohmann::json& j) {
+    EventLogConfig cfg;
+    cfg.enabled = j.value("enabled", cfg.enabled);
+    cfg.dir = j.value("dir", cfg.dir);
+    cfg.flushInterval = std::chrono::milliseconds(std::max(j.value("flush_ms", static_cast<int>(cfg.flushInterval.count())), 1));
+    cfg.sync = j.value("sync", cfg.sync);
+    cfg.snapshotInterval = std::chrono::seconds(std::max(j.value("snapshot_s", static_cast<int>(cfg.snapshotInterval.count())), 0));
+    cfg.maxPending = std::max<size_t>(j.value("max_pending_mb", cfg.maxPending >> 20), 1) << 20;
+    return cfg;
+}
+
+void EventLog::Records::join(std::string_view username) {
+    frame(m_bytes, Event::Join, {}, username);
+}
+
+void EventLog::Records::score(std::string_view username, int64_t total) {
+    char head[8];
+    putI64(head, total);
+    frame(m_bytes, Event::Score, std::string_view(head, sizeof(head)), username);
+}
+
+void EventLog::Records::round(uint32_t played) {
+    char head[4];
+    putU32(head, played);
+    frame(m_bytes, Event::Round, std::string_view(head, sizeof(head)), {});
+}
+
+EventLog::EventLog(const EventLogConfig& cfg)
+    : m_config(cfg) {}
+
+EventLog::~EventLog() {
+    stop();
+    for (auto& [room, f] : m_files) std::fclose(f);
+}
+
+void EventLog::frame(std::string& out, Event type, std::string_view head, std::string_view body) {
+    char header[kFrameHeader + 1];
+    char tag = static_cast<char>(type);
+    uint32_t crc = crc32(crc32(crc32(0, std::string_view(&tag, 1)), head), body);
+    putU32(header, static_cast<uint32_t>(1 + head.size() + body.size()));
+    putU32(header + 4, crc);
+    header[kFrameHeader] = tag;
+    out.append(header, sizeof(header));
+    out += head;
+    out += body;
+}
+
+void EventLog::append(const std::string& room, Event type, std::string_view head, std::string_view body) {
+    // Framed and checksummed before taking the lock
+    thread_local std::string record;
+    record.clear();
+    frame(record, type, head, body);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pendingBytes + record.size() > m_config.maxPending) {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    auto it = m_pending.find(room);
+    if (it == m_pending.end()) it = m_pending.try_emplace(room).first;
+    it->second.bytes += record;
+    m_pendingBytes += record.size();
+    if (m_dirty.find(room) == m_dirty.end()) m_dirty.insert(room);
+}
+
+void EventLog::join(const std::string& room, std::string_view username) {
+    append(room, Event::Join, {}, username);
+}
+
+void EventLog::draw(const std::string& room, std::string_view payload) {
+    append(room, Event::Draw, {}, payload);
+}
+
+void EventLog::score(const std::string& room, std::string_view username, int64_t total) {
+    char head[8];
+    putI64(head, total);
+    append(room, Event::Score, std::string_view(head, sizeof(head)), username);
+}
+
+void EventLog::reset(const std::string& room) {
+    append(room, Event::Reset);
+}
+
+void EventLog::round(const std::string& room, uint32_t played) {
+    char head[4];
+    putU32(head, played);
+    append(room, Event::Round, std::string_view(head, sizeof(head)));
+}
+
+void EventLog::rewrite(const std::string& room, const Records& snapshot) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Pending& p = m_pending[room];
+    m_pendingBytes = m_pendingBytes - p.bytes.size() + snapshot.m_bytes.size();
+    p.bytes = snapshot.m_bytes;
+    p.snapshot.clear();
+    p.replace = true;
+    p.removed = false;
+}
+
+void EventLog::checkpoint(const std::string& room, std::string snapshot) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_dirty.erase(room);
+    Pending& p = m_pending[room];
+    m_pendingBytes -= p.bytes.size();
+    p.bytes.clear();
+    p.snapshot = std::move(snapshot);
+    p.replace = true;
+    p.removed = false;
+}
+
+void EventLog::remove(const std::string& room) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_dirty.erase(room);
+    Pending& p = m_pending[room];
+    m_pendingBytes -= p.bytes.size();
+    p.bytes.clear();
+    p.snapshot.clear();
+    p.replace = true;
+    p.removed = true;
+}
+
+bool EventLog::readLog(const std::string& path, const std::string& room, uint64_t& generation,
+    const EntryFn& f, size_t& records) {
+    std::ifstream in(path, std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    if (data.size() < kFileHeader || std::memcmp(data.data(), kMagic, sizeof(kMagic)) != 0) {
+        std::cerr << "[EVENTLOG] " << path << " is not a room log, skipping\n";
+        return false;
+    }
+    generation = getLE(data.data() + sizeof(kMagic), 8);
+    if (!f) return true;
+
+    size_t at = kFileHeader;
+    while (data.size() - at >= kFrameHeader) {
+        uint32_t len = static_cast<uint32_t>(getLE(data.data() + at, 4));
+        uint32_t crc = static_cast<uint32_t>(getLE(data.data() + at + 4, 4));
+        if (len == 0 || len > kMaxRecord || data.size() - at - kFrameHeader < len) break;
+        std::string_view rec(data.data() + at + kFrameHeader, len);
+        if (crc32(0, rec) != crc) break;
+
+        Entry entry{ static_cast<Event>(rec[0]) };
+        std::string_view body = rec.substr(1);
+        switch (entry.type) {
+        case Event::Join:
+        case Event::Draw:
+            entry.text = body;
+            break;
+        case Event::Score:
+            if (body.size() < 8) break;
+            entry.number = static_cast<int64_t>(getLE(body.data(), 8));
+            entry.text = body.substr(8);
+            break;
+        case Event::Round:
+            if (body.size() < 4) break;
+            entry.number = static_cast<int64_t>(getLE(body.data(), 4));
+            break;
+        default:
+            break;
+        }
+        f(room, entry);
+        ++records;
+        at += kFrameHeader + len;
+    }
+
+    // The tail past the last intact record never finished writing
+    if (at < data.size()) {
+        std::cerr << "[EVENTLOG] " << room << ": dropping " << (data.size() - at)
+            << " bytes of torn or corrupt log\n";
+        std::error_code ec;
+        fs::resize_file(path, at, ec);
+    }
+    return true;
+}
+
+size_t EventLog::replay(const SnapshotFn& onSnapshot, const EntryFn& onEntry) {
+    std::error_code ec;
+    fs::create_directories(m_config.dir, ec);
+    if (ec) {
+        std::cerr << "[EVENTLOG] Can't create " << m_config.dir << ": " << ec.message() << "\n";
+        return 0;
+    }
+
+    // Room -> which of its files are there
+    std::map<std::string, std::pair<bool, bool>> found;
+    for (const auto& item : fs::directory_iterator(m_config.dir, ec)) {
+        const fs::path& path = item.path();
+        // Left over from a rewrite that didn't finish; the old file still stands
+        if (path.extension() == ".tmp") {
+            fs::remove(path, ec);
+            continue;
+        }
+        std::string room;
+        if (!decodeName(path.stem().string(), room)) continue;
+        if (path.extension() == ".log") found[room].first = true;
+        else if (path.extension() == ".snap") found[room].second = true;
+    }
+
+    auto started = std::chrono::steady_clock::now();
+    size_t snapshots = 0, records = 0;
+    for (auto& [room, files] : found) {
+        std::string logPath = pathFor(room), snapPath = snapshotPathFor(room);
+        uint64_t logGen = 0;
+        bool haveLog = files.first && readLog(logPath, room, logGen, nullptr, records);
+
+        RoomSnapshot snap;
+        std::string error;
+        if (files.second && !snap.open(snapPath, &error)) std::cerr << "[EVENTLOG] " << error << "\n";
+        if (snap.loaded() && haveLog && snap.generation() < logGen) {
+            // The log was started over after this was taken (a clear)
+            snap = RoomSnapshot();
+            fs::remove(snapPath, ec);
+        }
+
+        uint64_t generation = logGen;
+        if (snap.loaded()) {
+            onSnapshot(room, snap);
+            ++snapshots;
+            generation = snap.generation();
+            // Newer than the log: it was taken, but the log wasn't restarted before the crash
+            if (haveLog && generation > logGen) {
+                fs::remove(logPath, ec);
+                haveLog = false;
+            }
+        }
+        if (haveLog) readLog(logPath, room, logGen, onEntry, records);
+        m_generations[room] = generation;
+    }
+
+    auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - started).count();
+    std::cout << "[EVENTLOG] Restored " << found.size() << " rooms (" << snapshots << " snapshots, "
+        << records << " logged events) from " << m_config.dir << " in " << ms << "ms\n";
+    return found.size();
+}
+
+void EventLog::start() {
+    if (m_thread.joinable()) return;
+    std::error_code ec;
+    fs::create_directories(m_config.dir, ec);
+    std::cout << "[EVENTLOG] Logging rooms to " << m_config.dir << ", committed every "
+        << m_config.flushInterval.count() << "ms" << (m_config.sync ? " with fsync" : "") << "\n";
+    m_thread = std::thread([this]() { run(); });
+}
+
+void EventLog::stop() {
+    if (!m_thread.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_cv.notify_one();
+    m_thread.join();
+    std::cout << "[EVENTLOG] Stopped: " << m_written << " bytes in " << m_commits << " commits, "
+        << m_dropped.load() << " events dropped\n";
+}
+
+std::vector<std::string> EventLog::dirtyRooms() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::vector<std::string>(m_dirty.begin(), m_dirty.end());
+}
+
+void EventLog::run() {
+    std::unordered_map<std::string, Pending, StringHash, std::equal_to<>> batch;
+    auto nextSnapshot = std::chrono::steady_clock::now() + m_config.snapshotInterval;
+    for (;;) {
+        // Checkpoints queue like any other event and go out with this commit
+        if (m_snapshotSource && m_config.snapshotInterval.count() > 0
+            && std::chrono::steady_clock::now() >= nextSnapshot) {
+            std::vector<std::string> rooms = dirtyRooms();
+            if (!rooms.empty()) m_snapshotSource(rooms);
+            nextSnapshot = std::chrono::steady_clock::now() + m_config.snapshotInterval;
+        }
+
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait_for(lock, m_config.flushInterval, [this]() { return m_stopping; });
+            stopping = m_stopping;
+            batch.swap(m_pending);
+            m_pendingBytes = 0;
+        }
+        if (!batch.empty()) commit(batch);
+        batch.clear();
+        if (stopping) return;
+    }
+}
+
+bool EventLog::replaceFile(const std::string& path, std::string_view head, std::string_view body) {
+    // Built aside and renamed over, so a crash leaves the old file or the new one
+    std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    bool ok = f && writeAll(f, head) && writeAll(f, body) && (!m_config.sync || syncFile(f));
+    if (f) std::fclose(f);
+    std::error_code ec;
+    if (ok) fs::rename(tmp, path, ec);
+    if (!ok || ec) {
+        std::cerr << "[EVENTLOG] Rewrite of " << path << " failed\n";
+        fs::remove(tmp, ec);
+        return false;
+    }
+    m_written += head.size() + body.size();
+    return true;
+}
+
+void EventLog::commit(std::unordered_map<std::string, Pending, StringHash, std::equal_to<>>& batch) {
+    std::vector<std::FILE*> written;
+    bool failed = false, renamed = false;
+
+    for (auto& [room, p] : batch) {
+        std::string path = pathFor(room);
+        if (p.replace) {
+            closeFile(room);
+            std::error_code ec;
+            std::string snapPath = snapshotPathFor(room);
+            if (p.removed && p.bytes.empty()) {
+                fs::remove(path, ec);
+                fs::remove(snapPath, ec);
+                m_generations.erase(room);
+                renamed = true;
+                continue;
+            }
+
+            // Snapshot first: a crash before the log restarts leaves a snapshot
+            // newer than the log, and replay() trusts the snapshot alone
+            uint64_t generation = ++m_generations[room];
+            if (!p.snapshot.empty()) {
+                RoomSnapshot::setGeneration(p.snapshot, generation);
+                if (!replaceFile(snapPath, p.snapshot, {})) {
+                    // Keep the old pair; what was pending is lost
+                    --m_generations[room];
+                    failed = true;
+                    continue;
+                }
+            }
+            if (!replaceFile(path, fileHeader(generation), p.bytes)) {
+                failed = true;
+                continue;
+            }
+            // Log first here: the old snapshot goes stale by generation even if this fails
+            if (p.snapshot.empty()) fs::remove(snapPath, ec);
+            renamed = true;
+            continue;
+        }
+
+        std::FILE* f = fileFor(room);
+        if (!f) {
+            failed = true;
+            continue;
+        }
+        long before = std::ftell(f);
+        if (!writeAll(f, p.bytes)) {
+            // Cut back whatever part made it, so later records aren't stuck behind a torn one
+            closeFile(room);
+            std::error_code ec;
+            if (before >= 0) fs::resize_file(path, static_cast<uintmax_t>(before), ec);
+            failed = true;
+            continue;
+        }
+        written.push_back(f);
+        m_written += p.bytes.size();
+    }
+
+    // One sync per file per commit, after every file has been written
+    if (m_config.sync) {
+        for (std::FILE* f : written) failed |= !syncFile(f);
+        if (renamed) syncDir(m_config.dir);
+    }
+    ++m_commits;
+
+    if (failed && !m_failing) {
+        std::cerr << "[EVENTLOG] Writing to " << m_config.dir << " is failing; events are being lost\n";
+        m_failing = true;
+    }
+    else if (!failed && m_failing) {
+        std::cout << "[EVENTLOG] Writing to " << m_config.dir << " recovered\n";
+        m_failing = false;
+    }
+}
+
+std::string EventLog::fileStem(const std::string& room) {
+    return encodeName(room);
+}
+
+bool EventLog::roomFromStem(const std::string& stem, std::string& room) {
+    return decodeName(stem, room);
+}
+
+uint32_t EventLog::checksum(std::string_view bytes) {
+    return crc32(0, bytes);
+}
+
+std::string EventLog::pathFor(const std::string& room) const {
+    return (fs::path(m_config.dir) / (encodeName(room) + ".log")).string();
+}
+
+std::string EventLog::snapshotPathFor(const std::string& room) const {
+    return (fs::path(m_config.dir) / (encodeName(room) + ".snap")).string();
+}
+
+std::string EventLog::fileHeader(uint64_t generation) {
+    std::string header(kMagic, sizeof(kMagic));
+    char gen[8];
+    putI64(gen, static_cast<int64_t>(generation));
+    header.append(gen, sizeof(gen));
+    return header;
+}
+
+std::FILE* EventLog::fileFor(const std::string& room) {
+    auto it = m_files.find(room);
+    if (it != m_files.end()) return it->second;
+
+    // Thousands of quiet rooms shouldn't pin thousands of handles
+    if (m_files.size() >= kMaxOpenFiles) {
+        for (auto& [name, f] : m_files) std::fclose(f);
+        m_files.clear();
+    }
+
+    std::string path = pathFor(room);
+    std::FILE* f = std::fopen(path.c_str(), "ab");
+    if (!f) {
+        std::cerr << "[EVENTLOG] Can't open " << path << "\n";
+        return nullptr;
+    }
+    std::fseek(f, 0, SEEK_END);
+    auto gen = m_generations.find(room);
+    if (std::ftell(f) == 0 && !writeAll(f, fileHeader(gen == m_generations.end() ? 0 : gen->second))) {
+        std::fclose(f);
+        return nullptr;
+    }
+    m_files.emplace(room, f);
+    return f;
+}
+
+void EventLog::closeFile(const std::string& room) {
+    auto it = m_files.find(room);
+    if (it == m_files.end()) return;
+    std::fclose(it->second);
+    m_files.erase(it);
+}
@@ -0,0 +1,169 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "StringHash.h"
+#include "RoomSnapshot.h"
+
+// Where room logs live and how often they are committed, read from the
+// "EVENT_LOG" block of config.json
+struct EventLogConfig {
+    bool enabled = false;
+    std::string dir = "rooms";
+    std::chrono::milliseconds flushInterval{ 50 };   // longest an event waits for disk
+    bool sync = true;                                // fsync each commit, not just write
+    std::chrono::seconds snapshotInterval{ 60 };     // 0 turns periodic snapshots off
+    size_t maxPending = 64 * 1024 * 1024;            // bytes; events past this are dropped
+
+    static EventLogConfig fromJson(const nlohmann::json& j);
+};
+
+// Append-only log per room, so players, scores and the canvas survive a
+// crash. Each record is framed as
+//
+//   u32 length | u32 crc32 | u8 type | body      (little endian)
+//
+// with length and crc covering type and body. Callers only copy a record
+// into the room's pending buffer; a thread of its own writes every room's
+// buffer once per flushInterval and syncs it (group commit). On startup
+// replay() reads each file up to the first torn or corrupt record and cuts
+// it off there.
+//
+// A canvas clear makes every stroke before it dead weight, so the room
+// rewrites its log as a short list of records (rewrite()) instead of
+// appending. Every snapshotInterval the rooms that changed are also saved
+// as a RoomSnapshot (checkpoint()), after which their logs start over, so
+// a restart maps one file per room and replays only a short tail.
+//
+// Each log starts with a generation number that goes up whenever it is
+// started over, and a snapshot carries the generation of the log that
+// follows it. That tells replay() which of the two is current when a
+// crash lands between writing one and the other. A room that is removed on purpose takes its log with it.
+class EventLog {
+public:
+    enum class Event : uint8_t {
+        Join = 1,  // body: username
+        Draw = 2,  // body: the validated payload bytes
+        Score = 3, // body: i64 total, username
+        Reset = 4, // lobby emptied
+        Round = 5, // body: u32 rounds played
+    };
+
+    // One decoded record; views point into the file being replayed
+    struct Entry {
+        Event type;
+        std::string_view text; // username or payload
+        int64_t number = 0;    // score or round
+    };
+
+    // Encoded records, for rewrite()
+    class Records {
+    public:
+        void join(std::string_view username);
+        void score(std::string_view username, int64_t total);
+        void round(uint32_t played);
+        bool empty() const { return m_bytes.empty(); }
+
+    private:
+        friend class EventLog;
+        std::string m_bytes;
+    };
+
+    explicit EventLog(const EventLogConfig& cfg);
+    ~EventLog();
+
+    EventLog(const EventLog&) = delete;
+    EventLog& operator=(const EventLog&) = delete;
+
+    using SnapshotFn = std::function<void(const std::string& room, const RoomSnapshot& snapshot)>;
+    using EntryFn = std::function<void(const std::string& room, const Entry& entry)>;
+    // For each room on disk: onSnapshot with its snapshot if it has a current
+    // one, then onEntry for every intact record logged after it, oldest
+    // first. Run it before start(). Returns the number of rooms found.
+    size_t replay(const SnapshotFn& onSnapshot, const EntryFn& onEntry);
+
+    // Called on the writer thread every snapshotInterval with the rooms that
+    // logged something since their last checkpoint; expected to checkpoint()
+    // them. Set it before start().
+    using SnapshotSource = std::function<void(const std::vector<std::string>& rooms)>;
+    void setSnapshotSource(SnapshotSource source) { m_snapshotSource = std::move(source); }
+    std::vector<std::string> dirtyRooms();
+
+    void start();
+    // Commits what is pending, then stops the thread
+    void stop();
+
+    // Safe from any thread; never touches the disk
+    void join(const std::string& room, std::string_view username);
+    void draw(const std::string& room, std::string_view payload);
+    void score(const std::string& room, std::string_view username, int64_t total);
+    void reset(const std::string& room);
+    void round(const std::string& room, uint32_t played);
+    // Replaces the room's whole log with `snapshot`
+    void rewrite(const std::string& room, const Records& snapshot);
+    // Saves `snapshot` (a RoomSnapshot image) as the room's state and starts
+    // its log over from here
+    void checkpoint(const std::string& room, std::string snapshot);
+    // Deletes the room's log
+    void remove(const std::string& room);
+
+    // File name stem for a room, and back; shared by other per-room files
+    static std::string fileStem(const std::string& room);
+    static bool roomFromStem(const std::string& stem, std::string& room);
+    static uint32_t checksum(std::string_view bytes); // crc32
+
+private:
+    struct Pending {
+        std::string bytes;
+        std::string snapshot; // RoomSnapshot image to save first
+        bool replace = false; // start the file over (rewrite, checkpoint or remove)
+        bool removed = false; // ... and leave no file if nothing follows
+    };
+
+    // `head` is a fixed-size field written before `body`
+    static void frame(std::string& out, Event type, std::string_view head, std::string_view body);
+    void append(const std::string& room, Event type, std::string_view head = {}, std::string_view body = {});
+    void run();
+    void commit(std::unordered_map<std::string, Pending, StringHash, std::equal_to<>>& batch);
+    // Reads a log's generation and, with `f`, its records
+    bool readLog(const std::string& path, const std::string& room, uint64_t& generation,
+        const EntryFn& f, size_t& records);
+    // Writes a whole file aside and renames it into place
+    bool replaceFile(const std::string& path, std::string_view head, std::string_view body);
+    static std::string fileHeader(uint64_t generation);
+    std::string pathFor(const std::string& room) const;
+    std::string snapshotPathFor(const std::string& room) const;
+    std::FILE* fileFor(const std::string& room);
+    void closeFile(const std::string& room);
+
+    EventLogConfig m_config;
+    std::thread m_thread;
+    SnapshotSource m_snapshotSource;
+
+    // Shared with callers
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::unordered_map<std::string, Pending, StringHash, std::equal_to<>> m_pending;
+    size_t m_pendingBytes = 0;
+    std::unordered_set<std::string, StringHash, std::equal_to<>> m_dirty; // appended since last checkpoint
+    bool m_stopping = false;
+    std::atomic<uint64_t> m_dropped{ 0 };
+
+    // Writer thread only
+    std::unordered_map<std::string, std::FILE*> m_files;
+    std::unordered_map<std::string, uint64_t> m_generations; // current log generation per room
+    uint64_t m_commits = 0;
+    uint64_t m_written = 0;
+    bool m_failing = false;
+};
@@ -0,0 +1,392 @@
+#include "FakeTwitchServer.h"
+#include "IngestStats.h"
+#include "IrcParser.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <charconv>
+#include <fstream>
+#include <iostream>
+
+using boost::asio::ip::tcp;
+
+namespace {
+const std::array<const char*, 12> kPhrases = {
+    "is that a cat", "lmao", "nice drawing", "what even is that", "hello chat",
+    "this round is hard", "gg", "draw faster", "I know it", "no way",
+    "that's a house right", "who is drawing"
+};
+const std::array<const char*, 6> kEmotes = { "KEKW", "LUL", "PogChamp", "Kappa", "W", "OMEGALUL" };
+const std::array<const char*, 8> kWords = { "cat", "house", "pizza", "dragon", "guitar", "rocket", "tree", "ramen" };
+
+template <class T>
+void appendNumber(std::string& out, T value) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), value);
+    out.append(buf, res.ptr);
+}
+}
+
+FakeIrcConfig FakeIrcConfig::fromJson(const nlohmann::json& j) {
+    FakeIrcConfig cfg;
+    cfg.enabled = j.value("enabled", cfg.enabled);
+    cfg.port = j.value("port", cfg.port);
+    cfg.linesPerSecond = j.value("lines_per_second", cfg.linesPerSecond);
+    cfg.channels = j.value("channels", cfg.channels);
+    cfg.chatters = std::max<size_t>(j.value("chatters", cfg.chatters), 1);
+    cfg.channelPrefix = j.value("channel_prefix", cfg.channelPrefix);
+    cfg.replayFile = j.value("replay_file", cfg.replayFile);
+    cfg.pingInterval = std::chrono::seconds(j.value("ping_interval_s", static_cast<int>(cfg.pingInterval.count())));
+    cfg.reportInterval = std::chrono::seconds(std::max(j.value("report_interval_s", static_cast<int>(cfg.reportInterval.count())), 1));
+    cfg.maxBacklogBytes = j.value("max_backlog_bytes", cfg.maxBacklogBytes);
+    return cfg;
+}
+
+// One bot connection. Everything runs on the server's single thread.
+class FakeTwitchServer::Connection : public std::enable_shared_from_this<Connection> {
+public:
+    Connection(FakeTwitchServer& server, tcp::socket socket)
+        : m_server(server), m_socket(std::move(socket)) {}
+
+    void start() { doRead(); }
+
+    void close() {
+        if (m_closed) return;
+        m_closed = true;
+        boost::system::error_code ec;
+        m_socket.shutdown(tcp::socket::shutdown_both, ec);
+        m_socket.close(ec);
+        m_server.onClosed(this);
+    }
+
+    // Lines are appended here and written in one batch per flush
+    std::string& pending() { return m_pending; }
+    size_t backlog() const { return m_pending.size() + m_inflight.size(); }
+
+    void write(std::string_view line) {
+        m_pending.append(line);
+        flush();
+    }
+
+    void flush() {
+        if (m_writing || m_closed || m_pending.empty()) return;
+        m_inflight.clear();
+        m_inflight.swap(m_pending);
+        m_writing = true;
+        boost::asio::async_write(m_socket, boost::asio::buffer(m_inflight),
+            [self = shared_from_this()](boost::system::error_code ec, std::size_t) {
+                self->m_writing = false;
+                if (ec) {
+                    self->close();
+                    return;
+                }
+                self->flush();
+            });
+    }
+
+private:
+    void doRead() {
+        m_socket.async_read_some(m_framer.prepare(),
+            [self = shared_from_this()](boost::system::error_code ec, std::size_t bytes) {
+                if (ec) {
+                    self->close();
+                    return;
+                }
+                self->m_framer.commit(bytes);
+                self->m_framer.consumeLines([&self](std::string_view line) {
+                    self->handleLine(line);
+                });
+                if (!self->m_closed) self->doRead();
+            });
+    }
+
+    void handleLine(std::string_view line) {
+        if (!parseIrcLine(line, m_message)) return;
+        const IrcMessage& irc = m_message;
+
+        if (irc.command == "CAP") {
+            // CAP REQ :caps -> acknowledge everything that was asked for
+            m_reply = ":tmi.twitch.tv CAP * ACK :";
+            m_reply.append(irc.trailing);
+            m_reply += "\r\n";
+            write(m_reply);
+        }
+        else if (irc.command == "PASS") {
+            // Any token is accepted
+        }
+        else if (irc.command == "NICK") {
+            m_nick.assign(irc.channel());
+            m_reply.clear();
+            for (const char* numeric : { "001", "002", "003", "004", "375", "372", "376" }) {
+                m_reply += ":tmi.twitch.tv ";
+                m_reply += numeric;
+                m_reply += ' ';
+                m_reply += m_nick;
+                m_reply += " :-\r\n";
+            }
+            write(m_reply);
+        }
+        else if (irc.command == "JOIN" || irc.command == "PART") {
+            bool join = irc.command == "JOIN";
+            std::string_view list = irc.channel();
+            while (!list.empty()) {
+                size_t comma = list.find(',');
+                std::string_view channel = list.substr(0, comma);
+                list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+                if (channel.empty()) continue;
+
+                m_reply = ":" + m_nick + "!" + m_nick + "@" + m_nick + ".tmi.twitch.tv ";
+                m_reply.append(irc.command);
+                m_reply += ' ';
+                m_reply.append(channel);
+                m_reply += "\r\n";
+                write(m_reply);
+
+                if (join) m_server.onJoin(shared_from_this(), channel);
+                else m_server.onPart(this, channel);
+            }
+        }
+        else if (irc.command == "PING") {
+            m_reply = ":tmi.twitch.tv PONG tmi.twitch.tv :";
+            m_reply.append(irc.hasTrailing ? irc.trailing : irc.channel());
+            m_reply += "\r\n";
+            write(m_reply);
+        }
+        else if (irc.command == "QUIT") {
+            close();
+        }
+        // PONG and PRIVMSG from the bot need no answer
+    }
+
+    FakeTwitchServer& m_server;
+    tcp::socket m_socket;
+    LineFramer m_framer;
+    IrcMessage m_message;
+    std::string m_nick;
+    std::string m_reply;
+    std::string m_pending;
+    std::string m_inflight;
+    bool m_writing = false;
+    bool m_closed = false;
+};
+
+FakeTwitchServer::FakeTwitchServer(const FakeIrcConfig& cfg)
+    : m_config(cfg),
+    m_acceptor(m_io),
+    m_tickTimer(m_io),
+    m_pingTimer(m_io) {}
+
+FakeTwitchServer::~FakeTwitchServer() {
+    stop();
+}
+
+void FakeTwitchServer::start() {
+    loadReplay();
+
+    tcp::endpoint endpoint(boost::asio::ip::make_address("127.0.0.1"), m_config.port);
+    m_acceptor.open(endpoint.protocol());
+    m_acceptor.set_option(boost::asio::socket_base::reuse_address(true));
+    m_acceptor.bind(endpoint);
+    m_acceptor.listen();
+
+    m_lastTick = m_lastReport = std::chrono::steady_clock::now();
+    doAccept();
+    scheduleTick();
+    schedulePing();
+
+    std::cout << "[FAKEIRC] Listening on 127.0.0.1:" << m_config.port
+        << ", " << m_config.linesPerSecond << " lines/s over " << m_config.channels << " channels\n";
+    m_thread = std::thread([this]() { m_io.run(); });
+}
+
+void FakeTwitchServer::stop() {
+    if (!m_thread.joinable()) return;
+    m_io.stop();
+    m_thread.join();
+}
+
+void FakeTwitchServer::loadReplay() {
+    if (m_config.replayFile.empty()) return;
+
+    std::ifstream in(m_config.replayFile);
+    if (!in.is_open()) {
+        std::cerr << "[FAKEIRC] Could not open replay file " << m_config.replayFile
+            << ", using synthetic chat\n";
+        return;
+    }
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+        size_t tab = line.find('\t');
+        if (tab == std::string::npos) m_replay.push_back({ "", line });
+        else m_replay.push_back({ line.substr(0, tab), line.substr(tab + 1) });
+    }
+    std::cout << "[FAKEIRC] Replaying " << m_replay.size() << " messages from " << m_config.replayFile << "\n";
+}
+
+void FakeTwitchServer::doAccept() {
+    m_acceptor.async_accept([this](boost::system::error_code ec, tcp::socket socket) {
+        if (ec) {
+            if (ec != boost::asio::error::operation_aborted) {
+                std::cerr << "[FAKEIRC] Accept error: " << ec.message() << "\n";
+                doAccept();
+            }
+            return;
+        }
+        socket.set_option(tcp::no_delay(true));
+        auto conn = std::make_shared<Connection>(*this, std::move(socket));
+        m_connections.push_back(conn);
+        conn->start();
+        doAccept();
+    });
+}
+
+void FakeTwitchServer::onJoin(const std::shared_ptr<Connection>& conn, std::string_view channel) {
+    for (auto& joined : m_channels) {
+        if (joined.channel == channel) {
+            joined.owner = conn; // a reconnecting bot takes the channel over
+            return;
+        }
+    }
+    m_channels.push_back({ std::string(channel), conn });
+}
+
+void FakeTwitchServer::onPart(const Connection* conn, std::string_view channel) {
+    m_channels.erase(std::remove_if(m_channels.begin(), m_channels.end(), [&](const Joined& joined) {
+        return joined.channel == channel && joined.owner.lock().get() == conn;
+    }), m_channels.end());
+}
+
+void FakeTwitchServer::onClosed(const Connection* conn) {
+    m_channels.erase(std::remove_if(m_channels.begin(), m_channels.end(), [&](const Joined& joined) {
+        auto owner = joined.owner.lock();
+        return !owner || owner.get() == conn;
+    }), m_channels.end());
+    m_connections.erase(std::remove_if(m_connections.begin(), m_connections.end(),
+        [conn](const std::shared_ptr<Connection>& c) { return c.get() == conn; }), m_connections.end());
+}
+
+void FakeTwitchServer::scheduleTick() {
+    // A short period keeps bursts small; each tick writes one batch per connection
+    m_tickTimer.expires_after(std::chrono::milliseconds(2));
+    m_tickTimer.async_wait([this](boost::system::error_code ec) {
+        if (ec) return;
+        tick();
+        scheduleTick();
+    });
+}
+
+void FakeTwitchServer::tick() {
+    auto now = std::chrono::steady_clock::now();
+    double elapsed = std::chrono::duration<double>(now - m_lastTick).count();
+    m_lastTick = now;
+
+    // Never try to catch up more than 100ms after a stall
+    m_due = std::min(m_due + elapsed * m_config.linesPerSecond, m_config.linesPerSecond * 0.1);
+    size_t lines = static_cast<size_t>(m_due);
+    m_due -= static_cast<double>(lines);
+
+    if (!m_channels.empty()) {
+        for (size_t i = 0; i < lines; ++i) {
+            const Joined& joined = m_channels[m_nextChannel++ % m_channels.size()];
+            auto owner = joined.owner.lock();
+            if (!owner || owner->backlog() > m_config.maxBacklogBytes) {
+                ++m_dropped;
+                continue;
+            }
+            appendLine(owner->pending(), joined.channel);
+            ++m_generated;
+        }
+        for (auto& conn : m_connections) conn->flush();
+    }
+
+    if (now - m_lastReport >= m_config.reportInterval) report();
+}
+
+void FakeTwitchServer::schedulePing() {
+    if (m_config.pingInterval.count() <= 0) return;
+    m_pingTimer.expires_after(m_config.pingInterval);
+    m_pingTimer.async_wait([this](boost::system::error_code ec) {
+        if (ec) return;
+        for (auto& conn : m_connections) conn->write("PING :tmi.twitch.tv\r\n");
+        schedulePing();
+    });
+}
+
+void FakeTwitchServer::appendLine(std::string& out, const std::string& channel) {
+    std::string_view user;
+    std::string_view text;
+    char userBuf[32];
+
+    if (!m_replay.empty()) {
+        const Message& msg = m_replay[m_replayPos++ % m_replay.size()];
+        user = msg.user;
+        text = msg.text;
+    }
+    else {
+        // Mostly chatter, with the repeats and commands real chat has
+        uint32_t roll = m_rng() % 100;
+        if (roll < 5) {
+            m_text = "!guess ";
+            m_text += kWords[m_rng() % kWords.size()];
+            text = m_text;
+        }
+        else if (roll < 6) text = "!join";
+        else if (roll < 36) text = kEmotes[m_rng() % kEmotes.size()];
+        else text = kPhrases[m_rng() % kPhrases.size()];
+    }
+
+    if (user.empty()) {
+        auto res = std::to_chars(userBuf + 4, userBuf + sizeof(userBuf), m_rng() % m_config.chatters);
+        std::copy_n("user", 4, userBuf);
+        user = std::string_view(userBuf, res.ptr - userBuf);
+    }
+
+    // Logins are the lowercase display name
+    m_login.assign(user);
+    std::transform(m_login.begin(), m_login.end(), m_login.begin(),
+        [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    auto wallMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+
+    out += "@badge-info=;badges=;color=#1E90FF;display-name=";
+    out.append(user);
+    out += ";emotes=;first-msg=0;flags=;id=";
+    appendNumber(out, ++m_messageId);
+    out += ";mod=0;room-id=1;subscriber=0;tmi-sent-ts=";
+    appendNumber(out, wallMs);
+    out += ";turbo=0;user-id=1;user-type=;";
+    out.append(IngestStats::kSentTag);
+    out += '=';
+    appendNumber(out, IngestStats::nowNs());
+    out += " :";
+    out += m_login;
+    out += '!';
+    out += m_login;
+    out += '@';
+    out += m_login;
+    out += ".tmi.twitch.tv PRIVMSG ";
+    out += channel;
+    out += " :";
+    out.append(text);
+    out += "\r\n";
+}
+
+void FakeTwitchServer::report() {
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - m_lastReport).count();
+    m_lastReport = now;
+
+    IngestStats::Snapshot snap = IngestStats::takeAndReset();
+    auto us = [](std::chrono::nanoseconds ns) { return ns.count() / 1000; };
+
+    std::cout << "[FAKEIRC] generated " << static_cast<uint64_t>(m_generated / seconds) << "/s"
+        << ", ingested " << static_cast<uint64_t>(snap.count / seconds) << "/s"
+        << ", dropped " << m_dropped
+        << ", latency p50 " << us(snap.p50) << "us p99 " << us(snap.p99) << "us max " << us(snap.max) << "us"
+        << ", " << m_channels.size() << " channels on " << m_connections.size() << " connections\n";
+    m_generated = 0;
+    m_dropped = 0;
+}
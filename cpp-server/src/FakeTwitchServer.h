@@ -0,0 +1,100 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Settings for the local IRC stand-in, read from the "FAKE_IRC" block of
+// config.json. Channels are named #<channelPrefix><n>.
+struct FakeIrcConfig {
+    bool enabled = false;
+    uint16_t port = 16667;
+    double linesPerSecond = 1000;   // total across all channels
+    size_t channels = 10;
+    size_t chatters = 5000;         // distinct synthetic usernames
+    std::string channelPrefix = "fake";
+    std::string replayFile;         // one message per line, optional "user<TAB>text"
+    std::chrono::seconds pingInterval{ 60 };
+    std::chrono::seconds reportInterval{ 1 };
+    size_t maxBacklogBytes = 8 * 1024 * 1024; // per connection, lines beyond it are dropped
+
+    std::string channelName(size_t index) const { return "#" + channelPrefix + std::to_string(index); }
+
+    static FakeIrcConfig fromJson(const nlohmann::json& j);
+};
+
+// Minimal Twitch IRC server for offline ingest benchmarks. It speaks the
+// CAP/PASS/NICK/JOIN/PART/PING/PRIVMSG subset a TwitchClient needs and,
+// once channels are joined, generates chat at a fixed rate spread over them.
+// Every line carries the usual Twitch tags plus an x-guessio-sent-ns stamp
+// so the bot side can measure end-to-end ingest latency (see IngestStats).
+//
+// Runs on its own io_context and thread so generation doesn't compete with
+// the game's executor pool for scheduling.
+class FakeTwitchServer {
+public:
+    explicit FakeTwitchServer(const FakeIrcConfig& cfg);
+    ~FakeTwitchServer();
+
+    void start();
+    void stop();
+
+private:
+    class Connection;
+    friend class Connection;
+
+    struct Message {
+        std::string user; // empty: pick a synthetic chatter
+        std::string text;
+    };
+
+    void loadReplay();
+    void doAccept();
+    void scheduleTick();
+    void tick();
+    void schedulePing();
+    void report();
+
+    void onJoin(const std::shared_ptr<Connection>& conn, std::string_view channel);
+    void onPart(const Connection* conn, std::string_view channel);
+    void onClosed(const Connection* conn);
+
+    // Appends one tagged PRIVMSG for `channel` to `out`
+    void appendLine(std::string& out, const std::string& channel);
+
+    FakeIrcConfig m_config;
+    boost::asio::io_context m_io;
+    boost::asio::ip::tcp::acceptor m_acceptor;
+    boost::asio::steady_timer m_tickTimer;
+    boost::asio::steady_timer m_pingTimer;
+    std::thread m_thread;
+
+    std::vector<Message> m_replay;
+    size_t m_replayPos = 0;
+
+    struct Joined {
+        std::string channel;
+        std::weak_ptr<Connection> owner;
+    };
+
+    // Joined channels in round-robin order
+    std::vector<Joined> m_channels;
+    std::vector<std::shared_ptr<Connection>> m_connections;
+    size_t m_nextChannel = 0;
+
+    std::mt19937 m_rng{ 12345 }; // fixed seed, runs are reproducible
+    std::chrono::steady_clock::time_point m_lastTick;
+    std::chrono::steady_clock::time_point m_lastReport;
+    double m_due = 0;
+    uint64_t m_messageId = 0;
+    uint64_t m_generated = 0;
+    uint64_t m_dropped = 0;
+    std::string m_login; // scratch buffers reused for every line
+    std::string m_text;
+};
@@ -1,11 +1,269 @@
 #include "GameProtocol.h"
+#include "MessageFormat.h"
+#include <algorithm>
+#include <array>
+#include <cctype>
 #include <iostream>
 
-void GameProtocol::handleCommand(const std::string& msg, Player& player) {
-    // TODO: parse command string (JOIN, GUESS, DRAW, etc.)
-    // Update player state / scores
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+namespace {
+// Used when the drawer lets the choose timer run out
+const std::array<const char*, 16> kFallbackWords = {
+    "cat", "house", "pizza", "dragon", "guitar", "rocket", "tree", "ramen",
+    "bicycle", "castle", "penguin", "volcano", "umbrella", "lighthouse", "sushi", "robot"
+};
+
+constexpr MessageTemplate<1> kSystemMsg{ R"({"type":"system","payload":$})" };
+constexpr MessageTemplate<3> kRoundChooseMsg{ R"({"type":"round_choose","payload":{"round":$,"drawer":$,"ms":$}})" };
+constexpr MessageTemplate<1> kRoundWordMsg{ R"({"type":"round_word","payload":{"word":$}})" };
+constexpr MessageTemplate<4> kRoundStartMsg{ R"({"type":"round_start","payload":{"round":$,"drawer":$,"hint":$,"ms":$}})" };
+constexpr MessageTemplate<2> kRoundHintMsg{ R"({"type":"round_hint","payload":{"hint":$,"ms":$}})" };
+constexpr MessageTemplate<6> kRoundEndMsg{
+    R"({"type":"round_end","payload":{"round":$,"drawer":$,"word":$,"winner":$,"points":$,"ms":$}})" };
+constexpr MessageTemplate<0> kRoundOverMsg{ R"({"type":"round_end","payload":"Round finished!"})" };
+
+constexpr char kHiddenTail = '\x01'; // continuation byte of a hidden UTF-8 letter
+
+bool isContinuation(char c) {
+    return (static_cast<unsigned char>(c) & 0xC0) == 0x80;
+}
+
+bool isHiddenCell(char c) {
+    // Spaces and punctuation in the word are shown from the start
+    auto u = static_cast<unsigned char>(c);
+    return u >= 0x80 || std::isalnum(u);
+}
+}
+
+RoundConfig RoundConfig::fromJson(const json& j) {
+    RoundConfig cfg;
+    cfg.chooseTime = std::chrono::seconds(j.value("choose_seconds", static_cast<int>(cfg.chooseTime.count())));
+    cfg.drawTime = std::chrono::seconds(std::max(j.value("draw_seconds", static_cast<int>(cfg.drawTime.count())), 1));
+    cfg.intermission = std::chrono::seconds(j.value("intermission_seconds", static_cast<int>(cfg.intermission.count())));
+    cfg.hints = std::max(j.value("hints", cfg.hints), 0);
+    cfg.maxGuessPoints = j.value("max_guess_points", cfg.maxGuessPoints);
+    cfg.minGuessPoints = j.value("min_guess_points", cfg.minGuessPoints);
+    cfg.drawerPoints = j.value("drawer_points", cfg.drawerPoints);
+    return cfg;
+}
+
+GameProtocol::GameProtocol(RoundScheduler& scheduler, const RoundConfig& config, std::function<void()> onTimer)
+    : m_scheduler(scheduler),
+    m_timer(std::move(onTimer)),
+    m_config(config),
+    m_rng(std::random_device{}()) {}
+
+GameProtocol::~GameProtocol() {
+    m_scheduler.cancel(m_timer);
+}
+
+void GameProtocol::scheduleIn(Clock::duration delay) {
+    m_phaseEnd = Clock::now() + delay;
+    m_scheduler.schedule(m_timer, delay);
+}
+
+Clock::time_point GameProtocol::hintAt(int n) const {
+    // Hints split the drawing time evenly
+    return m_phaseStart + std::chrono::milliseconds(m_config.drawTime) * n / (m_config.hints + 1);
+}
+
+int GameProtocol::remainingMs() const {
+    auto left = std::chrono::duration_cast<std::chrono::milliseconds>(m_phaseEnd - Clock::now()).count();
+    return left > 0 ? static_cast<int>(left) : 0;
+}
+
+std::string_view GameProtocol::defaultWord() {
+    return kFallbackWords[m_rng() % kFallbackWords.size()];
+}
+
+void GameProtocol::start(const std::vector<std::string>& drawers, Outbox& out) {
+    if (m_phase != RoundPhase::Idle) return;
+    m_round = 0;
+    m_guessMatcher.clear();
+    beginChoosing(drawers, out);
+}
+
+void GameProtocol::stop(Outbox& out) {
+    m_scheduler.cancel(m_timer);
+    if (m_phase == RoundPhase::Idle) return;
+    m_phase = RoundPhase::Idle;
+    m_drawer.clear();
+    m_word.clear();
+    m_guessMatcher.clear();
+    out.push_back({ kSystemMsg.str("Game stopped"), "" });
+}
+
+void GameProtocol::beginChoosing(const std::vector<std::string>& drawers, Outbox& out) {
+    if (drawers.empty()) {
+        // Nobody left who can draw; wait for start_game again
+        m_scheduler.cancel(m_timer);
+        m_phase = RoundPhase::Idle;
+        m_drawer.clear();
+        out.push_back({ kSystemMsg.str("Game paused, no one left to draw"), "" });
+        return;
+    }
+
+    // Next in rotation after the previous drawer
+    auto it = std::find(drawers.begin(), drawers.end(), m_drawer);
+    m_drawer = (it == drawers.end() || ++it == drawers.end()) ? drawers.front() : *it;
+
+    ++m_round;
+    m_phase = RoundPhase::Choosing;
+    m_word.clear();
+    m_hint.clear();
+    m_guessMatcher.clear();
+    scheduleIn(m_config.chooseTime);
+
+    out.push_back({ kRoundChooseMsg.str(m_round, m_drawer, remainingMs()), "" });
+}
+
+void GameProtocol::beginDrawing(std::string_view word, Outbox& out) {
+    m_phase = RoundPhase::Drawing;
+    m_word.assign(word);
+    m_guessMatcher.setTarget(word);
+    m_hintsShown = 0;
+
+    m_hint = m_word;
+    for (size_t i = 0; i < m_hint.size(); ++i) {
+        if (isContinuation(m_word[i])) m_hint[i] = kHiddenTail;
+        else if (isHiddenCell(m_word[i])) m_hint[i] = '_';
+    }
+
+    m_phaseStart = Clock::now();
+    m_phaseEnd = m_phaseStart + m_config.drawTime;
+    // First wake-up is the first hint, or the end of the round without hints
+    m_scheduler.schedule(m_timer, (m_config.hints > 0 ? hintAt(1) : m_phaseEnd) - m_phaseStart);
+
+    out.push_back({ kRoundWordMsg.str(m_word), m_drawer });
+    out.push_back({ kRoundStartMsg.str(m_round, m_drawer, hintText(), remainingMs()), "" });
+}
+
+void GameProtocol::finishRound(const std::string* winner, int points, Outbox& out) {
+    m_phase = RoundPhase::Intermission;
+    m_guessMatcher.clear();
+    scheduleIn(m_config.intermission);
+
+    out.push_back({ kRoundEndMsg.str(m_round, m_drawer, m_word, winner, points, remainingMs()), "" });
+}
+
+void GameProtocol::onTimer(const std::vector<std::string>& drawers, Outbox& out) {
+    // A wake-up posted before the last transition is stale
+    auto now = Clock::now();
+    if (m_phase == RoundPhase::Idle) return;
+    if (m_phase == RoundPhase::Drawing) {
+        bool hintDue = m_hintsShown < m_config.hints;
+        if (now + m_scheduler.resolution() < (hintDue ? hintAt(m_hintsShown + 1) : m_phaseEnd)) return;
+
+        if (hintDue) {
+            revealLetter();
+            ++m_hintsShown;
+            auto next = m_hintsShown < m_config.hints ? hintAt(m_hintsShown + 1) : m_phaseEnd;
+            m_scheduler.schedule(m_timer, next - now);
+            out.push_back({ kRoundHintMsg.str(hintText(), remainingMs()), "" });
+            return;
+        }
+        finishRound(nullptr, 0, out);
+        return;
+    }
+
+    if (now + m_scheduler.resolution() < m_phaseEnd) return;
+    if (m_phase == RoundPhase::Choosing) {
+        std::string_view word = m_wordPicker ? m_wordPicker() : std::string_view();
+        beginDrawing(word.empty() ? defaultWord() : word, out);
+    }
+    else {
+        beginChoosing(drawers, out);
+    }
+}
+
+void GameProtocol::endRound(Outbox& out) {
+    if (m_phase == RoundPhase::Idle) {
+        out.push_back({ kRoundOverMsg.str(), "" });
+        return;
+    }
+    if (m_phase == RoundPhase::Choosing || m_phase == RoundPhase::Drawing) finishRound(nullptr, 0, out);
+}
+
+void GameProtocol::drawerLeft(const std::string& username, Outbox& out) {
+    if (username != m_drawer) return;
+    if (m_phase == RoundPhase::Choosing || m_phase == RoundPhase::Drawing) {
+        std::cout << "[ROUND] Drawer " << username << " left, ending round " << m_round << "\n";
+        finishRound(nullptr, 0, out);
+    }
+}
+
+bool GameProtocol::setWord(const std::string& username, const std::string& word, Outbox& out) {
+    if (m_phase == RoundPhase::Idle) {
+        // No game running: the streamer sets the word by hand
+        if (word.empty()) m_guessMatcher.clear();
+        else m_guessMatcher.setTarget(word);
+        return true;
+    }
+    if (m_phase != RoundPhase::Choosing || username != m_drawer || word.empty()) return false;
+    beginDrawing(word, out);
+    return true;
+}
+
+GuessResult GameProtocol::guess(const std::string& username, std::string_view normalized,
+    PlayerTable& players, Outbox& out, std::string* word,
+    std::vector<ScoreChange>* scored) {
+    if (m_phase == RoundPhase::Idle) {
+        GuessResult result = m_guessMatcher.check(normalized);
+        if (result == GuessResult::Exact) {
+            if (word) *word = m_guessMatcher.target();
+            // First correct guess wins, later ones are just chat
+            m_guessMatcher.clear();
+        }
+        return result;
+    }
+
+    if (m_phase != RoundPhase::Drawing || username == m_drawer) return GuessResult::Miss;
+    GuessResult result = m_guessMatcher.check(normalized);
+    if (result != GuessResult::Exact) return result;
+
+    // Faster guesses score more
+    auto total = std::chrono::duration_cast<std::chrono::milliseconds>(m_config.drawTime).count();
+    int points = static_cast<int>(m_config.maxGuessPoints * static_cast<int64_t>(remainingMs()) / std::max<int64_t>(total, 1));
+    points = std::max(points, m_config.minGuessPoints);
+
+    auto award = [&](const std::string& name, int amount) {
+        PlayerTable::Id id = players.find(name);
+        if (id == PlayerTable::kNone) return;
+        int total = players.addScore(id, amount);
+        if (scored) scored->push_back({ name, amount, total });
+    };
+    award(username, points);
+    award(m_drawer, m_config.drawerPoints);
+
+    if (word) *word = m_word;
+    finishRound(&username, points, out);
+    return result;
+}
+
+void GameProtocol::revealLetter() {
+    // Candidates are hidden letters; never give away the last one
+    thread_local std::vector<size_t> hidden;
+    hidden.clear();
+    for (size_t i = 0; i < m_hint.size(); ++i) {
+        if (m_hint[i] == '_' && m_word[i] != '_') hidden.push_back(i);
+    }
+    if (hidden.size() <= 1) return;
+
+    size_t pos = hidden[m_rng() % hidden.size()];
+    m_hint[pos] = m_word[pos];
+    for (size_t i = pos + 1; i < m_word.size() && isContinuation(m_word[i]); ++i) m_hint[i] = m_word[i];
 }
 
-void GameProtocol::broadcast(const std::string& msg) {
-    // TODO: call server.broadcast(msg)
+std::string GameProtocol::hintText() const {
+    // One cell per letter, separated by spaces: "c _ _"
+    std::string text;
+    text.reserve(m_hint.size() * 2);
+    for (char c : m_hint) {
+        if (c == kHiddenTail) continue;
+        if (!isContinuation(c) && !text.empty()) text += ' ';
+        text += c;
+    }
+    return text;
 }
@@ -1,17 +1,114 @@
 #pragma once
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <random>
 #include <string>
-#include <unordered_map>
+#include <string_view>
+#include <vector>
+#include <nlohmann/json.hpp>
+#include "GuessEngine.h"
+#include "PlayerTable.h"
+#include "RoundScheduler.h"
 
-struct Player {
-    std::string username;
-    int score = 0;
+// Round timings and scoring, read from the "ROUNDS" block of config.json
+struct RoundConfig {
+    std::chrono::seconds chooseTime{ 15 };   // drawer picks a word
+    std::chrono::seconds drawTime{ 80 };     // chat guesses
+    std::chrono::seconds intermission{ 5 };  // scores shown before the next round
+    int hints = 2;                           // letters revealed while drawing
+    int maxGuessPoints = 100;                // for a guess right at the start
+    int minGuessPoints = 10;
+    int drawerPoints = 5;                    // per correct guess on their drawing
+
+    static RoundConfig fromJson(const nlohmann::json& j);
+};
+
+enum class RoundPhase : uint8_t {
+    Idle,        // no game; set_word/end_round keep their manual meaning
+    Choosing,
+    Drawing,
+    Intermission
 };
 
+// Round state machine for one room:
+//   Idle -> Choosing -> Drawing -> Intermission -> Choosing ...
+// Drawers rotate through the players that have a browser session in the
+// room. Phase deadlines and hint reveals run off one RoundScheduler timer.
+//
+// Not thread safe: the owning Room calls it with its lock held. Messages to
+// send are appended to an Outbox that the room delivers after unlocking.
 class GameProtocol {
 public:
-    void handleCommand(const std::string& msg, Player& player);
-    void broadcast(const std::string& msg);
+    struct Outgoing {
+        std::string text;
+        std::string onlyTo; // username, empty for the whole room
+    };
+    using Outbox = std::vector<Outgoing>;
+    // Points a correct guess awarded; `total` is the player's new score
+    struct ScoreChange {
+        std::string username;
+        int points;
+        int total;
+    };
+    using WordPicker = std::function<std::string_view()>;
+
+    // `onTimer` is posted to the room executor; it must end up in onTimer()
+    GameProtocol(RoundScheduler& scheduler, const RoundConfig& config, std::function<void()> onTimer);
+    ~GameProtocol();
+
+    GameProtocol(const GameProtocol&) = delete;
+    GameProtocol& operator=(const GameProtocol&) = delete;
+
+    // Word used when the drawer doesn't pick one in time
+    void setWordPicker(WordPicker picker) { m_wordPicker = std::move(picker); }
+
+    RoundPhase phase() const { return m_phase; }
+    uint32_t round() const { return m_round; }
+    // Rounds played before a restart, so numbering carries on; idle only
+    void resumeRounds(uint32_t played) { if (m_phase == RoundPhase::Idle) m_round = played; }
+    const std::string& drawer() const { return m_drawer; }
+
+    // `drawers` are usernames with a session in the room, in a stable order
+    void start(const std::vector<std::string>& drawers, Outbox& out);
+    void stop(Outbox& out);
+    void onTimer(const std::vector<std::string>& drawers, Outbox& out);
+    // Drawer gave up or the streamer ended it by hand
+    void endRound(Outbox& out);
+    void drawerLeft(const std::string& username, Outbox& out);
+
+    // Returns false if `username` may not set the word right now
+    bool setWord(const std::string& username, const std::string& word, Outbox& out);
+    // `normalized` comes from normalizeGuess(); `word` is filled on an exact hit
+    // and `scored` gets every score it changed
+    GuessResult guess(const std::string& username, std::string_view normalized,
+        PlayerTable& players, Outbox& out, std::string* word,
+        std::vector<ScoreChange>* scored = nullptr);
 
 private:
-    std::unordered_map<int, Player> players_;
+    void beginChoosing(const std::vector<std::string>& drawers, Outbox& out);
+    void beginDrawing(std::string_view word, Outbox& out);
+    void finishRound(const std::string* winner, int points, Outbox& out);
+    void revealLetter();
+    void scheduleIn(std::chrono::steady_clock::duration delay);
+    std::string hintText() const;
+    int remainingMs() const;
+    std::chrono::steady_clock::time_point hintAt(int n) const;
+    std::string_view defaultWord();
+
+    RoundScheduler& m_scheduler;
+    RoundScheduler::Timer m_timer;
+    RoundConfig m_config;
+    WordPicker m_wordPicker;
+    std::minstd_rand m_rng;
+
+    RoundPhase m_phase = RoundPhase::Idle;
+    uint32_t m_round = 0;
+    std::string m_drawer;
+    std::string m_word;          // as the drawer picked it
+    std::string m_hint;          // m_word with unrevealed letters as '_'
+    int m_hintsShown = 0;
+    std::chrono::steady_clock::time_point m_phaseStart;
+    std::chrono::steady_clock::time_point m_phaseEnd;
+    GuessMatcher m_guessMatcher;
 };
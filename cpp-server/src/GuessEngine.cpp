@@ -0,0 +1,187 @@
+#include "GuessEngine.h"
+#include <algorithm>
+#include <cstdlib>
+#include <vector>
+
+// Base letter for U+00C0..U+017F (Latin-1 Supplement and Latin Extended-A),
+// 0 for characters that are not letters with a plain ASCII base.
+static const char kLatinFold[] =
+    // U+00C0 - U+00FF
+    "aaaaaaaceeeeiiii" "dnooooo\0ouuuuyts"
+    "aaaaaaaceeeeiiii" "dnooooo\0ouuuuyty"
+    // U+0100 - U+017F
+    "aaaaaaccccccccdd" "ddeeeeeeeeeegggg"
+    "gggghhhhiiiiiiii" "iiiijjkkklllllll"
+    "lllnnnnnnnnnoooo" "oooorrrrrrssssss"
+    "ssttttttuuuuuuuu" "uuuuwwyyyzzzzzzs";
+
+static void appendFolded(uint32_t cp, std::string& out, bool& pendingSpace) {
+    char c = 0;
+    if (cp < 0x80) {
+        if (cp >= 'A' && cp <= 'Z') c = static_cast<char>(cp - 'A' + 'a');
+        else if ((cp >= 'a' && cp <= 'z') || (cp >= '0' && cp <= '9')) c = static_cast<char>(cp);
+        else if (cp == ' ' || cp == '\t' || cp == '\n' || cp == '\r' || cp == '-' || cp == '_') {
+            pendingSpace = !out.empty();
+            return;
+        }
+        else return; // other punctuation carries no meaning in a guess
+    }
+    else if (cp >= 0xC0 && cp <= 0x17F) {
+        c = kLatinFold[cp - 0xC0];
+        if (cp == 0xDF) { // sharp s
+            if (pendingSpace) out.push_back(' ');
+            pendingSpace = false;
+            out += "ss";
+            return;
+        }
+    }
+
+    if (pendingSpace) out.push_back(' ');
+    pendingSpace = false;
+
+    if (c) {
+        out.push_back(c);
+        return;
+    }
+
+    // Anything else is kept as UTF-8 so non-Latin words still match exactly
+    if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+    else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+void normalizeGuess(std::string_view input, std::string& out) {
+    out.clear();
+    bool pendingSpace = false;
+
+    for (size_t i = 0; i < input.size();) {
+        unsigned char b = static_cast<unsigned char>(input[i]);
+        uint32_t cp;
+        size_t len;
+        if (b < 0x80)               { cp = b; len = 1; }
+        else if ((b >> 5) == 0x6)   { cp = b & 0x1F; len = 2; }
+        else if ((b >> 4) == 0xE)   { cp = b & 0x0F; len = 3; }
+        else if ((b >> 3) == 0x1E)  { cp = b & 0x07; len = 4; }
+        else { ++i; continue; }     // stray continuation byte
+
+        if (i + len > input.size()) break;
+        bool valid = true;
+        for (size_t k = 1; k < len; ++k) {
+            unsigned char cb = static_cast<unsigned char>(input[i + k]);
+            if ((cb & 0xC0) != 0x80) { valid = false; break; }
+            cp = (cp << 6) | (cb & 0x3F);
+        }
+        if (!valid) { ++i; continue; }
+
+        // Combining diacritical marks (decomposed accents) are simply dropped
+        if (!(cp >= 0x300 && cp <= 0x36F)) appendFolded(cp, out, pendingSpace);
+        i += len;
+    }
+}
+
+std::string normalizeGuess(std::string_view input) {
+    std::string out;
+    normalizeGuess(input, out);
+    return out;
+}
+
+void GuessMatcher::setTarget(std::string_view word) {
+    normalizeGuess(word, m_target);
+    m_peq.fill(0);
+
+    size_t m = std::min<size_t>(m_target.size(), 64);
+    for (size_t i = 0; i < m; ++i) {
+        m_peq[static_cast<unsigned char>(m_target[i])] |= uint64_t(1) << i;
+    }
+
+    // Short words need to be nearly right before we call them close
+    if (m_target.size() <= 3) m_closeThreshold = 0;
+    else if (m_target.size() <= 6) m_closeThreshold = 1;
+    else if (m_target.size() <= 12) m_closeThreshold = 2;
+    else m_closeThreshold = 3;
+}
+
+void GuessMatcher::clear() {
+    m_target.clear();
+    m_peq.fill(0);
+    m_closeThreshold = 0;
+}
+
+int GuessMatcher::distance(std::string_view text, int limit) const {
+    const size_t m = m_target.size();
+    if (m > 64) return levenshtein(m_target, text);
+
+    // Myers (1999) / Hyyrö bit-vector edit distance, global alignment
+    const uint64_t last = uint64_t(1) << (m - 1);
+    uint64_t pv = (m == 64) ? ~uint64_t(0) : ((uint64_t(1) << m) - 1);
+    uint64_t mv = 0;
+    int score = static_cast<int>(m);
+    int remaining = static_cast<int>(text.size());
+
+    for (unsigned char c : text) {
+        uint64_t eq = m_peq[c];
+        uint64_t xv = eq | mv;
+        uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+        uint64_t ph = mv | ~(xh | pv);
+        uint64_t mh = pv & xh;
+
+        if (ph & last) ++score;
+        else if (mh & last) --score;
+
+        ph = (ph << 1) | 1;
+        mh <<= 1;
+        pv = mh | ~(xv | ph);
+        mv = ph & xv;
+
+        // The score drops by at most one per remaining character
+        --remaining;
+        if (score - remaining > limit) return score;
+    }
+    return score;
+}
+
+GuessResult GuessMatcher::check(std::string_view guess, int* outDistance) const {
+    if (m_target.empty() || guess.empty()) return GuessResult::Miss;
+
+    if (guess == m_target) {
+        if (outDistance) *outDistance = 0;
+        return GuessResult::Exact;
+    }
+
+    // Length alone rules most guesses out before running the kernel
+    int lengthGap = std::abs(static_cast<int>(guess.size()) - static_cast<int>(m_target.size()));
+    if (lengthGap > m_closeThreshold) return GuessResult::Miss;
+
+    int d = distance(guess, m_closeThreshold);
+    if (outDistance) *outDistance = d;
+    return d <= m_closeThreshold ? GuessResult::Close : GuessResult::Miss;
+}
+
+int levenshtein(std::string_view a, std::string_view b) {
+    std::vector<int> row(b.size() + 1);
+    for (size_t j = 0; j <= b.size(); ++j) row[j] = static_cast<int>(j);
+
+    for (size_t i = 1; i <= a.size(); ++i) {
+        int diag = row[0];
+        row[0] = static_cast<int>(i);
+        for (size_t j = 1; j <= b.size(); ++j) {
+            int up = row[j];
+            int cost = a[i - 1] == b[j - 1] ? 0 : 1;
+            row[j] = std::min({ row[j] + 1, row[j - 1] + 1, diag + cost });
+            diag = up;
+        }
+    }
+    return row[b.size()];
+}
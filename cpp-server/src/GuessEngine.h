@@ -0,0 +1,45 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Folds a guess or a target word into the form they are compared in:
+// lower case, Latin diacritics stripped, punctuation dropped, whitespace
+// collapsed to single spaces and trimmed. `out` is reused to avoid allocating.
+void normalizeGuess(std::string_view input, std::string& out);
+std::string normalizeGuess(std::string_view input);
+
+enum class GuessResult : uint8_t {
+    Miss,
+    Close, // within a few edits of the word
+    Exact
+};
+
+// Matches guesses against one target word. The word is normalised once and
+// its bit masks precomputed, so each guess costs one pass of Myers'
+// bit-parallel edit distance (one 64-bit word for words up to 64 bytes).
+class GuessMatcher {
+public:
+    void setTarget(std::string_view word);
+    void clear();
+    bool hasTarget() const { return !m_target.empty(); }
+    const std::string& target() const { return m_target; }
+
+    // `guess` must already be normalised
+    GuessResult check(std::string_view guess, int* distance = nullptr) const;
+
+    // Largest edit distance that still counts as "close" for this word
+    int closeThreshold() const { return m_closeThreshold; }
+
+private:
+    int distance(std::string_view text, int limit) const;
+
+    std::string m_target;
+    std::array<uint64_t, 256> m_peq{};
+    int m_closeThreshold = 0;
+};
+
+// Plain dynamic programming Levenshtein distance, used for words longer
+// than the 64-bit kernel handles
+int levenshtein(std::string_view a, std::string_view b);
@@ -0,0 +1,255 @@
+#include "Handoff.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+HandoffConfig HandoffConfig::fromJson(const nlohmann::json& j) {
+    HandoffConfig cfg;
+    cfg.enabled = j.value("enabled", cfg.enabled);
+    cfg.path = j.value("path", cfg.path);
+    cfg.drainTimeout = std::chrono::milliseconds(std::max(j.value("drain_ms", static_cast<int>(cfg.drainTimeout.count())), 0));
+    return cfg;
+}
+
+#ifndef _WIN32
+using boost::asio::local::stream_protocol;
+using nlohmann::json;
+
+namespace {
+// Wire format: Header, metadata JSON, blob, then the fds in batches of
+// kFdBatch, each batch riding on one byte. The metadata holds sizes only;
+// queued messages and snapshot images follow it in the blob, in order.
+constexpr char kMagic[8] = { 'G', 'I', 'O', 'H', 'A', 'N', 'D', '1' };
+constexpr char kRequest[] = "TAKEOVER\n";
+constexpr size_t kFdBatch = 200;     // below the kernel's 253 per message
+constexpr int kAckTimeoutSeconds = 30;
+
+struct Header {
+    char magic[8];
+    uint64_t metaSize;
+    uint64_t blobSize;
+    uint32_t fdCount;
+    uint32_t reserved;
+};
+
+void setError(std::string* error, const std::string& message) {
+    if (error) *error = message;
+}
+
+bool sendFds(int socket, const int* fds, size_t count) {
+    char byte = 'F';
+    iovec iov{ &byte, 1 };
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * count));
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(int) * count);
+    std::memcpy(CMSG_DATA(cmsg), fds, sizeof(int) * count);
+    return ::sendmsg(socket, &msg, MSG_NOSIGNAL) == 1;
+}
+
+// Appends what arrived with one batch to `fds`
+bool receiveFds(int socket, std::vector<int>& fds) {
+    char byte = 0;
+    iovec iov{ &byte, 1 };
+    std::vector<char> control(CMSG_SPACE(sizeof(int) * kFdBatch));
+    msghdr msg{};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    if (::recvmsg(socket, &msg, MSG_CMSG_CLOEXEC) != 1 || (msg.msg_flags & MSG_CTRUNC)) return false;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg; cmsg = CMSG_NXTHDR(&msg, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        const unsigned char* data = CMSG_DATA(cmsg);
+        for (size_t i = 0; i < count; ++i) {
+            int fd;
+            std::memcpy(&fd, data + i * sizeof(int), sizeof(int));
+            fds.push_back(fd);
+        }
+    }
+    return true;
+}
+}
+
+HandoffListener::HandoffListener(boost::asio::io_context& io, const std::string& path)
+    : m_path(path), m_acceptor(io), m_peer(io) {
+    // A path left behind by a process that is gone would fail the bind
+    ::unlink(m_path.c_str());
+    stream_protocol::endpoint endpoint(m_path);
+    m_acceptor.open(endpoint.protocol());
+    m_acceptor.bind(endpoint);
+    m_acceptor.listen();
+    std::cout << "[HANDOFF] Waiting for takeover requests on " << m_path << "\n";
+    doAccept();
+}
+
+HandoffListener::~HandoffListener() {
+    boost::system::error_code ignored;
+    m_acceptor.close(ignored);
+    if (!m_handedOver) ::unlink(m_path.c_str());
+}
+
+void HandoffListener::doAccept() {
+    m_acceptor.async_accept(m_peer, [this](boost::system::error_code ec) {
+        if (ec) {
+            if (ec != boost::asio::error::operation_aborted) doAccept();
+            return;
+        }
+        boost::asio::async_read(m_peer, boost::asio::buffer(m_request),
+            [this](boost::system::error_code ec, std::size_t) {
+                if (!ec && std::memcmp(m_request, kRequest, sizeof(m_request)) == 0) {
+                    std::cout << "[HANDOFF] Takeover requested\n";
+                    m_requested.store(true, std::memory_order_release);
+                    return;
+                }
+                boost::system::error_code ignored;
+                m_peer.close(ignored);
+                doAccept();
+            });
+    });
+}
+
+bool HandoffListener::send(const HandoffState& state, std::string* error) {
+    json clients = json::array();
+    std::string blob;
+    std::vector<int> fds{ state.listener };
+    for (auto& client : state.clients) {
+        json sizes = json::array();
+        for (auto& msg : client.queued) {
+            sizes.push_back(msg.size());
+            blob += msg;
+        }
+        clients.push_back({ {"rooms", client.rooms}, {"queued", std::move(sizes)}, {"state", client.needsState} });
+        fds.push_back(client.fd);
+    }
+    json rooms = json::array();
+    for (auto& [name, image] : state.rooms) {
+        rooms.push_back({ name, image.size() });
+        blob += image;
+    }
+    std::string meta = json{ {"clients", std::move(clients)}, {"rooms", std::move(rooms)}, {"routes", state.routes} }
+        .dump(-1, ' ', false, json::error_handler_t::replace);
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.metaSize = meta.size();
+    header.blobSize = blob.size();
+    header.fdCount = static_cast<uint32_t>(fds.size());
+
+    // The fds and the ack go through the socket directly, which asio left non-blocking
+    boost::system::error_code ec;
+    m_peer.native_non_blocking(false, ec);
+    std::array<boost::asio::const_buffer, 3> buffers{
+        boost::asio::buffer(&header, sizeof(header)), boost::asio::buffer(meta), boost::asio::buffer(blob) };
+    boost::asio::write(m_peer, buffers, ec);
+    if (ec) {
+        setError(error, "sending state failed: " + ec.message());
+        return false;
+    }
+    int socket = m_peer.native_handle();
+    for (size_t i = 0; i < fds.size(); i += kFdBatch) {
+        if (!sendFds(socket, fds.data() + i, std::min(kFdBatch, fds.size() - i))) {
+            setError(error, std::string("sending fds failed: ") + std::strerror(errno));
+            return false;
+        }
+    }
+
+    // The new process says so once it serves everything it was given
+    timeval timeout{ kAckTimeoutSeconds, 0 };
+    ::setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    char ack = 0;
+    if (::recv(socket, &ack, 1, 0) != 1 || ack != 'K') {
+        setError(error, "the new process did not confirm the takeover");
+        return false;
+    }
+    m_handedOver = true;
+    std::cout << "[HANDOFF] Handed " << state.clients.size() << " connections and " << state.rooms.size()
+        << " rooms over\n";
+    return true;
+}
+
+bool HandoffReceiver::receive(const std::string& path, HandoffState& state, std::string* error) {
+    boost::system::error_code ec;
+    m_socket.connect(stream_protocol::endpoint(path), ec);
+    if (!ec) boost::asio::write(m_socket, boost::asio::buffer(kRequest, sizeof(kRequest) - 1), ec);
+    Header header{};
+    if (!ec) boost::asio::read(m_socket, boost::asio::buffer(&header, sizeof(header)), ec);
+    if (ec) {
+        setError(error, "no handoff from " + path + ": " + ec.message());
+        return false;
+    }
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.fdCount == 0) {
+        setError(error, path + " sent something that is not a handoff");
+        return false;
+    }
+
+    std::string meta(header.metaSize, '\0');
+    std::string blob(header.blobSize, '\0');
+    std::array<boost::asio::mutable_buffer, 2> buffers{ boost::asio::buffer(meta), boost::asio::buffer(blob) };
+    boost::asio::read(m_socket, buffers, ec);
+    std::vector<int> fds;
+    while (!ec && fds.size() < header.fdCount) {
+        if (!receiveFds(m_socket.native_handle(), fds)) ec = boost::asio::error::connection_aborted;
+    }
+    if (ec || fds.size() != header.fdCount) {
+        for (int fd : fds) ::close(fd);
+        setError(error, "handoff cut short: " + ec.message());
+        return false;
+    }
+
+    // Sizes in the metadata are checked against the blob as it is cut up
+    try {
+        json j = json::parse(meta);
+        size_t offset = 0;
+        auto take = [&](size_t size) {
+            if (size > blob.size() - offset) throw std::runtime_error("blob is short");
+            std::string part = blob.substr(offset, size);
+            offset += size;
+            return part;
+        };
+        const json& clients = j.at("clients");
+        if (clients.size() != fds.size() - 1) throw std::runtime_error("fd count does not match");
+        state.listener = fds[0];
+        for (size_t i = 0; i < clients.size(); ++i) {
+            HandoffState::Client client;
+            client.fd = fds[i + 1];
+            client.rooms = clients[i].at("rooms").get<std::vector<std::pair<std::string, std::string>>>();
+            client.needsState = clients[i].at("state").get<bool>();
+            for (auto& size : clients[i].at("queued")) client.queued.push_back(take(size.get<size_t>()));
+            state.clients.push_back(std::move(client));
+        }
+        for (auto& room : j.at("rooms")) {
+            std::string name = room.at(0).get<std::string>();
+            state.rooms.emplace_back(std::move(name), take(room.at(1).get<size_t>()));
+        }
+        state.routes = j.at("routes").get<std::vector<std::pair<std::string, std::string>>>();
+    }
+    catch (const std::exception& e) {
+        for (int fd : fds) ::close(fd);
+        state = HandoffState();
+        setError(error, std::string("bad handoff state: ") + e.what());
+        return false;
+    }
+    return true;
+}
+
+void HandoffReceiver::acknowledge() {
+    boost::system::error_code ignored;
+    boost::asio::write(m_socket, boost::asio::buffer("K", 1), ignored);
+    m_socket.close(ignored);
+}
+#endif
@@ -0,0 +1,73 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Zero-downtime upgrades, read from the "HANDOFF" block of config.json.
+// The running server listens on a Unix socket at `path`; a new binary
+// started with --takeover connects there and is handed the listening
+// socket, every client connection and the state that goes with them, so
+// clients never see a disconnect. POSIX only (fds travel as SCM_RIGHTS).
+struct HandoffConfig {
+    bool enabled = false;
+    std::string path = "guessio.handoff";
+    std::chrono::milliseconds drainTimeout{ 2000 }; // for writes in flight
+
+    static HandoffConfig fromJson(const nlohmann::json& j);
+};
+
+// Everything that moves from the old process to the new one
+struct HandoffState {
+    struct Client {
+        int fd = -1;
+        std::vector<std::pair<std::string, std::string>> rooms; // room, username
+        std::vector<std::string> queued;                        // not written yet
+        bool needsState = false;                                // a current_state was still queued
+    };
+
+    int listener = -1;
+    std::vector<Client> clients;
+    std::vector<std::pair<std::string, std::string>> rooms;  // room, RoomSnapshot image
+    std::vector<std::pair<std::string, std::string>> routes; // room, channel
+};
+
+#ifndef _WIN32
+// Old process side: waits for one takeover request on the Unix socket
+class HandoffListener {
+public:
+    HandoffListener(boost::asio::io_context& io, const std::string& path);
+    ~HandoffListener();
+
+    bool requested() const { return m_requested.load(std::memory_order_acquire); }
+    // Sends `state` to the new process and waits until it has taken over.
+    // Call with the io_context stopped. The fds stay open here until exit;
+    // closing them then does not touch the connections.
+    bool send(const HandoffState& state, std::string* error = nullptr);
+
+private:
+    void doAccept();
+
+    std::string m_path;
+    boost::asio::local::stream_protocol::acceptor m_acceptor;
+    boost::asio::local::stream_protocol::socket m_peer;
+    char m_request[9];
+    std::atomic<bool> m_requested{ false };
+    bool m_handedOver = false; // the path belongs to the new process now
+};
+
+// New process side: asks the server at `path` to hand over
+class HandoffReceiver {
+public:
+    bool receive(const std::string& path, HandoffState& state, std::string* error = nullptr);
+    // Everything is adopted; the old process may exit
+    void acknowledge();
+
+private:
+    boost::asio::io_context m_io;
+    boost::asio::local::stream_protocol::socket m_socket{ m_io };
+};
+#endif
@@ -0,0 +1,61 @@
+#include "IngestStats.h"
+#include <algorithm>
+
+std::array<std::atomic<uint64_t>, IngestStats::kBuckets> IngestStats::s_histogram{};
+std::atomic<uint64_t> IngestStats::s_max{ 0 };
+
+int64_t IngestStats::nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+size_t IngestStats::bucketFor(uint64_t ns) {
+    // log2 buckets split into 4 sub-buckets, so percentiles are within 25%
+    if (ns < 4) return static_cast<size_t>(ns);
+    int msb = 63;
+    while (!(ns >> msb)) --msb;
+    size_t bucket = (static_cast<size_t>(msb) << 2) | ((ns >> (msb - 2)) & 3);
+    return std::min(bucket, kBuckets - 1);
+}
+
+uint64_t IngestStats::bucketUpperBound(size_t bucket) {
+    if (bucket < 4) return bucket;
+    size_t msb = bucket >> 2;
+    uint64_t sub = bucket & 3;
+    return ((4 + sub + 1) << (msb - 2)) - 1;
+}
+
+void IngestStats::record(int64_t sentNs) {
+    int64_t latency = nowNs() - sentNs;
+    if (latency < 0) latency = 0;
+    uint64_t ns = static_cast<uint64_t>(latency);
+
+    s_histogram[bucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+
+    uint64_t prev = s_max.load(std::memory_order_relaxed);
+    while (ns > prev && !s_max.compare_exchange_weak(prev, ns, std::memory_order_relaxed)) {}
+}
+
+IngestStats::Snapshot IngestStats::takeAndReset() {
+    std::array<uint64_t, kBuckets> counts;
+    Snapshot snap;
+    for (size_t i = 0; i < kBuckets; ++i) {
+        counts[i] = s_histogram[i].exchange(0, std::memory_order_relaxed);
+        snap.count += counts[i];
+    }
+    snap.max = std::chrono::nanoseconds(s_max.exchange(0, std::memory_order_relaxed));
+    if (snap.count == 0) return snap;
+
+    auto percentile = [&](double p) {
+        uint64_t target = static_cast<uint64_t>(p * snap.count);
+        uint64_t seen = 0;
+        for (size_t i = 0; i < kBuckets; ++i) {
+            seen += counts[i];
+            if (seen > target) return std::min(std::chrono::nanoseconds(bucketUpperBound(i)), snap.max);
+        }
+        return snap.max;
+    };
+    snap.p50 = percentile(0.50);
+    snap.p99 = percentile(0.99);
+    return snap;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+
+// End-to-end latency of chat lines from the moment a generator stamped them
+// (x-guessio-sent-ns tag) to the moment a bot connection finished routing
+// them. Only lines carrying the tag are measured, so real Twitch traffic
+// costs one failed tag lookup.
+class IngestStats {
+public:
+    static constexpr std::string_view kSentTag = "x-guessio-sent-ns";
+
+    struct Snapshot {
+        uint64_t count = 0;
+        std::chrono::nanoseconds p50{};
+        std::chrono::nanoseconds p99{};
+        std::chrono::nanoseconds max{};
+    };
+
+    static int64_t nowNs();
+    static void record(int64_t sentNs);
+    // Percentiles since the previous call; resets the counters
+    static Snapshot takeAndReset();
+
+private:
+    static constexpr size_t kBuckets = 256;
+    static size_t bucketFor(uint64_t ns);
+    static uint64_t bucketUpperBound(size_t bucket);
+
+    static std::array<std::atomic<uint64_t>, kBuckets> s_histogram;
+    static std::atomic<uint64_t> s_max;
+};
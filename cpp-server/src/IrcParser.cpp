@@ -0,0 +1,160 @@
+#include "IrcParser.h"
+#include <algorithm>
+#include <cstring>
+
+std::string_view IrcMessage::tag(std::string_view key) const {
+    for (size_t i = 0; i < tagCount; ++i) {
+        if (tagList[i].key == key) return tagList[i].value;
+    }
+    return {};
+}
+
+bool IrcMessage::hasTag(std::string_view key) const {
+    for (size_t i = 0; i < tagCount; ++i) {
+        if (tagList[i].key == key) return true;
+    }
+    return false;
+}
+
+std::string_view IrcMessage::nick() const {
+    size_t bang = prefix.find('!');
+    return bang == std::string_view::npos ? prefix : prefix.substr(0, bang);
+}
+
+bool parseIrcLine(std::string_view line, IrcMessage& out) {
+    out.tags = {};
+    out.prefix = {};
+    out.command = {};
+    out.trailing = {};
+    out.hasTrailing = false;
+    out.tagCount = 0;
+    out.paramCount = 0;
+
+    const char* p = line.data();
+    const char* end = p + line.size();
+
+    auto skipSpaces = [&]() { while (p < end && *p == ' ') ++p; };
+    auto word = [&]() {
+        const char* start = p;
+        while (p < end && *p != ' ') ++p;
+        return std::string_view(start, p - start);
+    };
+
+    // @key=value;key2=value2 ...
+    if (p < end && *p == '@') {
+        ++p;
+        const char* blockStart = p;
+        const char* keyStart = p;
+        const char* eq = nullptr;
+        while (p < end && *p != ' ') {
+            if (*p == '=' && !eq) {
+                eq = p;
+            }
+            else if (*p == ';') {
+                if (out.tagCount < IrcMessage::kMaxTags && p > keyStart) {
+                    auto& t = out.tagList[out.tagCount++];
+                    t.key = std::string_view(keyStart, (eq ? eq : p) - keyStart);
+                    t.value = eq ? std::string_view(eq + 1, p - eq - 1) : std::string_view();
+                }
+                keyStart = p + 1;
+                eq = nullptr;
+            }
+            ++p;
+        }
+        if (out.tagCount < IrcMessage::kMaxTags && p > keyStart) {
+            auto& t = out.tagList[out.tagCount++];
+            t.key = std::string_view(keyStart, (eq ? eq : p) - keyStart);
+            t.value = eq ? std::string_view(eq + 1, p - eq - 1) : std::string_view();
+        }
+        out.tags = std::string_view(blockStart, p - blockStart);
+        skipSpaces();
+    }
+
+    // :nick!user@host
+    if (p < end && *p == ':') {
+        ++p;
+        out.prefix = word();
+        skipSpaces();
+    }
+
+    out.command = word();
+    if (out.command.empty()) return false;
+
+    // middle params, then an optional :trailing that may contain anything
+    for (;;) {
+        skipSpaces();
+        if (p >= end) break;
+        if (*p == ':') {
+            out.trailing = std::string_view(p + 1, end - p - 1);
+            out.hasTrailing = true;
+            break;
+        }
+        std::string_view param = word();
+        if (out.paramCount < IrcMessage::kMaxParams) out.params[out.paramCount++] = param;
+    }
+    return true;
+}
+
+void unescapeTagValue(std::string_view value, std::string& out) {
+    out.clear();
+    out.reserve(value.size());
+    for (size_t i = 0; i < value.size(); ++i) {
+        char c = value[i];
+        if (c != '\\') {
+            out.push_back(c);
+            continue;
+        }
+        if (++i >= value.size()) break;
+        switch (value[i]) {
+        case 's':  out.push_back(' ');  break;
+        case ':':  out.push_back(';');  break;
+        case 'r':  out.push_back('\r'); break;
+        case 'n':  out.push_back('\n'); break;
+        default:   out.push_back(value[i]); break;
+        }
+    }
+}
+
+static size_t roundUpPow2(size_t n) {
+    size_t p = 1;
+    while (p < n) p <<= 1;
+    return p;
+}
+
+LineFramer::LineFramer(size_t capacity)
+    : m_storage(roundUpPow2(capacity < 1024 ? 1024 : capacity)) {
+    m_scratch.reserve(m_storage.size());
+}
+
+std::array<boost::asio::mutable_buffer, 2> LineFramer::prepare() {
+    size_t free = m_storage.size() - size();
+    size_t start = mask(m_write);
+    size_t first = std::min(free, m_storage.size() - start);
+    return {
+        boost::asio::buffer(m_storage.data() + start, first),
+        boost::asio::buffer(m_storage.data(), free - first)
+    };
+}
+
+void LineFramer::commit(size_t n) {
+    m_write += n;
+}
+
+void LineFramer::reset() {
+    m_read = m_write = m_scanned = 0;
+}
+
+size_t LineFramer::findNewline() const {
+    // Only scan bytes that arrived since the last unsuccessful scan
+    size_t pos = m_scanned;
+    size_t avail = size();
+    while (pos < avail) {
+        size_t start = mask(m_read + pos);
+        size_t chunk = std::min(avail - pos, m_storage.size() - start);
+        const void* hit = std::memchr(m_storage.data() + start, '\n', chunk);
+        if (hit) return pos + (static_cast<const char*>(hit) - (m_storage.data() + start));
+        pos += chunk;
+    }
+    m_scanned = avail;
+    return std::string::npos;
+}
@@ -0,0 +1,115 @@
+#pragma once
+#include <boost/asio/buffer.hpp>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// IRCv3 message split into views over the original line. Nothing is copied;
+// the views are only valid while the line they came from is.
+struct IrcMessage {
+    struct Tag {
+        std::string_view key;
+        std::string_view value; // still escaped, see unescapeTagValue()
+    };
+
+    static constexpr size_t kMaxTags = 32;
+    static constexpr size_t kMaxParams = 15;
+
+    std::string_view tags;    // raw tag block, without the leading '@'
+    std::string_view prefix;  // without the leading ':'
+    std::string_view command;
+    std::string_view trailing;
+    bool hasTrailing = false;
+
+    std::array<Tag, kMaxTags> tagList;
+    size_t tagCount = 0;
+    std::array<std::string_view, kMaxParams> params;
+    size_t paramCount = 0;
+
+    std::string_view tag(std::string_view key) const;
+    bool hasTag(std::string_view key) const;
+    // Nick part of the prefix ("nick!user@host" -> "nick")
+    std::string_view nick() const;
+    // First middle param, which is the channel for PRIVMSG/JOIN/PART
+    std::string_view channel() const { return paramCount ? params[0] : std::string_view(); }
+};
+
+// Single pass over `line` (without CRLF). Returns false if there is no command.
+bool parseIrcLine(std::string_view line, IrcMessage& out);
+
+// Undo IRCv3 tag escaping (\s \: \\ \r \n) into `out`
+void unescapeTagValue(std::string_view value, std::string& out);
+
+// Fixed size ring buffer that the socket reads straight into and that hands
+// back complete CRLF (or bare LF) terminated lines as string_views. Lines
+// that wrap around the end of the ring are stitched together in a scratch
+// buffer that is reused, so steady state framing never allocates.
+class LineFramer {
+public:
+    explicit LineFramer(size_t capacity = 64 * 1024);
+
+    // Free space as up to two buffers, ready for async_read_some
+    std::array<boost::asio::mutable_buffer, 2> prepare();
+    void commit(size_t n);
+    void reset();
+
+    // Calls f(std::string_view line) for every complete line in the buffer
+    template <class F>
+    size_t consumeLines(F&& f);
+
+    size_t size() const { return m_write - m_read; }
+    uint64_t droppedOverlong() const { return m_droppedOverlong; }
+
+private:
+    size_t mask(size_t pos) const { return pos & (m_storage.size() - 1); }
+    // Offset of the next '\n' from m_read, or npos
+    size_t findNewline() const;
+
+    std::vector<char> m_storage;
+    std::string m_scratch;
+    size_t m_read = 0;   // monotonic
+    size_t m_write = 0;  // monotonic
+    mutable size_t m_scanned = 0; // bytes past m_read already known to hold no '\n'
+    uint64_t m_droppedOverlong = 0;
+};
+
+template <class F>
+size_t LineFramer::consumeLines(F&& f) {
+    size_t lines = 0;
+    for (;;) {
+        size_t nl = findNewline();
+        if (nl == std::string::npos) {
+            // A full ring with no newline can never complete; drop it
+            if (size() == m_storage.size()) {
+                ++m_droppedOverlong;
+                m_read = m_write;
+                m_scanned = 0;
+            }
+            return lines;
+        }
+
+        size_t len = nl;
+        size_t start = mask(m_read);
+        std::string_view line;
+        if (start + len <= m_storage.size()) {
+            line = std::string_view(m_storage.data() + start, len);
+        }
+        else {
+            size_t first = m_storage.size() - start;
+            m_scratch.assign(m_storage.data() + start, first);
+            m_scratch.append(m_storage.data(), len - first);
+            line = m_scratch;
+        }
+        if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+
+        m_read += nl + 1;
+        m_scanned = 0;
+        if (!line.empty()) {
+            f(line);
+            ++lines;
+        }
+    }
+}
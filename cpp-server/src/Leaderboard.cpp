@@ -0,0 +1,148 @@
+#include "Leaderboard.h"
+
+Leaderboard::Leaderboard() {
+    m_nodes.push_back(Node{ {0, 0}, 0, 0, kNil, kNil, {} });
+}
+
+uint32_t Leaderboard::nextPriority() {
+    // xorshift32 is plenty for treap balance
+    m_rng ^= m_rng << 13;
+    m_rng ^= m_rng >> 17;
+    m_rng ^= m_rng << 5;
+    return m_rng;
+}
+
+void Leaderboard::split(uint32_t t, const Key& key, uint32_t& left, uint32_t& right) {
+    // left gets every node ranked above `key`
+    if (t == kNil) {
+        left = right = kNil;
+        return;
+    }
+    if (m_nodes[t].key < key) {
+        split(m_nodes[t].right, key, m_nodes[t].right, right);
+        left = t;
+    }
+    else {
+        split(m_nodes[t].left, key, left, m_nodes[t].left);
+        right = t;
+    }
+    pull(t);
+}
+
+uint32_t Leaderboard::merge(uint32_t left, uint32_t right) {
+    if (left == kNil) return right;
+    if (right == kNil) return left;
+    if (m_nodes[left].priority > m_nodes[right].priority) {
+        m_nodes[left].right = merge(m_nodes[left].right, right);
+        pull(left);
+        return left;
+    }
+    m_nodes[right].left = merge(left, m_nodes[right].left);
+    pull(right);
+    return right;
+}
+
+void Leaderboard::insertNode(uint32_t node) {
+    uint32_t left, right;
+    split(m_root, m_nodes[node].key, left, right);
+    m_root = merge(merge(left, node), right);
+}
+
+void Leaderboard::eraseKey(const Key& key) {
+    // Walk down to the node, shrinking sizes on the way, then splice it out
+    uint32_t* link = &m_root;
+    while (*link != kNil) {
+        Node& node = m_nodes[*link];
+        if (node.key == key) {
+            *link = merge(node.left, node.right);
+            return;
+        }
+        --node.size;
+        link = key < node.key ? &node.left : &node.right;
+    }
+}
+
+uint32_t Leaderboard::rankOf(const Key& key) const {
+    uint32_t rank = 0;
+    uint32_t t = m_root;
+    while (t != kNil) {
+        const Node& node = m_nodes[t];
+        if (key < node.key) {
+            t = node.left;
+        }
+        else {
+            rank += size(node.left) + 1;
+            if (node.key == key) return rank;
+            t = node.right;
+        }
+    }
+    return 0;
+}
+
+Leaderboard::Move Leaderboard::set(std::string_view username, int64_t score) {
+    Move move;
+    uint32_t id;
+    auto it = m_index.find(username);
+    if (it != m_index.end()) {
+        id = it->second;
+        Node& node = m_nodes[id];
+        if (node.key.score == score) {
+            move.previous = move.rank = rankOf(node.key);
+            return move;
+        }
+        move.previous = rankOf(node.key);
+        eraseKey(node.key);
+    }
+    else {
+        if (!m_free.empty()) {
+            id = m_free.back();
+            m_free.pop_back();
+        }
+        else {
+            id = static_cast<uint32_t>(m_nodes.size());
+            m_nodes.emplace_back();
+        }
+        m_nodes[id].username.assign(username);
+        m_index.emplace(std::string(username), id);
+    }
+
+    Node& node = m_nodes[id];
+    node.key = { score, ++m_seq };
+    node.priority = nextPriority();
+    node.size = 1;
+    node.left = node.right = kNil;
+    insertNode(id);
+    move.rank = rankOf(node.key);
+    return move;
+}
+
+Leaderboard::Move Leaderboard::add(std::string_view username, int64_t points) {
+    return set(username, score(username) + points);
+}
+
+void Leaderboard::remove(std::string_view username) {
+    auto it = m_index.find(username);
+    if (it == m_index.end()) return;
+    uint32_t id = it->second;
+    eraseKey(m_nodes[id].key);
+    m_nodes[id].username.clear();
+    m_free.push_back(id);
+    m_index.erase(it);
+}
+
+void Leaderboard::clear() {
+    m_nodes.resize(1);
+    m_free.clear();
+    m_index.clear();
+    m_root = kNil;
+}
+
+uint32_t Leaderboard::rank(std::string_view username) const {
+    auto it = m_index.find(username);
+    return it == m_index.end() ? 0 : rankOf(m_nodes[it->second].key);
+}
+
+int64_t Leaderboard::score(std::string_view username) const {
+    auto it = m_index.find(username);
+    return it == m_index.end() ? 0 : m_nodes[it->second].key.score;
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "StringHash.h"
+
+// Scores ranked in an order-statistic treap: every node knows the size of
+// its subtree, so a score change (remove + insert) and a rank lookup are
+// O(log n) and reading the top K is O(log n + K). Nothing is ever sorted
+// wholesale. Ties go to whoever reached the score first.
+//
+// Nodes live in one vector and are recycled through a free list, so a
+// steady set of players updates without allocating. Not thread safe.
+class Leaderboard {
+public:
+    // Ranks are 1-based; 0 means not on the board
+    struct Move {
+        uint32_t previous = 0;
+        uint32_t rank = 0;
+        bool changed() const { return previous != rank; }
+    };
+
+    Leaderboard();
+
+    // Adds `points` to `username`'s score, putting them on the board if new
+    Move add(std::string_view username, int64_t points);
+    // Sets the score outright
+    Move set(std::string_view username, int64_t score);
+    void remove(std::string_view username);
+    void clear();
+
+    uint32_t rank(std::string_view username) const;
+    int64_t score(std::string_view username) const;
+    size_t size() const { return m_index.size(); }
+
+    // f(rank, username, score) for the first `k` places, best first
+    template <class F>
+    void top(size_t k, F&& f) const;
+
+private:
+    struct Key {
+        int64_t score;
+        uint64_t seq; // when this score was reached
+        // "a < b" means a ranks above b
+        bool operator<(const Key& o) const { return score != o.score ? score > o.score : seq < o.seq; }
+        bool operator==(const Key& o) const { return score == o.score && seq == o.seq; }
+    };
+
+    struct Node {
+        Key key;
+        uint32_t priority;
+        uint32_t size;
+        uint32_t left;
+        uint32_t right;
+        std::string username;
+    };
+
+    static constexpr uint32_t kNil = 0; // node 0 is a sentinel with size 0
+
+    uint32_t size(uint32_t t) const { return m_nodes[t].size; }
+    void pull(uint32_t t) { m_nodes[t].size = 1 + size(m_nodes[t].left) + size(m_nodes[t].right); }
+    void split(uint32_t t, const Key& key, uint32_t& left, uint32_t& right);
+    uint32_t merge(uint32_t left, uint32_t right);
+    void insertNode(uint32_t node);
+    void eraseKey(const Key& key);
+    uint32_t rankOf(const Key& key) const;
+    uint32_t nextPriority();
+
+    std::vector<Node> m_nodes;
+    std::vector<uint32_t> m_free;
+    std::unordered_map<std::string, uint32_t, StringHash, std::equal_to<>> m_index; // username -> node
+    uint32_t m_root = kNil;
+    uint64_t m_seq = 0;
+    uint32_t m_rng = 0x9e3779b9u;
+};
+
+template <class F>
+void Leaderboard::top(size_t k, F&& f) const {
+    // In-order walk that stops after k nodes; depth is O(log n)
+    thread_local std::vector<uint32_t> stack;
+    stack.clear();
+    uint32_t t = m_root;
+    uint32_t rank = 0;
+    while ((t != kNil || !stack.empty()) && rank < k) {
+        while (t != kNil) {
+            stack.push_back(t);
+            t = m_nodes[t].left;
+        }
+        t = stack.back();
+        stack.pop_back();
+        const Node& node = m_nodes[t];
+        f(++rank, std::string_view(node.username), node.key.score);
+        t = node.right;
+    }
+}
@@ -0,0 +1,111 @@
+#include "LzCodec.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace {
+constexpr size_t kMinMatch = 4;
+constexpr size_t kMaxOffset = 65535;
+constexpr int kHashBits = 14;
+constexpr size_t kNoPosition = SIZE_MAX;
+
+uint32_t read32(const char* p) {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+uint32_t hash(uint32_t v) {
+    return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+void putLength(std::string& out, size_t length) {
+    for (; length >= 255; length -= 255) out += static_cast<char>(255);
+    out += static_cast<char>(length);
+}
+
+void putSequence(std::string& out, std::string_view literals, size_t offset, size_t match) {
+    size_t extraMatch = match ? match - kMinMatch : 0;
+    out += static_cast<char>((std::min<size_t>(literals.size(), 15) << 4) | std::min<size_t>(extraMatch, 15));
+    if (literals.size() >= 15) putLength(out, literals.size() - 15);
+    out += literals;
+    if (!match) return;
+    out += static_cast<char>(offset & 0xFF);
+    out += static_cast<char>(offset >> 8);
+    if (extraMatch >= 15) putLength(out, extraMatch - 15);
+}
+
+bool readLength(std::string_view in, size_t& pos, size_t& length) {
+    unsigned char b;
+    do {
+        if (pos >= in.size()) return false;
+        b = static_cast<unsigned char>(in[pos++]);
+        length += b;
+    } while (b == 255);
+    return true;
+}
+}
+
+std::string lzCompress(std::string_view in) {
+    std::string out;
+    out.reserve(in.size() / 2 + 16);
+    std::vector<size_t> table(size_t(1) << kHashBits, kNoPosition);
+
+    const char* p = in.data();
+    size_t n = in.size();
+    size_t anchor = 0;
+    size_t i = 0;
+    while (i + kMinMatch <= n) {
+        uint32_t v = read32(p + i);
+        size_t& slot = table[hash(v)];
+        size_t candidate = slot;
+        slot = i;
+        if (candidate == kNoPosition || i - candidate > kMaxOffset || read32(p + candidate) != v) {
+            ++i;
+            continue;
+        }
+        size_t length = kMinMatch;
+        while (i + length < n && p[candidate + length] == p[i + length]) ++length;
+        putSequence(out, in.substr(anchor, i - anchor), i - candidate, length);
+        i += length;
+        anchor = i;
+        // Seed the table inside the match too, so runs right after it are found
+        if (i >= 2 && i - 2 + kMinMatch <= n) table[hash(read32(p + i - 2))] = i - 2;
+    }
+    putSequence(out, in.substr(anchor), 0, 0);
+    return out;
+}
+
+bool lzDecompress(std::string_view in, size_t size, std::string& out) {
+    out.clear();
+    out.resize(size);
+    char* dst = out.data();
+    size_t written = 0;
+    size_t pos = 0;
+    while (pos < in.size()) {
+        unsigned char token = static_cast<unsigned char>(in[pos++]);
+
+        size_t literals = token >> 4;
+        if (literals == 15 && !readLength(in, pos, literals)) return false;
+        if (literals > in.size() - pos || literals > size - written) return false;
+        std::memcpy(dst + written, in.data() + pos, literals);
+        pos += literals;
+        written += literals;
+        if (pos == in.size()) break;
+
+        if (in.size() - pos < 2) return false;
+        size_t offset = static_cast<unsigned char>(in[pos]) | (static_cast<size_t>(static_cast<unsigned char>(in[pos + 1])) << 8);
+        pos += 2;
+        size_t match = token & 15;
+        if (match == 15 && !readLength(in, pos, match)) return false;
+        match += kMinMatch;
+        if (offset == 0 || offset > written || match > size - written) return false;
+        // Byte by byte when the match overlaps what it produces (runs)
+        const char* src = dst + written - offset;
+        if (offset >= match) std::memcpy(dst + written, src, match);
+        else for (size_t k = 0; k < match; ++k) dst[written + k] = src[k];
+        written += match;
+    }
+    return written == size;
+}
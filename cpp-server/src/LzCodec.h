@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+// Byte-oriented LZ77 in the style of LZ4, for data written once and read
+// back rarely (hibernated rooms, see RoomArchive). Stroke payloads repeat
+// the same keys and colours over and over, so a greedy matcher with one
+// hash probe gets them to a fraction of their size at memcpy-like speed.
+//
+// The stream is a run of sequences:
+//
+//   token | extra literal length | literals | u16 offset | extra match length
+//
+// The token's high nibble is the literal count and its low nibble the match
+// length minus 4; a nibble of 15 means more length bytes follow, each one
+// added, up to and including the first below 255. The offset (little
+// endian) points back into the output. The last sequence ends after its
+// literals.
+std::string lzCompress(std::string_view in);
+// False if `in` is malformed or does not decode to exactly `size` bytes
+bool lzDecompress(std::string_view in, size_t size, std::string& out);
@@ -0,0 +1,122 @@
+#include "MessageFormat.h"
+#include <bit>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define GUESSIO_SSE2 1
+#endif
+
+namespace {
+// Bytes that can't be copied as they are: controls, '"', '\\' and non-ASCII
+inline bool needsCare(unsigned char c) {
+    return c < 0x20 || c == '"' || c == '\\' || c >= 0x80;
+}
+
+// Length of the clean run at the start of `p`
+size_t cleanRun(const char* p, size_t n) {
+    size_t i = 0;
+#ifdef GUESSIO_SSE2
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i slash = _mm_set1_epi8('\\');
+    const __m128i space = _mm_set1_epi8(0x20);
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        // Signed compare: bytes >= 0x80 are negative, so they count as < 0x20
+        __m128i bad = _mm_or_si128(_mm_cmplt_epi8(v, space),
+            _mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, slash)));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(bad));
+        if (mask != 0) return i + std::countr_zero(mask);
+    }
+#endif
+    while (i < n && !needsCare(static_cast<unsigned char>(p[i]))) ++i;
+    return i;
+}
+
+// Bytes of the UTF-8 sequence at `p`, setting `valid`. An ill-formed one
+// spans its longest valid-looking prefix (at least one byte), which then
+// becomes a single U+FFFD.
+size_t utf8Sequence(const unsigned char* p, size_t n, bool& valid) {
+    unsigned char c = p[0];
+    size_t len;
+    unsigned char lo = 0x80, hi = 0xBF; // allowed range of the second byte
+    if (c >= 0xC2 && c <= 0xDF) len = 2;
+    else if (c >= 0xE0 && c <= 0xEF) {
+        len = 3;
+        if (c == 0xE0) lo = 0xA0;      // overlong
+        else if (c == 0xED) hi = 0x9F; // surrogates
+    }
+    else if (c >= 0xF0 && c <= 0xF4) {
+        len = 4;
+        if (c == 0xF0) lo = 0x90;      // overlong
+        else if (c == 0xF4) hi = 0x8F; // past U+10FFFF
+    }
+    else {
+        valid = false;
+        return 1;
+    }
+
+    size_t k = 1;
+    for (; k < len && k < n; ++k) {
+        unsigned char b = p[k];
+        if (k == 1 ? (b < lo || b > hi) : (b & 0xC0) != 0x80) break;
+    }
+    valid = k == len;
+    return k;
+}
+
+thread_local std::vector<std::string> t_pool;
+}
+
+void appendJsonString(std::string& out, std::string_view text) {
+    static constexpr char kHex[] = "0123456789abcdef";
+    out += '"';
+    const char* p = text.data();
+    size_t n = text.size();
+    while (n > 0) {
+        size_t run = cleanRun(p, n);
+        out.append(p, run);
+        p += run;
+        n -= run;
+        if (n == 0) break;
+
+        unsigned char c = static_cast<unsigned char>(*p);
+        size_t used = 1;
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (c < 0x20) {
+                char esc[6] = { '\\', 'u', '0', '0', kHex[c >> 4], kHex[c & 0xF] };
+                out.append(esc, sizeof(esc));
+            }
+            else {
+                bool valid;
+                used = utf8Sequence(reinterpret_cast<const unsigned char*>(p), n, valid);
+                if (valid) out.append(p, used);
+                else out += "\xEF\xBF\xBD";
+            }
+        }
+        p += used;
+        n -= used;
+    }
+    out += '"';
+}
+
+MessageBuffer::MessageBuffer() {
+    if (!t_pool.empty()) {
+        m_buf = std::move(t_pool.back());
+        t_pool.pop_back();
+    }
+    m_buf.clear();
+}
+
+MessageBuffer::~MessageBuffer() {
+    if (t_pool.size() < kPoolSize && m_buf.capacity() <= kMaxKept)
+        t_pool.push_back(std::move(m_buf));
+}
@@ -0,0 +1,111 @@
+#pragma once
+#include <charconv>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Fixed-shape server events (chat, system, round_*, ...) are written straight
+// into a string from a template checked at compile time, instead of building
+// a json object and dumping it:
+//
+//   static constexpr MessageTemplate<2> kChat{ R"({"type":"chat","room":$,"payload":$})" };
+//   MessageBuffer buf;
+//   kChat.write(buf.str(), roomId, text);
+//
+// Each `$` is a hole filled by one argument: strings are quoted and escaped,
+// integers formatted with to_chars, nullptr or a null `const std::string*`
+// becomes null, and RawJson is copied as it is.
+
+// Already-serialised JSON, spliced in unchanged
+struct RawJson {
+    std::string_view text;
+};
+
+// Appends `text` as a quoted JSON string. Invalid UTF-8 becomes U+FFFD
+// rather than failing the whole message.
+void appendJsonString(std::string& out, std::string_view text);
+
+template <class T>
+void appendJsonInt(std::string& out, T value) {
+    char digits[24];
+    auto [end, ec] = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, end);
+}
+
+inline void appendJsonValue(std::string& out, std::string_view v) { appendJsonString(out, v); }
+inline void appendJsonValue(std::string& out, const std::string& v) { appendJsonString(out, v); }
+inline void appendJsonValue(std::string& out, const char* v) { appendJsonString(out, v); }
+inline void appendJsonValue(std::string& out, const std::string* v) {
+    if (v) appendJsonString(out, *v);
+    else out += "null";
+}
+inline void appendJsonValue(std::string& out, std::nullptr_t) { out += "null"; }
+inline void appendJsonValue(std::string& out, bool v) { out += v ? "true" : "false"; }
+inline void appendJsonValue(std::string& out, RawJson v) { out += v.text; }
+
+template <class T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>, int> = 0>
+void appendJsonValue(std::string& out, T v) { appendJsonInt(out, v); }
+
+template <size_t Holes>
+class MessageTemplate {
+public:
+    // A template with the wrong number of holes doesn't compile
+    consteval MessageTemplate(const char* text) {
+        size_t holes = 0, start = 0, i = 0;
+        for (; text[i] != '\0'; ++i) {
+            if (text[i] != '$') continue;
+            if (holes == Holes) throw "too many holes in message template";
+            m_parts[holes++] = std::string_view(text + start, i - start);
+            start = i + 1;
+        }
+        if (holes != Holes) throw "too few holes in message template";
+        m_parts[Holes] = std::string_view(text + start, i - start);
+        for (const auto& part : m_parts) m_fixed += part.size();
+    }
+
+    // Bytes of fixed text, a floor for reserve()
+    constexpr size_t fixedSize() const { return m_fixed; }
+
+    template <class... Args>
+    std::string& write(std::string& out, const Args&... args) const {
+        static_assert(sizeof...(Args) == Holes, "one argument per hole");
+        size_t i = 0;
+        out += m_parts[0];
+        ((appendJsonValue(out, args), out += m_parts[++i]), ...);
+        return out;
+    }
+
+    // A fresh string, for messages that are queued rather than sent at once
+    template <class... Args>
+    std::string str(const Args&... args) const {
+        std::string out;
+        out.reserve(m_fixed + 32);
+        write(out, args...);
+        return out;
+    }
+
+private:
+    std::string_view m_parts[Holes + 1]{};
+    size_t m_fixed = 0;
+};
+
+// A scratch string borrowed from a small per-thread pool, so messages that
+// are sent straight away reuse capacity instead of allocating each time.
+// Cleared on construction; handed back on destruction.
+class MessageBuffer {
+public:
+    MessageBuffer();
+    ~MessageBuffer();
+    MessageBuffer(const MessageBuffer&) = delete;
+    MessageBuffer& operator=(const MessageBuffer&) = delete;
+
+    std::string& str() { return m_buf; }
+
+private:
+    static constexpr size_t kPoolSize = 8;
+    static constexpr size_t kMaxKept = 64 * 1024; // larger buffers aren't pooled
+
+    std::string m_buf;
+};
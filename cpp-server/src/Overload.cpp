@@ -0,0 +1,102 @@
+#include "Overload.h"
+#include <iostream>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+static constexpr auto kSampleInterval = std::chrono::milliseconds(100);
+static constexpr auto kCalmPeriod = std::chrono::seconds(2);
+
+ServerLimits ServerLimits::fromJson(const json& j) {
+    ServerLimits l;
+    if (!j.is_object()) return l;
+    l.maxSessions = j.value("max_sessions", l.maxSessions);
+    l.maxRooms = j.value("max_rooms", l.maxRooms);
+    l.maxSessionsPerRoom = j.value("max_sessions_per_room", l.maxSessionsPerRoom);
+    l.lagShedDraw = std::chrono::milliseconds(j.value("lag_shed_draw_ms", (int64_t)l.lagShedDraw.count()));
+    l.lagShedChat = std::chrono::milliseconds(j.value("lag_shed_chat_ms", (int64_t)l.lagShedChat.count()));
+    l.queuedBytesShedDraw = j.value("queued_bytes_shed_draw", l.queuedBytesShedDraw);
+    l.queuedBytesShedChat = j.value("queued_bytes_shed_chat", l.queuedBytesShedChat);
+    return l;
+}
+
+OverloadMonitor::OverloadMonitor(boost::asio::io_context& io, const ServerLimits& limits)
+    : m_timer(io),
+    m_limits(limits) {
+}
+
+void OverloadMonitor::start() {
+    m_running = true;
+    m_calmSince = Clock::now();
+    schedule();
+}
+
+void OverloadMonitor::stop() {
+    m_running = false;
+    m_timer.cancel();
+}
+
+void OverloadMonitor::schedule() {
+    m_expected = Clock::now() + kSampleInterval;
+    m_timer.expires_at(m_expected);
+    m_timer.async_wait([this](boost::system::error_code ec) {
+        if (ec || !m_running) return;
+        // How late we fired is how long handlers are waiting for a thread
+        auto lag = Clock::now() - m_expected;
+        evaluate(lag < Clock::duration::zero() ? Clock::duration::zero() : lag);
+        schedule();
+    });
+}
+
+void OverloadMonitor::evaluate(Clock::duration lag) {
+    m_lastLag = lag;
+    int64_t bytes = queuedBytes();
+
+    OverloadLevel wanted = OverloadLevel::Normal;
+    if (lag >= m_limits.lagShedChat || bytes >= m_limits.queuedBytesShedChat)
+        wanted = OverloadLevel::ShedChat;
+    else if (lag >= m_limits.lagShedDraw || bytes >= m_limits.queuedBytesShedDraw)
+        wanted = OverloadLevel::ShedDraw;
+
+    OverloadLevel current = level();
+    auto now = Clock::now();
+
+    if (wanted > current) {
+        // Escalate immediately
+        m_level.store(wanted, std::memory_order_relaxed);
+        m_calmSince = now;
+        std::cerr << "[OVERLOAD] Level " << int(wanted) << " (lag "
+            << std::chrono::duration_cast<std::chrono::milliseconds>(lag).count()
+            << "ms, queued " << bytes << " bytes)\n";
+    }
+    else if (wanted < current) {
+        // Step down one level at a time, only after a calm period
+        if (now - m_calmSince >= kCalmPeriod) {
+            auto lower = static_cast<OverloadLevel>(static_cast<uint8_t>(current) - 1);
+            m_level.store(lower, std::memory_order_relaxed);
+            m_calmSince = now;
+            std::cout << "[OVERLOAD] Recovered to level " << int(lower) << "\n";
+        }
+    }
+    else {
+        m_calmSince = now;
+    }
+}
+
+void OverloadMonitor::recordShed(SendPriority priority) {
+    if (priority == SendPriority::Draw)
+        m_shedDraw.fetch_add(1, std::memory_order_relaxed);
+    else if (priority == SendPriority::Chat)
+        m_shedChat.fetch_add(1, std::memory_order_relaxed);
+}
+
+json OverloadMonitor::toJson() const {
+    return {
+        {"level", int(level())},
+        {"lag_ms", std::chrono::duration_cast<std::chrono::milliseconds>(m_lastLag).count()},
+        {"queued_bytes", queuedBytes()},
+        {"shed_draw", m_shedDraw.load(std::memory_order_relaxed)},
+        {"shed_chat", m_shedChat.load(std::memory_order_relaxed)},
+        {"rejected", m_rejected.load(std::memory_order_relaxed)}
+    };
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <nlohmann/json.hpp>
+
+// What a queued frame is worth when the server has to shed load.
+// Lower values are dropped first.
+enum class SendPriority : uint8_t {
+    Draw = 0,     // spectator draw deltas, recoverable from history
+    Chat = 1,     // chat echoes
+    Critical = 2  // joins, game events, state, system messages
+};
+
+enum class OverloadLevel : uint8_t {
+    Normal = 0,
+    ShedDraw = 1,  // drop draw deltas
+    ShedChat = 2   // drop draw deltas and chat, refuse new sessions
+};
+
+struct ServerLimits {
+    size_t maxSessions = 10000;
+    size_t maxRooms = 2000;
+    size_t maxSessionsPerRoom = 500;
+
+    // Overload triggers (either one raises the level)
+    std::chrono::milliseconds lagShedDraw{ 50 };
+    std::chrono::milliseconds lagShedChat{ 200 };
+    int64_t queuedBytesShedDraw = 64ll * 1024 * 1024;
+    int64_t queuedBytesShedChat = 256ll * 1024 * 1024;
+
+    // Reads the "LIMITS" block of config.json, missing keys keep defaults
+    static ServerLimits fromJson(const nlohmann::json& j);
+};
+
+// Watches reactor lag and total queued send bytes, and publishes an
+// OverloadLevel that the send path reads with a single relaxed load.
+class OverloadMonitor {
+public:
+    OverloadMonitor(boost::asio::io_context& io, const ServerLimits& limits);
+
+    void start();
+    void stop();
+
+    OverloadLevel level() const { return m_level.load(std::memory_order_relaxed); }
+    bool shouldShed(SendPriority priority) const {
+        return static_cast<uint8_t>(priority) < static_cast<uint8_t>(level());
+    }
+
+    void addQueuedBytes(int64_t n) { m_queuedBytes.fetch_add(n, std::memory_order_relaxed); }
+    int64_t queuedBytes() const { return m_queuedBytes.load(std::memory_order_relaxed); }
+
+    void recordShed(SendPriority priority);
+    void recordRejected() { m_rejected.fetch_add(1, std::memory_order_relaxed); }
+
+    nlohmann::json toJson() const;
+
+private:
+    void schedule();
+    void evaluate(std::chrono::steady_clock::duration lag);
+
+    boost::asio::steady_timer m_timer;
+    const ServerLimits& m_limits;
+    std::chrono::steady_clock::time_point m_expected;
+    std::chrono::steady_clock::time_point m_calmSince;
+    std::chrono::steady_clock::duration m_lastLag{};
+    bool m_running = false;
+
+    std::atomic<OverloadLevel> m_level{ OverloadLevel::Normal };
+    std::atomic<int64_t> m_queuedBytes{ 0 };
+    std::atomic<uint64_t> m_shedDraw{ 0 };
+    std::atomic<uint64_t> m_shedChat{ 0 };
+    std::atomic<uint64_t> m_rejected{ 0 };
+};
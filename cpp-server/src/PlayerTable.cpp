@@ -0,0 +1,44 @@
+#include "PlayerTable.h"
+#include <algorithm>
+#include <cstring>
+
+std::string_view PlayerTable::intern(std::string_view name) {
+    if (name.size() > kArenaBlock - m_arenaUsed) {
+        // Names are short; a rare oversized one gets a block of its own
+        m_arena.push_back(std::make_unique<char[]>(std::max(kArenaBlock, name.size())));
+        m_arenaUsed = 0;
+    }
+    char* dst = m_arena.back().get() + m_arenaUsed;
+    std::memcpy(dst, name.data(), name.size());
+    // An oversized block counts as full
+    m_arenaUsed = std::min(m_arenaUsed + name.size(), kArenaBlock);
+    return std::string_view(dst, name.size());
+}
+
+PlayerTable::Id PlayerTable::add(std::string_view name, bool* added) {
+    auto it = m_ids.find(name);
+    if (it != m_ids.end()) {
+        if (added) *added = false;
+        return it->second;
+    }
+    std::string_view stored = intern(name);
+    m_slots.push_back({ stored, 0 });
+    Id id = static_cast<Id>(m_slots.size());
+    m_ids.emplace(stored, id);
+    if (added) *added = true;
+    return id;
+}
+
+PlayerTable::Id PlayerTable::find(std::string_view name) const {
+    auto it = m_ids.find(name);
+    return it == m_ids.end() ? kNone : it->second;
+}
+
+void PlayerTable::clear() {
+    m_ids.clear();
+    m_slots.clear();
+    // Keep one block for the next lobby
+    if (m_arena.size() > 1) m_arena.resize(1);
+    m_arenaUsed = 0;
+    if (m_arena.empty()) m_arenaUsed = kArenaBlock;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Players of one room. Ids are dense and handed out in join order starting
+// at 1, so a slot is an index and a roster page is a contiguous id range;
+// a cursor is just the next id. Each name is copied once into an arena
+// and everything else (the lookup key, the slot) refers to that copy.
+//
+// Not thread safe; the owning Room calls it with its lock held.
+class PlayerTable {
+public:
+    using Id = uint32_t;
+    static constexpr Id kNone = 0;
+
+    // Id of `name`, adding it if new; `added` says which
+    Id add(std::string_view name, bool* added = nullptr);
+    Id find(std::string_view name) const;
+    bool contains(std::string_view name) const { return find(name) != kNone; }
+
+    std::string_view name(Id id) const { return m_slots[id - 1].name; }
+    int score(Id id) const { return m_slots[id - 1].score; }
+    // Returns the new score
+    int addScore(Id id, int points) { return m_slots[id - 1].score += points; }
+
+    size_t size() const { return m_slots.size(); }
+    void clear();
+
+    // f(id, name, score) for up to `limit` players from id `from` on;
+    // returns the id to continue from, or kNone at the end
+    template <class F>
+    Id page(Id from, size_t limit, F&& f) const;
+
+private:
+    struct Slot {
+        std::string_view name; // into m_arena
+        int score = 0;
+    };
+
+    std::string_view intern(std::string_view name);
+
+    static constexpr size_t kArenaBlock = 64 * 1024;
+    std::vector<std::unique_ptr<char[]>> m_arena;
+    size_t m_arenaUsed = kArenaBlock; // of the last block
+    std::vector<Slot> m_slots;
+    std::unordered_map<std::string_view, Id> m_ids;
+};
+
+template <class F>
+PlayerTable::Id PlayerTable::page(Id from, size_t limit, F&& f) const {
+    Id id = from == kNone ? 1 : from;
+    for (; id <= m_slots.size() && limit > 0; ++id, --limit) {
+        const Slot& slot = m_slots[id - 1];
+        f(id, slot.name, slot.score);
+    }
+    return id <= m_slots.size() ? id : kNone;
+}
@@ -0,0 +1,192 @@
+#include "RateLimiter.h"
+#include <algorithm>
+#include <iostream>
+
+using json = nlohmann::json;
+using Clock = std::chrono::steady_clock;
+
+std::array<std::atomic<uint64_t>, static_cast<size_t>(RateLimitStats::Scope::Count) * kMessageKindCount>
+    RateLimitStats::s_counters{};
+
+static size_t kindIndex(MessageKind kind) {
+    return static_cast<size_t>(kind);
+}
+
+MessageKind classifyMessage(std::string_view raw) {
+    // Find the "type" key, then read its string value in place
+    size_t pos = raw.find("\"type\"");
+    if (pos == std::string_view::npos) return MessageKind::Other;
+    pos += 6;
+
+    while (pos < raw.size() && (raw[pos] == ' ' || raw[pos] == '\t' || raw[pos] == '\n' || raw[pos] == '\r')) ++pos;
+    if (pos >= raw.size() || raw[pos] != ':') return MessageKind::Other;
+    ++pos;
+    while (pos < raw.size() && (raw[pos] == ' ' || raw[pos] == '\t' || raw[pos] == '\n' || raw[pos] == '\r')) ++pos;
+    if (pos >= raw.size() || raw[pos] != '"') return MessageKind::Other;
+    ++pos;
+
+    size_t end = raw.find('"', pos);
+    if (end == std::string_view::npos) return MessageKind::Other;
+
+    std::string_view type = raw.substr(pos, end - pos);
+    if (type == "draw") return MessageKind::Draw;
+    if (type == "chat") return MessageKind::Chat;
+    if (type == "join") return MessageKind::Join;
+    return MessageKind::Other;
+}
+
+MessageKind classifyChatCommand(std::string_view message) {
+    if (message.rfind("!join", 0) == 0) return MessageKind::Join;
+    return MessageKind::Chat;
+}
+
+const char* messageKindName(MessageKind kind) {
+    switch (kind) {
+    case MessageKind::Draw:  return "draw";
+    case MessageKind::Chat:  return "chat";
+    case MessageKind::Join:  return "join";
+    default:                 return "other";
+    }
+}
+
+RateLimitConfig::RateLimitConfig() {
+    // Drawing streams a point per mousemove, so it gets a much larger budget
+    session[kindIndex(MessageKind::Draw)] = { 240.0, 480.0 };
+    session[kindIndex(MessageKind::Chat)] = { 5.0, 10.0 };
+    session[kindIndex(MessageKind::Join)] = { 1.0, 3.0 };
+    session[kindIndex(MessageKind::Other)] = { 20.0, 40.0 };
+
+    twitchUser[kindIndex(MessageKind::Draw)] = { 0.0, 0.0 };
+    twitchUser[kindIndex(MessageKind::Chat)] = { 2.0, 5.0 };
+    twitchUser[kindIndex(MessageKind::Join)] = { 0.2, 2.0 };
+    twitchUser[kindIndex(MessageKind::Other)] = { 0.0, 0.0 };
+}
+
+static void readBuckets(const json& j, std::array<BucketConfig, kMessageKindCount>& out) {
+    if (!j.is_object()) return;
+    for (size_t i = 0; i < kMessageKindCount; ++i) {
+        const char* name = messageKindName(static_cast<MessageKind>(i));
+        auto it = j.find(name);
+        if (it == j.end() || !it->is_object()) continue;
+        out[i].ratePerSec = it->value("rate", out[i].ratePerSec);
+        out[i].burst = it->value("burst", out[i].burst);
+    }
+}
+
+RateLimitConfig RateLimitConfig::fromJson(const json& j) {
+    RateLimitConfig cfg;
+    if (!j.is_object()) return cfg;
+    if (j.contains("session")) readBuckets(j["session"], cfg.session);
+    if (j.contains("twitch_user")) readBuckets(j["twitch_user"], cfg.twitchUser);
+    cfg.maxTrackedUsers = j.value("max_tracked_users", cfg.maxTrackedUsers);
+    return cfg;
+}
+
+TokenBucket::TokenBucket(double ratePerSec, double burst) {
+    configure(ratePerSec, burst);
+}
+
+void TokenBucket::configure(double ratePerSec, double burst) {
+    m_rate = ratePerSec;
+    m_burst = std::max(burst, 1.0);
+    m_tokens = m_burst;
+    m_last = Clock::now();
+}
+
+void TokenBucket::refill(Clock::time_point now) {
+    if (now <= m_last) return;
+    double elapsed = std::chrono::duration<double>(now - m_last).count();
+    m_tokens = std::min(m_burst, m_tokens + elapsed * m_rate);
+    m_last = now;
+}
+
+bool TokenBucket::tryConsume(Clock::time_point now, double cost) {
+    if (m_rate <= 0.0) return true; // unlimited
+    refill(now);
+    if (m_tokens < cost) return false;
+    m_tokens -= cost;
+    return true;
+}
+
+Clock::duration TokenBucket::timeUntil(Clock::time_point now, double cost) {
+    if (m_rate <= 0.0) return Clock::duration::zero();
+    refill(now);
+    if (m_tokens >= cost) return Clock::duration::zero();
+    return std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>((cost - m_tokens) / m_rate));
+}
+
+bool TokenBucket::idle(Clock::time_point now) const {
+    if (m_rate <= 0.0) return true;
+    double elapsed = std::chrono::duration<double>(now - m_last).count();
+    return m_tokens + elapsed * m_rate >= m_burst;
+}
+
+void SessionRateLimiter::configure(const std::array<BucketConfig, kMessageKindCount>& cfg) {
+    for (size_t i = 0; i < kMessageKindCount; ++i) {
+        m_buckets[i].configure(cfg[i].ratePerSec, cfg[i].burst);
+    }
+}
+
+bool SessionRateLimiter::allow(MessageKind kind) {
+    return m_buckets[kindIndex(kind)].tryConsume(Clock::now());
+}
+
+void UserRateLimiter::configure(const std::array<BucketConfig, kMessageKindCount>& cfg, size_t maxUsers) {
+    m_config = cfg;
+    m_maxUsers = maxUsers;
+    m_users.clear();
+}
+
+bool UserRateLimiter::allow(const std::string& username, MessageKind kind) {
+    const BucketConfig& cfg = m_config[kindIndex(kind)];
+    if (cfg.ratePerSec <= 0.0) return true;
+
+    auto now = Clock::now();
+    auto it = m_users.find(username);
+    if (it == m_users.end()) {
+        if (m_users.size() >= m_maxUsers) {
+            // Forget chatters whose buckets are full again; they lose nothing
+            for (auto u = m_users.begin(); u != m_users.end();) {
+                bool idle = std::all_of(u->second.begin(), u->second.end(),
+                    [now](const TokenBucket& b) { return b.idle(now); });
+                u = idle ? m_users.erase(u) : std::next(u);
+            }
+            if (m_users.size() >= m_maxUsers) m_users.clear();
+        }
+
+        std::array<TokenBucket, kMessageKindCount> buckets;
+        for (size_t i = 0; i < kMessageKindCount; ++i) {
+            buckets[i].configure(m_config[i].ratePerSec, m_config[i].burst);
+        }
+        it = m_users.emplace(username, buckets).first;
+    }
+    return it->second[kindIndex(kind)].tryConsume(now);
+}
+
+void RateLimitStats::recordThrottled(Scope scope, MessageKind kind) {
+    size_t idx = static_cast<size_t>(scope) * kMessageKindCount + kindIndex(kind);
+    uint64_t n = s_counters[idx].fetch_add(1, std::memory_order_relaxed) + 1;
+
+    // Log the first hit and then every 1000th so a flood can't flood the log too
+    if (n == 1 || n % 1000 == 0) {
+        std::cout << "[RATE] Throttled " << messageKindName(kind)
+            << (scope == Scope::Session ? " from session" : " from twitch user")
+            << " (total " << n << ")\n";
+    }
+}
+
+uint64_t RateLimitStats::throttled(Scope scope, MessageKind kind) {
+    size_t idx = static_cast<size_t>(scope) * kMessageKindCount + kindIndex(kind);
+    return s_counters[idx].load(std::memory_order_relaxed);
+}
+
+json RateLimitStats::toJson() {
+    json j;
+    for (size_t i = 0; i < kMessageKindCount; ++i) {
+        auto kind = static_cast<MessageKind>(i);
+        j["session"][messageKindName(kind)] = throttled(Scope::Session, kind);
+        j["twitch_user"][messageKindName(kind)] = throttled(Scope::TwitchUser, kind);
+    }
+    return j;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <nlohmann/json.hpp>
+
+// Message kinds that have their own ingest budget
+enum class MessageKind : uint8_t {
+    Draw = 0,
+    Chat,
+    Join,
+    Other,
+    Count
+};
+
+constexpr size_t kMessageKindCount = static_cast<size_t>(MessageKind::Count);
+
+// Looks at the raw "type" field without building a JSON DOM.
+// Anything it can't recognise is Other and goes through the normal parse.
+MessageKind classifyMessage(std::string_view raw);
+
+// Classifies a Twitch chat line by its leading command ("!join", "!guess" ...)
+MessageKind classifyChatCommand(std::string_view message);
+
+const char* messageKindName(MessageKind kind);
+
+struct BucketConfig {
+    double ratePerSec = 0.0; // 0 = unlimited
+    double burst = 0.0;
+};
+
+struct RateLimitConfig {
+    std::array<BucketConfig, kMessageKindCount> session;
+    std::array<BucketConfig, kMessageKindCount> twitchUser;
+    size_t maxTrackedUsers = 50000;
+
+    RateLimitConfig();
+    // Reads the "RATE_LIMITS" block of config.json, missing keys keep defaults
+    static RateLimitConfig fromJson(const nlohmann::json& j);
+};
+
+// Classic token bucket. Not thread safe on purpose: every bucket is owned
+// by exactly one read loop (a Session or a TwitchClient), so checks never lock.
+class TokenBucket {
+public:
+    TokenBucket() = default;
+    TokenBucket(double ratePerSec, double burst);
+
+    void configure(double ratePerSec, double burst);
+    bool tryConsume(std::chrono::steady_clock::time_point now, double cost = 1.0);
+    // Time until `cost` tokens are available (zero if they already are)
+    std::chrono::steady_clock::duration timeUntil(std::chrono::steady_clock::time_point now, double cost = 1.0);
+    // True once the bucket has refilled completely, i.e. it carries no state worth keeping
+    bool idle(std::chrono::steady_clock::time_point now) const;
+
+private:
+    void refill(std::chrono::steady_clock::time_point now);
+
+    double m_rate = 0.0;
+    double m_burst = 0.0;
+    double m_tokens = 0.0;
+    std::chrono::steady_clock::time_point m_last{};
+};
+
+// One bucket per message kind for a single WebSocket session
+class SessionRateLimiter {
+public:
+    void configure(const std::array<BucketConfig, kMessageKindCount>& cfg);
+    bool allow(MessageKind kind);
+
+private:
+    std::array<TokenBucket, kMessageKindCount> m_buckets;
+};
+
+// Per Twitch username buckets, owned by one TwitchClient read loop
+class UserRateLimiter {
+public:
+    void configure(const std::array<BucketConfig, kMessageKindCount>& cfg, size_t maxUsers);
+    bool allow(const std::string& username, MessageKind kind);
+
+private:
+    std::array<BucketConfig, kMessageKindCount> m_config;
+    size_t m_maxUsers = 50000;
+    std::unordered_map<std::string, std::array<TokenBucket, kMessageKindCount>> m_users;
+};
+
+// Process wide throttle counters, relaxed atomics only
+class RateLimitStats {
+public:
+    enum class Scope : uint8_t { Session = 0, TwitchUser, Count };
+
+    static void recordThrottled(Scope scope, MessageKind kind);
+    static uint64_t throttled(Scope scope, MessageKind kind);
+    static nlohmann::json toJson();
+
+private:
+    static std::array<std::atomic<uint64_t>, static_cast<size_t>(Scope::Count) * kMessageKindCount> s_counters;
+};
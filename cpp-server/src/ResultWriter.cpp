@@ -0,0 +1,253 @@
+#include "ResultWriter.h"
+#include <algorithm>
+#include <iostream>
+
+namespace beast = boost::beast;
+namespace http = beast::http;
+using json = nlohmann::json;
+
+PersistConfig PersistConfig::fromJson(const nlohmann::json& j) {
+    PersistConfig cfg;
+    cfg.enabled = j.value("enabled", cfg.enabled);
+    cfg.host = j.value("host", cfg.host);
+    cfg.port = j.value("port", cfg.port);
+    cfg.target = j.value("target", cfg.target);
+    cfg.apiKey = j.value("api_key", cfg.apiKey);
+    cfg.batchSize = std::max<size_t>(j.value("batch_size", cfg.batchSize), 1);
+    cfg.flushInterval = std::chrono::milliseconds(std::max(j.value("flush_ms", static_cast<int>(cfg.flushInterval.count())), 10));
+    cfg.maxQueue = std::max(j.value("max_queue", cfg.maxQueue), cfg.batchSize);
+    cfg.retryMin = std::chrono::milliseconds(std::max(j.value("retry_min_ms", static_cast<int>(cfg.retryMin.count())), 10));
+    cfg.retryMax = std::max(std::chrono::milliseconds(j.value("retry_max_ms", static_cast<int>(cfg.retryMax.count()))), cfg.retryMin);
+    cfg.timeout = std::chrono::seconds(std::max(j.value("timeout_s", static_cast<int>(cfg.timeout.count())), 1));
+    return cfg;
+}
+
+ResultWriter::ResultWriter(const PersistConfig& cfg)
+    : m_config(cfg),
+    m_resolver(m_io),
+    m_stream(m_io),
+    m_timer(m_io),
+    m_backoff(cfg.retryMin) {}
+
+ResultWriter::~ResultWriter() {
+    stop();
+}
+
+void ResultWriter::start() {
+    if (m_thread.joinable()) return;
+    scheduleFlush(m_config.flushInterval);
+    std::cout << "[PERSIST] Writing results to http://" << m_config.host << ":" << m_config.port
+        << m_config.target << " every " << m_config.flushInterval.count() << "ms or "
+        << m_config.batchSize << " records\n";
+    m_thread = std::thread([this]() { m_io.run(); });
+}
+
+void ResultWriter::stop() {
+    if (!m_thread.joinable()) return;
+
+    // Last chance for what is queued, bounded by the timeout
+    boost::asio::post(m_io, [this]() {
+        m_draining = true;
+        m_timer.cancel();
+        flush();
+    });
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_drainedCv.wait_for(lock, m_config.timeout, [this]() { return m_drained; });
+    }
+    m_io.stop();
+    m_thread.join();
+
+    size_t unsent = m_batch.size() + m_queue.size();
+    std::cout << "[PERSIST] Stopped: " << m_sent << " records sent, " << m_dropped.load()
+        << " dropped, " << unsent << " unsent\n";
+}
+
+void ResultWriter::recordScore(std::string_view username, std::string_view room, int score) {
+    enqueue({ Record::Kind::Score, false, score, std::string(username), std::string(room), {} });
+}
+
+void ResultWriter::recordGuess(std::string_view username, std::string_view room, std::string_view word, bool correct) {
+    enqueue({ Record::Kind::Guess, correct, 0, std::string(username), std::string(room), std::string(word) });
+}
+
+void ResultWriter::enqueue(Record record) {
+    bool kick = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_queue.size() >= m_config.maxQueue) {
+            m_queue.pop_front();
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        m_queue.push_back(std::move(record));
+        // A full batch goes out now instead of waiting for the timer
+        if (m_queue.size() >= m_config.batchSize && !m_kicked) kick = m_kicked = true;
+    }
+    if (kick) boost::asio::post(m_io, [this]() { flush(); });
+}
+
+void ResultWriter::scheduleFlush(std::chrono::milliseconds delay) {
+    m_timer.expires_after(delay);
+    m_timer.async_wait([this](beast::error_code ec) {
+        if (!ec) flush();
+    });
+}
+
+void ResultWriter::flush() {
+    // One request at a time; a failed batch waits for its retry timer
+    if (m_busy) return;
+    if (!m_batch.empty() && !m_draining && m_timer.expiry() > std::chrono::steady_clock::now()) return;
+
+    if (m_batch.empty()) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_kicked = false;
+        size_t n = std::min(m_queue.size(), m_config.batchSize);
+        for (size_t i = 0; i < n; ++i) {
+            m_batch.push_back(std::move(m_queue.front()));
+            m_queue.pop_front();
+        }
+    }
+    if (m_batch.empty()) {
+        if (m_draining) finishDrain();
+        else scheduleFlush(m_config.flushInterval);
+        return;
+    }
+
+    json scores = json::array();
+    json history = json::array();
+    for (auto& r : m_batch) {
+        if (r.kind == Record::Kind::Score) {
+            scores.push_back({ {"username", r.username}, {"room", r.room}, {"score", r.score} });
+        }
+        else {
+            history.push_back({ {"username", r.username}, {"room", r.room}, {"word", r.word}, {"correct", r.correct} });
+        }
+    }
+
+    m_request = {};
+    m_request.method(http::verb::post);
+    m_request.target(m_config.target);
+    m_request.version(11);
+    m_request.set(http::field::host, m_config.host);
+    m_request.set(http::field::user_agent, "guessio-server");
+    m_request.set(http::field::content_type, "application/json");
+    if (!m_config.apiKey.empty()) m_request.set("X-Guessio-Key", m_config.apiKey);
+    m_request.keep_alive(true);
+    m_request.body() = json{ {"scores", std::move(scores)}, {"history", std::move(history)} }.dump();
+    m_request.prepare_payload();
+
+    m_busy = true;
+    m_reused = m_stream.socket().is_open();
+    if (m_reused) send();
+    else connect();
+}
+
+void ResultWriter::connect() {
+    m_resolver.async_resolve(m_config.host, std::to_string(m_config.port),
+        [this](beast::error_code ec, boost::asio::ip::tcp::resolver::results_type results) {
+            if (ec) return retry("resolve: " + ec.message());
+            m_stream.expires_after(m_config.timeout);
+            m_stream.async_connect(results, [this](beast::error_code ec, const boost::asio::ip::tcp::endpoint&) {
+                if (ec) return retry("connect: " + ec.message());
+                beast::error_code ignored;
+                m_stream.socket().set_option(boost::asio::ip::tcp::no_delay(true), ignored);
+                send();
+            });
+        });
+}
+
+void ResultWriter::send() {
+    m_stream.expires_after(m_config.timeout);
+    http::async_write(m_stream, m_request, [this](beast::error_code ec, size_t) {
+        if (ec) return onResponse(ec);
+        m_response = {};
+        http::async_read(m_stream, m_buffer, m_response, [this](beast::error_code ec, size_t) {
+            onResponse(ec);
+        });
+    });
+}
+
+void ResultWriter::onResponse(beast::error_code ec) {
+    if (ec) {
+        // The backend may have closed an idle keep-alive connection; that
+        // is worth one fresh attempt before backing off
+        if (m_reused) {
+            beast::error_code ignored;
+            m_stream.socket().close(ignored);
+            m_buffer.clear();
+            m_reused = false;
+            return connect();
+        }
+        return retry(ec.message());
+    }
+
+    unsigned status = m_response.result_int();
+    if (status >= 500 || status == 408 || status == 429) {
+        return retry("HTTP " + std::to_string(status));
+    }
+    if (!m_response.keep_alive()) {
+        beast::error_code ignored;
+        m_stream.socket().shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+        m_stream.socket().close(ignored);
+    }
+
+    if (status >= 400) {
+        // Retrying a batch the backend refuses would only block the queue
+        std::cerr << "[PERSIST] Backend rejected " << m_batch.size() << " records: HTTP " << status
+            << " " << m_response.body() << "\n";
+    }
+    else {
+        m_sent += m_batch.size();
+    }
+    if (m_failing) {
+        std::cout << "[PERSIST] Backend reachable again\n";
+        m_failing = false;
+    }
+
+    m_batch.clear();
+    m_backoff = m_config.retryMin;
+    m_busy = false;
+
+    bool fullBatch;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        fullBatch = m_queue.size() >= m_config.batchSize;
+    }
+    if (fullBatch || m_draining) flush();
+    else scheduleFlush(m_config.flushInterval);
+}
+
+void ResultWriter::retry(const std::string& reason) {
+    beast::error_code ignored;
+    m_stream.socket().close(ignored);
+    m_buffer.clear();
+    m_busy = false;
+
+    if (m_draining) {
+        std::cerr << "[PERSIST] Giving up on final flush: " << reason << "\n";
+        return finishDrain();
+    }
+
+    if (!m_failing) {
+        size_t queued;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            queued = m_queue.size();
+        }
+        std::cerr << "[PERSIST] Writing results failed (" << reason << "), retrying; "
+            << m_batch.size() + queued << " records waiting, " << m_dropped.load() << " dropped so far\n";
+        m_failing = true;
+    }
+
+    // The batch stays in m_batch; flush() holds it until this timer fires
+    scheduleFlush(m_backoff);
+    m_backoff = std::min(m_backoff * 2, m_config.retryMax);
+}
+
+void ResultWriter::finishDrain() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_drained = true;
+    }
+    m_drainedCv.notify_all();
+}
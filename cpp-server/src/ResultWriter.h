@@ -0,0 +1,102 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <nlohmann/json.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Where and how often game results are written, read from the "PERSIST"
+// block of config.json
+struct PersistConfig {
+    bool enabled = false;
+    std::string host = "127.0.0.1";
+    uint16_t port = 8000;
+    std::string target = "/scores/batch";
+    std::string apiKey;                                 // sent as X-Guessio-Key when set
+    size_t batchSize = 200;                             // records per request
+    std::chrono::milliseconds flushInterval{ 1000 };    // longest a record waits
+    size_t maxQueue = 50000;                            // oldest records dropped beyond this
+    std::chrono::milliseconds retryMin{ 500 };
+    std::chrono::milliseconds retryMax{ 30000 };
+    std::chrono::seconds timeout{ 5 };                  // per HTTP exchange, and for the final drain
+
+    static PersistConfig fromJson(const nlohmann::json& j);
+};
+
+// Write-behind queue for scores and guess history. Game code only appends
+// to a bounded in-memory queue; a thread of its own drains it in batches,
+// by size or after flushInterval, as JSON POSTs over one keep-alive HTTP
+// connection to the backend. Failed batches are retried with exponential
+// backoff while new records keep queueing; when the queue is full the
+// oldest records are dropped and counted.
+class ResultWriter {
+public:
+    explicit ResultWriter(const PersistConfig& cfg);
+    ~ResultWriter();
+
+    ResultWriter(const ResultWriter&) = delete;
+    ResultWriter& operator=(const ResultWriter&) = delete;
+
+    void start();
+    // Sends what is queued (up to the timeout), then stops the thread
+    void stop();
+
+    // Safe from any thread; never blocks on the network
+    void recordScore(std::string_view username, std::string_view room, int score);
+    void recordGuess(std::string_view username, std::string_view room, std::string_view word, bool correct);
+
+private:
+    struct Record {
+        enum class Kind : uint8_t { Score, Guess } kind;
+        bool correct = false;
+        int score = 0;
+        std::string username;
+        std::string room;
+        std::string word;
+    };
+
+    void enqueue(Record record);
+    void scheduleFlush(std::chrono::milliseconds delay);
+    void flush();
+    void connect();
+    void send();
+    void onResponse(boost::beast::error_code ec);
+    void retry(const std::string& reason);
+    void finishDrain();
+
+    PersistConfig m_config;
+    boost::asio::io_context m_io;
+    boost::asio::ip::tcp::resolver m_resolver;
+    boost::beast::tcp_stream m_stream;
+    boost::asio::steady_timer m_timer;
+    std::thread m_thread;
+
+    // Shared with callers
+    std::mutex m_mutex;
+    std::deque<Record> m_queue;
+    bool m_kicked = false;      // a size-triggered flush is already posted
+    bool m_drained = false;
+    std::condition_variable m_drainedCv;
+    std::atomic<uint64_t> m_dropped{ 0 };
+
+    // Writer thread only
+    std::vector<Record> m_batch; // in flight, kept until the backend takes it
+    boost::beast::http::request<boost::beast::http::string_body> m_request;
+    boost::beast::http::response<boost::beast::http::string_body> m_response;
+    boost::beast::flat_buffer m_buffer;
+    bool m_busy = false;
+    bool m_reused = false;      // request went out on an already open connection
+    bool m_draining = false;
+    bool m_failing = false;     // logged the outage, waiting to log recovery
+    std::chrono::milliseconds m_backoff;
+    uint64_t m_sent = 0;
+};
@@ -0,0 +1,157 @@
+#include "RoomArchive.h"
+#include "EventLog.h"
+#include "LzCodec.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+
+namespace fs = std::filesystem;
+using std::chrono::system_clock;
+
+namespace {
+constexpr char kMagic[8] = { 'G', 'I', 'O', 'H', 'I', 'B', 'R', '1' };
+constexpr const char* kExtension = ".hib";
+constexpr uint64_t kMaxImage = 1ull << 32; // anything bigger is a corrupt header
+
+struct Header {
+    char magic[8];
+    uint64_t imageSize;
+    int64_t savedAt;
+    uint32_t crc;
+    uint32_t reserved;
+};
+
+void setError(std::string* error, const std::string& message) {
+    if (error) *error = message;
+}
+
+bool readHeader(std::FILE* f, Header& header) {
+    return std::fread(&header, sizeof(header), 1, f) == 1
+        && std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0
+        && header.imageSize <= kMaxImage;
+}
+}
+
+HibernateConfig HibernateConfig::fromJson(const nlohmann::json& j) {
+    HibernateConfig cfg;
+    cfg.enabled = j.value("enabled", cfg.enabled);
+    cfg.dir = j.value("dir", cfg.dir);
+    cfg.idleAfter = std::chrono::seconds(std::max(j.value("idle_s", static_cast<int>(cfg.idleAfter.count())), 1));
+    cfg.expireAfter = std::chrono::hours(std::max(j.value("expire_h", static_cast<int>(cfg.expireAfter.count())), 1));
+    return cfg;
+}
+
+RoomArchive::RoomArchive(const HibernateConfig& cfg)
+    : m_config(cfg) {
+    std::error_code ec;
+    fs::create_directories(m_config.dir, ec);
+    if (ec) std::cerr << "[HIBERNATE] Cannot create " << m_config.dir << ": " << ec.message() << "\n";
+}
+
+size_t RoomArchive::scan() {
+    std::error_code ec;
+    for (const auto& file : fs::directory_iterator(m_config.dir, ec)) {
+        std::string room;
+        if (file.path().extension() != kExtension || !EventLog::roomFromStem(file.path().stem().string(), room)) continue;
+        std::FILE* f = std::fopen(file.path().string().c_str(), "rb");
+        if (!f) continue;
+        Header header;
+        bool ok = readHeader(f, header);
+        std::fclose(f);
+        if (!ok) {
+            std::cerr << "[HIBERNATE] Ignoring " << file.path().string() << ": not a hibernated room\n";
+            continue;
+        }
+        Entry entry{ system_clock::time_point(std::chrono::seconds(header.savedAt)), file.file_size(ec) };
+        m_fileBytes += entry.fileBytes;
+        m_rooms[room] = entry;
+    }
+    std::cout << "[HIBERNATE] " << m_rooms.size() << " hibernated rooms in " << m_config.dir
+        << " (" << (m_fileBytes >> 10) << " KB)\n";
+    return m_rooms.size();
+}
+
+bool RoomArchive::save(const std::string& room, std::string_view image) {
+    std::string compressed = lzCompress(image);
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.imageSize = image.size();
+    auto now = system_clock::now();
+    header.savedAt = std::chrono::duration_cast<std::chrono::seconds>(now.time_since_epoch()).count();
+    header.crc = EventLog::checksum(image);
+
+    // Written aside and renamed, so a crash never leaves half a room
+    std::string path = pathFor(room);
+    std::string tmp = path + ".tmp";
+    std::FILE* f = std::fopen(tmp.c_str(), "wb");
+    bool ok = f
+        && std::fwrite(&header, sizeof(header), 1, f) == 1
+        && std::fwrite(compressed.data(), 1, compressed.size(), f) == compressed.size();
+    if (f) ok = std::fclose(f) == 0 && ok;
+    std::error_code ec;
+    if (ok) fs::rename(tmp, path, ec);
+    if (!ok || ec) {
+        std::cerr << "[HIBERNATE] Cannot write " << path << ", room stays in memory\n";
+        fs::remove(tmp, ec);
+        return false;
+    }
+
+    Entry& entry = m_rooms[room];
+    m_fileBytes -= entry.fileBytes; // an older file for the room was just replaced
+    entry = Entry{ now, sizeof(header) + compressed.size() };
+    m_fileBytes += entry.fileBytes;
+    std::cout << "[HIBERNATE] Room " << room << " evicted: " << (image.size() >> 10) << " KB -> "
+        << (entry.fileBytes >> 10) << " KB on disk\n";
+    return true;
+}
+
+bool RoomArchive::take(const std::string& room, std::string& image, std::string* error) {
+    std::string path = pathFor(room);
+    std::FILE* f = std::fopen(path.c_str(), "rb");
+    if (!f) {
+        setError(error, "cannot open " + path);
+        return false;
+    }
+    Header header;
+    std::string compressed;
+    bool ok = readHeader(f, header);
+    if (ok) {
+        std::error_code ec;
+        uint64_t fileSize = fs::file_size(path, ec);
+        ok = !ec && fileSize >= sizeof(header);
+        if (ok) {
+            compressed.resize(fileSize - sizeof(header));
+            ok = std::fread(compressed.data(), 1, compressed.size(), f) == compressed.size();
+        }
+    }
+    std::fclose(f);
+    if (!ok || !lzDecompress(compressed, header.imageSize, image) || EventLog::checksum(image) != header.crc) {
+        setError(error, path + " is truncated or corrupt");
+        return false;
+    }
+    remove(room);
+    return true;
+}
+
+void RoomArchive::remove(const std::string& room) {
+    auto it = m_rooms.find(room);
+    if (it == m_rooms.end()) return;
+    m_fileBytes -= it->second.fileBytes;
+    m_rooms.erase(it);
+    std::error_code ec;
+    fs::remove(pathFor(room), ec);
+}
+
+std::vector<std::string> RoomArchive::expired(system_clock::time_point now) const {
+    std::vector<std::string> rooms;
+    for (auto& [room, entry] : m_rooms) {
+        if (now - entry.savedAt > m_config.expireAfter) rooms.push_back(room);
+    }
+    return rooms;
+}
+
+std::string RoomArchive::pathFor(const std::string& room) const {
+    return (fs::path(m_config.dir) / (EventLog::fileStem(room) + kExtension)).string();
+}
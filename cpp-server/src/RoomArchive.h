@@ -0,0 +1,57 @@
+#pragma once
+#include <nlohmann/json.hpp>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Room hibernation, read from the "HIBERNATE" block of config.json
+struct HibernateConfig {
+    bool enabled = false;
+    std::string dir = "hibernate";
+    std::chrono::seconds idleAfter{ 300 };        // no sessions and no activity this long: evict
+    std::chrono::hours expireAfter{ 24 * 7 };     // evicted this long ago: delete for good
+
+    static HibernateConfig fromJson(const nlohmann::json& j);
+};
+
+// Rooms nobody is using, kept on disk instead of in memory. Each one is a
+// RoomSnapshot image compressed with lzCompress, in a file of its own:
+//
+//   magic "GIOHIBR1" | u64 image size | i64 saved at (unix s) | u32 crc32 of image | u32 0 | compressed image
+//
+// A room lives either here or in RoomManager, never both: take() deletes
+// the file it reads. Only the headers are read at startup. Not thread-safe;
+// RoomManager calls it under its own lock.
+class RoomArchive {
+public:
+    explicit RoomArchive(const HibernateConfig& cfg);
+
+    const HibernateConfig& config() const { return m_config; }
+    // Indexes files left by an earlier run; returns how many rooms it found
+    size_t scan();
+
+    // Compresses `image` (a RoomSnapshot image) and writes it as the room's file
+    bool save(const std::string& room, std::string_view image);
+    // Reads the room back into `image` and deletes its file
+    bool take(const std::string& room, std::string& image, std::string* error = nullptr);
+    bool contains(const std::string& room) const { return m_rooms.count(room) != 0; }
+    void remove(const std::string& room);
+    // Rooms saved more than expireAfter before `now`
+    std::vector<std::string> expired(std::chrono::system_clock::time_point now) const;
+    size_t size() const { return m_rooms.size(); }
+
+private:
+    struct Entry {
+        std::chrono::system_clock::time_point savedAt;
+        uint64_t fileBytes = 0;
+    };
+
+    std::string pathFor(const std::string& room) const;
+
+    HibernateConfig m_config;
+    std::unordered_map<std::string, Entry> m_rooms;
+    uint64_t m_fileBytes = 0; // all files together
+};
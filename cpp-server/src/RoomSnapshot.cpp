@@ -0,0 +1,129 @@
+#include "RoomSnapshot.h"
+#include <cstddef>
+#include <cstring>
+#include <utility>
+
+namespace bip = boost::interprocess;
+
+namespace {
+void setError(std::string* error, const std::string& message) {
+    if (error) *error = message;
+}
+
+template <class T>
+void appendPod(std::string& out, const T& value) {
+    out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+}
+
+void RoomSnapshot::Builder::player(std::string_view name, int64_t score) {
+    appendPod(m_players, PlayerEntry{ static_cast<uint32_t>(m_blob.size()), static_cast<uint32_t>(name.size()), score });
+    m_blob += name;
+}
+
+void RoomSnapshot::Builder::stroke(std::string_view payload) {
+    appendPod(m_strokes, StrokeEntry{ m_blob.size(), static_cast<uint32_t>(payload.size()), 0 });
+    m_blob += payload;
+}
+
+std::string RoomSnapshot::Builder::finish() const {
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.round = m_round;
+    header.playerCount = static_cast<uint32_t>(m_players.size() / sizeof(PlayerEntry));
+    header.strokeCount = static_cast<uint32_t>(m_strokes.size() / sizeof(StrokeEntry));
+    // Both tables hold 8-byte fields and are 16-byte records, so they stay aligned
+    header.playersOffset = sizeof(Header);
+    header.strokesOffset = header.playersOffset + m_players.size();
+    header.blobOffset = header.strokesOffset + m_strokes.size();
+    header.blobSize = m_blob.size();
+
+    std::string image;
+    image.reserve(header.blobOffset + m_blob.size());
+    appendPod(image, header);
+    image += m_players;
+    image += m_strokes;
+    image += m_blob;
+    return image;
+}
+
+void RoomSnapshot::setGeneration(std::string& image, uint64_t generation) {
+    if (image.size() < sizeof(Header)) return;
+    std::memcpy(image.data() + offsetof(Header, generation), &generation, sizeof(generation));
+}
+
+bool RoomSnapshot::open(const std::string& path, std::string* error) {
+    m_header = nullptr;
+    try {
+        bip::file_mapping file(path.c_str(), bip::read_only);
+        bip::mapped_region region(file, bip::read_only);
+        m_file.swap(file);
+        m_region.swap(region);
+    }
+    catch (const bip::interprocess_exception& e) {
+        setError(error, std::string("cannot map ") + path + ": " + e.what());
+        return false;
+    }
+
+    return parse(static_cast<const char*>(m_region.get_address()), m_region.get_size(), path, error);
+}
+
+bool RoomSnapshot::load(std::string image, std::string* error) {
+    m_header = nullptr;
+    m_region = bip::mapped_region();
+    m_file = bip::file_mapping();
+    m_image = std::move(image);
+    return parse(m_image.data(), m_image.size(), "snapshot image", error);
+}
+
+bool RoomSnapshot::parse(const char* base, uint64_t fileSize, const std::string& what, std::string* error) {
+    if (fileSize < sizeof(Header)) {
+        setError(error, what + " is too small");
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(base);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion) {
+        setError(error, what + " is not a version " + std::to_string(kVersion) + " room snapshot");
+        return false;
+    }
+
+    // Tables and blob must lie inside the file
+    auto fits = [&](uint64_t offset, uint64_t bytes) {
+        return offset <= fileSize && bytes <= fileSize - offset;
+    };
+    if (!fits(header->playersOffset, uint64_t(header->playerCount) * sizeof(PlayerEntry))
+        || !fits(header->strokesOffset, uint64_t(header->strokeCount) * sizeof(StrokeEntry))
+        || !fits(header->blobOffset, header->blobSize)
+        || header->playersOffset % alignof(PlayerEntry) || header->strokesOffset % alignof(StrokeEntry)) {
+        setError(error, what + " is truncated or corrupt");
+        return false;
+    }
+
+    m_players = reinterpret_cast<const PlayerEntry*>(base + header->playersOffset);
+    m_strokes = reinterpret_cast<const StrokeEntry*>(base + header->strokesOffset);
+    m_blob = base + header->blobOffset;
+    m_header = header;
+    return true;
+}
+
+std::string_view RoomSnapshot::blob(uint64_t offset, uint64_t length) const {
+    if (offset > m_header->blobSize || length > m_header->blobSize - offset) return {};
+    return std::string_view(m_blob + offset, length);
+}
+
+std::string_view RoomSnapshot::playerName(uint32_t index) const {
+    if (!m_header || index >= m_header->playerCount) return {};
+    return blob(m_players[index].nameOffset, m_players[index].nameLength);
+}
+
+int64_t RoomSnapshot::playerScore(uint32_t index) const {
+    if (!m_header || index >= m_header->playerCount) return 0;
+    return m_players[index].score;
+}
+
+std::string_view RoomSnapshot::stroke(uint32_t index) const {
+    if (!m_header || index >= m_header->strokeCount) return {};
+    return blob(m_strokes[index].offset, m_strokes[index].length);
+}
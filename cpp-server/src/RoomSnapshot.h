@@ -0,0 +1,94 @@
+#pragma once
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// One room's state in a compact file that is memory-mapped on load.
+//
+// Layout, little endian, offsets from the start of the file:
+//   Header
+//   PlayerEntry[playerCount]  in join order
+//   StrokeEntry[strokeCount]  canvas since the last clear, oldest first
+//   blob (player names and raw draw payloads, not terminated)
+//
+// A snapshot stands for everything in the room's event log up to the
+// point it was taken; the log then starts over with the same generation
+// (see EventLog). Opening checks the header and tables only; names and
+// payloads are read straight from the mapping.
+class RoomSnapshot {
+public:
+    static constexpr char kMagic[8] = { 'G', 'I', 'O', 'S', 'N', 'A', 'P', 'S' };
+    static constexpr uint32_t kVersion = 1;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t round;        // rounds played
+        uint64_t generation;   // of the event log that continues from here
+        uint32_t playerCount;
+        uint32_t strokeCount;
+        uint64_t playersOffset;
+        uint64_t strokesOffset;
+        uint64_t blobOffset;
+        uint64_t blobSize;
+    };
+
+    struct PlayerEntry {
+        uint32_t nameOffset; // into the blob
+        uint32_t nameLength;
+        int64_t score;
+    };
+
+    struct StrokeEntry {
+        uint64_t offset; // into the blob
+        uint32_t length;
+        uint32_t reserved;
+    };
+
+    // Collects a room's state, then lays it out as a file image
+    class Builder {
+    public:
+        void player(std::string_view name, int64_t score);
+        void stroke(std::string_view payload);
+        void round(uint32_t played) { m_round = played; }
+        std::string finish() const;
+
+    private:
+        uint32_t m_round = 0;
+        std::string m_players; // PlayerEntry records
+        std::string m_strokes; // StrokeEntry records
+        std::string m_blob;
+    };
+
+    // Stamps the log generation into a finished image
+    static void setGeneration(std::string& image, uint64_t generation);
+
+    // Maps `path`; returns false (and stays empty) if it is missing or malformed
+    bool open(const std::string& path, std::string* error = nullptr);
+    // Same checks on an image held in memory (one sent in a handoff)
+    bool load(std::string image, std::string* error = nullptr);
+    bool loaded() const { return m_header != nullptr; }
+
+    uint64_t generation() const { return m_header ? m_header->generation : 0; }
+    uint32_t round() const { return m_header ? m_header->round : 0; }
+    uint32_t playerCount() const { return m_header ? m_header->playerCount : 0; }
+    uint32_t strokeCount() const { return m_header ? m_header->strokeCount : 0; }
+    // Entry `index`; empty name or payload if the entry is corrupt
+    std::string_view playerName(uint32_t index) const;
+    int64_t playerScore(uint32_t index) const;
+    std::string_view stroke(uint32_t index) const;
+
+private:
+    bool parse(const char* base, uint64_t size, const std::string& what, std::string* error);
+    std::string_view blob(uint64_t offset, uint64_t length) const;
+
+    boost::interprocess::file_mapping m_file;
+    boost::interprocess::mapped_region m_region;
+    std::string m_image; // for load()
+    const Header* m_header = nullptr;
+    const PlayerEntry* m_players = nullptr;
+    const StrokeEntry* m_strokes = nullptr;
+    const char* m_blob = nullptr;
+};
@@ -0,0 +1,96 @@
+#include "RoundScheduler.h"
+
+RoundScheduler::RoundScheduler(boost::asio::io_context& io,
+    std::chrono::milliseconds resolution,
+    size_t slots)
+    : m_strand(boost::asio::make_strand(io)),
+    m_timer(m_strand),
+    m_resolution(resolution.count() > 0 ? resolution : std::chrono::milliseconds(1)) {
+    size_t size = 1;
+    while (size < slots) size <<= 1;
+    m_slots.assign(size, nullptr);
+}
+
+void RoundScheduler::start() {
+    boost::asio::post(m_strand, [this]() {
+        if (m_running) return;
+        m_running = true;
+        m_nextTick = Clock::now() + m_resolution;
+        arm();
+    });
+}
+
+void RoundScheduler::stop() {
+    boost::asio::post(m_strand, [this]() {
+        m_running = false;
+        m_timer.cancel();
+    });
+}
+
+void RoundScheduler::arm() {
+    // Absolute deadlines, so a slow tick doesn't push every later one back
+    m_timer.expires_at(m_nextTick);
+    m_timer.async_wait([this](boost::system::error_code ec) {
+        if (ec || !m_running) return;
+        onTick();
+        arm();
+    });
+}
+
+void RoundScheduler::onTick() {
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Catch up on every tick that is due if the reactor was late
+    while (m_nextTick <= now) {
+        Timer* timer = m_slots[m_cursor];
+        while (timer) {
+            Timer* next = timer->m_next;
+            if (timer->m_laps > 0) {
+                --timer->m_laps;
+            }
+            else {
+                unlink(*timer);
+                timer->m_callback();
+            }
+            timer = next;
+        }
+        m_cursor = (m_cursor + 1) & (m_slots.size() - 1);
+        m_nextTick += m_resolution;
+    }
+}
+
+void RoundScheduler::schedule(Timer& timer, Clock::duration delay) {
+    auto ticks = (std::chrono::duration_cast<std::chrono::milliseconds>(delay) + m_resolution
+        - std::chrono::milliseconds(1)) / m_resolution;
+    uint64_t distance = ticks > 0 ? static_cast<uint64_t>(ticks) : 1;
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (timer.m_armed) unlink(timer);
+    // m_cursor is the slot of the next tick, which is one tick away
+    uint64_t offset = distance - 1;
+    timer.m_laps = offset / m_slots.size();
+    link(timer, (m_cursor + offset) & (m_slots.size() - 1));
+}
+
+void RoundScheduler::cancel(Timer& timer) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (timer.m_armed) unlink(timer);
+}
+
+void RoundScheduler::link(Timer& timer, size_t slot) {
+    timer.m_slot = slot;
+    timer.m_prev = nullptr;
+    timer.m_next = m_slots[slot];
+    if (timer.m_next) timer.m_next->m_prev = &timer;
+    m_slots[slot] = &timer;
+    timer.m_armed = true;
+}
+
+void RoundScheduler::unlink(Timer& timer) {
+    if (timer.m_prev) timer.m_prev->m_next = timer.m_next;
+    else m_slots[timer.m_slot] = timer.m_next;
+    if (timer.m_next) timer.m_next->m_prev = timer.m_prev;
+    timer.m_prev = timer.m_next = nullptr;
+    timer.m_armed = false;
+}
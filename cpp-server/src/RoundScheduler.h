@@ -0,0 +1,69 @@
+#pragma once
+#include <boost/asio.hpp>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+// Hashed timing wheel shared by every room's round engine.
+//
+// One steady_timer ticks at a fixed resolution and each tick walks a single
+// slot, so thousands of rooms cost one timer and a few list hops per tick
+// instead of a timer (or thread) each. Timers are intrusive nodes owned by
+// their users: scheduling just links the node into a slot and nothing is
+// allocated after construction. Delays longer than one turn of the wheel
+// wait out the extra laps in place.
+class RoundScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    class Timer {
+    public:
+        // `callback` runs on the scheduler's strand with the wheel locked;
+        // keep it to a post() onto the owner's executor.
+        explicit Timer(std::function<void()> callback) : m_callback(std::move(callback)) {}
+        Timer(const Timer&) = delete;
+        Timer& operator=(const Timer&) = delete;
+
+        bool armed() const { return m_armed; }
+
+    private:
+        friend class RoundScheduler;
+        Timer* m_prev = nullptr;
+        Timer* m_next = nullptr;
+        size_t m_slot = 0;
+        uint64_t m_laps = 0;
+        bool m_armed = false;
+        std::function<void()> m_callback;
+    };
+
+    explicit RoundScheduler(boost::asio::io_context& io,
+        std::chrono::milliseconds resolution = std::chrono::milliseconds(50),
+        size_t slots = 1024);
+
+    void start();
+    void stop();
+
+    // (Re)arms `timer` to fire after `delay`, rounded up to the resolution
+    void schedule(Timer& timer, Clock::duration delay);
+    void cancel(Timer& timer);
+
+    std::chrono::milliseconds resolution() const { return m_resolution; }
+
+private:
+    void arm();
+    void onTick();
+    void link(Timer& timer, size_t slot);
+    void unlink(Timer& timer);
+
+    boost::asio::strand<boost::asio::io_context::executor_type> m_strand;
+    boost::asio::steady_timer m_timer;
+    std::chrono::milliseconds m_resolution;
+
+    std::mutex m_mutex;
+    std::vector<Timer*> m_slots; // list heads, size is a power of two
+    size_t m_cursor = 0;         // slot the next tick processes
+    Clock::time_point m_nextTick;
+    bool m_running = false;
+};
@@ -0,0 +1,13 @@
+#pragma once
+#include <functional>
+#include <string>
+#include <string_view>
+
+// Transparent hash so string keyed maps can be probed with a string_view
+// (e.g. a view into an IRC line) without building a temporary std::string.
+struct StringHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view s) const { return std::hash<std::string_view>{}(s); }
+    size_t operator()(const std::string& s) const { return std::hash<std::string_view>{}(s); }
+    size_t operator()(const char* s) const { return std::hash<std::string_view>{}(s); }
+};
@@ -0,0 +1,35 @@
+#include "StrokeHistory.h"
+
+void StrokeHistory::append(std::string stroke) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_strokes.push_back(std::move(stroke));
+}
+
+void StrokeHistory::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_strokes.clear();
+    ++m_epoch;
+}
+
+size_t StrokeHistory::size() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_strokes.size();
+}
+
+StrokeHistory::Mark StrokeHistory::mark() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return { m_strokes.size(), m_epoch };
+}
+
+size_t StrokeHistory::write(std::string& out, size_t from, const Mark& mark, size_t budget) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    // The canvas was cleared after the reader started; its clear follows
+    if (mark.epoch != m_epoch) return mark.end;
+
+    size_t i = from;
+    for (; i < mark.end && out.size() < budget; ++i) {
+        if (i > 0) out += ',';
+        out += m_strokes[i];
+    }
+    return i;
+}
@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// A room's canvas: every draw message since the last clear, in order, kept
+// as the exact text that was broadcast.
+//
+// Shared (by shared_ptr) between the room and any session still streaming
+// it out, so a long restore keeps working if the room goes away meanwhile.
+// Readers serialise a slice at a time under the lock rather than copying
+// the whole list.
+class StrokeHistory {
+public:
+    // Where a reader starts: entries before `end` of epoch `epoch`
+    struct Mark {
+        size_t end = 0;
+        uint64_t epoch = 0;
+    };
+
+    void append(std::string stroke);
+    void clear();
+    size_t size() const;
+    Mark mark() const;
+
+    // Appends entries [from, mark.end) to `out` as comma-separated JSON,
+    // stopping once `out` holds `budget` bytes. Returns the index to resume
+    // from; mark.end when done, or straight away if a clear came in between.
+    size_t write(std::string& out, size_t from, const Mark& mark, size_t budget) const;
+    // f(entry) for every entry, oldest first, under the lock
+    template <class F>
+    void forEach(F&& f) const;
+
+private:
+    mutable std::mutex m_mutex;
+    std::vector<std::string> m_strokes;
+    uint64_t m_epoch = 0; // bumped by clear()
+};
+
+template <class F>
+void StrokeHistory::forEach(F&& f) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const std::string& stroke : m_strokes) f(stroke);
+}
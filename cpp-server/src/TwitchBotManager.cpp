@@ -9,46 +9,101 @@
 #include <mutex>
 #include <string>
 #include <memory>
+#include <algorithm>
 #include "session.h"
 
 bool TwitchBotManager::spawnBot(const std::string& oauth,
     const std::string& nick,
     const std::string& channel) {
-    auto it = m_bots.find(channel);
-    if (it != m_bots.end()) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_server.routes().find(channel).connection) {
         std::cout << "[WARN] Bot for channel " << channel
             << " already exists, ignoring spawn.\n";
         return false;
     }
 
-    auto bot = std::make_shared<TwitchClient>(m_io, m_server, oauth, nick, channel);
-    m_bots[channel] = bot;
-    bot->connect();
+    auto conn = connectionFor(oauth, nick);
+    m_server.routes().setConnection(channel, conn);
+    conn->joinChannel(channel);
 
-    std::cout << "[INFO] Bot spawned for channel " << channel << "\n";
+    std::cout << "[INFO] Bot spawned for channel " << channel
+        << " (" << conn->channelCount() << " channels on its connection, "
+        << m_connections.size() << " connections)\n";
     return true;
 }
 
+std::shared_ptr<TwitchClient> TwitchBotManager::connectionFor(const std::string& oauth, const std::string& nick) {
+    for (auto& conn : m_connections) {
+        if (conn->isAlive() && conn->sameAccount(oauth, nick)
+            && conn->channelCount() < m_channelsPerConnection) {
+            return conn;
+        }
+    }
+
+    auto conn = std::make_shared<TwitchClient>(m_io, m_server, oauth, nick);
+    conn->setSendLimits(m_sendLimits);
+    conn->setServerConfig(m_serverConfig);
+    conn->setOnDisconnected([this](std::shared_ptr<TwitchClient> lost) {
+        onConnectionLost(lost);
+    });
+    m_connections.push_back(conn);
+    conn->connect();
+    return conn;
+}
+
+void TwitchBotManager::onConnectionLost(std::shared_ptr<TwitchClient> conn) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto pos = std::find(m_connections.begin(), m_connections.end(), conn);
+    if (pos == m_connections.end()) return;
+
+    // Rebalance: move lost channels onto healthy connections that have room.
+    // Whatever doesn't fit stays put and rejoins when this one reconnects.
+    size_t moved = 0;
+    auto lostChannels = conn->channels();
+    for (auto& channel : lostChannels) {
+        if (m_server.routes().find(channel).connection != conn) continue;
+
+        std::shared_ptr<TwitchClient> target;
+        for (auto& other : m_connections) {
+            if (other != conn && other->isAlive() && other->sameAccount(conn->oauth(), conn->nick())
+                && other->channelCount() < m_channelsPerConnection) {
+                target = other;
+                break;
+            }
+        }
+        if (!target) break;
+
+        conn->partChannel(channel);
+        target->joinChannel(channel);
+        m_server.routes().setConnection(channel, target);
+        ++moved;
+    }
+    std::cout << "[WARN] Twitch connection dropped, moved " << moved << " of "
+        << lostChannels.size() << " channels to other connections\n";
+
+    // An empty connection has nothing to reconnect for
+    if (conn->channelCount() == 0) {
+        conn->disconnect();
+        m_connections.erase(pos);
+    }
+}
+
 void TwitchBotManager::stopBot(const std::string& channel) {
-    auto it = m_bots.find(channel);
-    if (it != m_bots.end()) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto conn = m_server.routes().find(channel).connection;
+    if (conn) {
         std::cout << "[INFO] Stopping bot for channel " << channel << "\n";
-        it->second->disconnect();   // implement this in TwitchClient
-        m_bots.erase(it);
+        m_server.routes().setConnection(channel, nullptr);
+        conn->partChannel(channel);
+
+        // Close the connection once it carries nothing
+        if (conn->channelCount() == 0) {
+            conn->disconnect();
+            m_connections.erase(std::remove(m_connections.begin(), m_connections.end(), conn), m_connections.end());
+        }
     }
     else {
         std::cout << "[WARN] Tried to stop bot for channel "
             << channel << " but none exists.\n";
     }
 }
-
-void TwitchBotManager::setCurrentRoom(const std::string& channel, const std::string& roomName) {
-    // Set current room for the specific channel's bot
-    auto it = m_bots.find(channel);
-    if (it != m_bots.end()) {
-        it->second->setCurrentRoom(channel, roomName);
-        std::cout << "[DEBUG] Set current room for channel " << channel << " to: " << roomName << std::endl;
-    } else {
-        std::cout << "[WARN] No bot found for channel " << channel << " when setting room " << roomName << std::endl;
-    }
-}
\ No newline at end of file
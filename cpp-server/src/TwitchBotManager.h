@@ -26,13 +26,27 @@ public:
         : m_io(io), m_server(server) {
     }
 
+    // Channels JOINed per IRC connection before a new one is opened
+    void setChannelsPerConnection(size_t n) { m_channelsPerConnection = n ? n : 1; }
+    // Outbound pacing applied to connections opened from now on
+    void setSendLimits(const IrcSendLimits& limits) { m_sendLimits = limits; }
+    void setServerConfig(const IrcServerConfig& cfg) { m_serverConfig = cfg; }
+
     bool spawnBot(const std::string& oauth,
         const std::string& nick,
         const std::string& channel);
     void stopBot(const std::string& channel);  // add this
-    void setCurrentRoom(const std::string& channel, const std::string& roomName); // Set current room for specific channel
 private:
+    // Picks a live connection for this account with spare capacity, or opens one. Caller holds m_mutex.
+    std::shared_ptr<TwitchClient> connectionFor(const std::string& oauth, const std::string& nick);
+    void onConnectionLost(std::shared_ptr<TwitchClient> conn);
+
     boost::asio::io_context& m_io;
     Server& m_server;
-    std::unordered_map<std::string, std::shared_ptr<TwitchClient>> m_bots;
+    size_t m_channelsPerConnection = 50;
+    IrcSendLimits m_sendLimits;
+    IrcServerConfig m_serverConfig;
+
+    std::mutex m_mutex;
+    std::vector<std::shared_ptr<TwitchClient>> m_connections; // which channel rides which one is in Server::routes()
 };
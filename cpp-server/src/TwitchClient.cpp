@@ -1,230 +1,463 @@
 ﻿#include "TwitchClient.h"
 #include "server.h"
 #include <iostream>
+#include <random>
+#include "GuessEngine.h"
+#include "IngestStats.h"
+#include <charconv>
 #include <nlohmann/json.hpp>
 
 using json = nlohmann::json;
+using boost::asio::ip::tcp;
+
+// Resolved endpoints shared by every connection, so reconnect storms and
+// new connections don't each pay for a DNS round trip.
+namespace {
+struct CachedEndpoints {
+    tcp::resolver::results_type endpoints;
+    std::chrono::steady_clock::time_point expires;
+};
+
+std::mutex g_dnsMutex;
+std::unordered_map<std::string, CachedEndpoints> g_dnsCache;
+
+bool lookupCached(const std::string& key, tcp::resolver::results_type& out) {
+    std::lock_guard<std::mutex> lock(g_dnsMutex);
+    auto it = g_dnsCache.find(key);
+    if (it == g_dnsCache.end() || it->second.expires < std::chrono::steady_clock::now()) return false;
+    out = it->second.endpoints;
+    return true;
+}
+
+void storeCached(const std::string& key, const tcp::resolver::results_type& endpoints, std::chrono::seconds ttl) {
+    std::lock_guard<std::mutex> lock(g_dnsMutex);
+    g_dnsCache[key] = { endpoints, std::chrono::steady_clock::now() + ttl };
+}
+
+void forgetCached(const std::string& key) {
+    std::lock_guard<std::mutex> lock(g_dnsMutex);
+    g_dnsCache.erase(key);
+}
+}
 
 TwitchClient::TwitchClient(boost::asio::io_context& io,
     Server& server,
     const std::string& oauth,
-    const std::string& nick,
-    const std::string& channel)
+    const std::string& nick)
     : m_resolver(io),
     m_socket(io),
+    m_strand(boost::asio::make_strand(io)),
+    m_sendTimer(m_strand),
     m_server(server),
     m_oauth(oauth),
     m_nick(nick),
-    m_channel(channel),
-    m_channelRooms() { // Initialize empty
+    m_reconnectTimer(m_strand),
+    m_dedupTimer(m_strand) {
+    m_userLimiter.configure(server.rateLimits().twitchUser, server.rateLimits().maxTrackedUsers);
+    setSendLimits(IrcSendLimits());
+}
+
+void TwitchClient::setSendLimits(const IrcSendLimits& limits) {
+    m_sendLimits = limits;
+    m_messageBucket.configure(limits.messagesPer30s / 30.0, limits.messagesPer30s);
+    m_joinBucket.configure(limits.joinsPer10s / 10.0, limits.joinsPer10s);
 }
 
 void TwitchClient::connect() {
     auto self = shared_from_this(); // keep alive
-    auto endpoints = m_resolver.resolve("irc.chat.twitch.tv", "6667");
+    std::string key = m_serverConfig.host + ":" + m_serverConfig.port;
+
+    tcp::resolver::results_type endpoints;
+    if (lookupCached(key, endpoints)) {
+        connectTo(endpoints);
+        return;
+    }
+
+    // Never resolve synchronously: it would stall every session on this thread
+    m_resolver.async_resolve(m_serverConfig.host, m_serverConfig.port,
+        boost::asio::bind_executor(m_strand,
+            [self, key](boost::system::error_code ec, tcp::resolver::results_type results) {
+                if (ec) {
+                    self->fail("resolve", ec);
+                    return;
+                }
+                storeCached(key, results, self->m_serverConfig.dnsTtl);
+                self->connectTo(results);
+            }));
+}
+
+void TwitchClient::connectTo(const tcp::resolver::results_type& endpoints) {
+    auto self = shared_from_this(); // keep alive
     boost::asio::async_connect(m_socket, endpoints,
-        [self](boost::system::error_code ec, const auto&) {
-            if (!ec) {
-                self->login();
-            }
-            else {
-                std::cerr << "Twitch connect error: " << ec.message() << "\n";
-            }
+        boost::asio::bind_executor(m_strand,
+            [self](boost::system::error_code ec, const auto&) {
+                if (!ec) {
+                    self->login();
+                }
+                else {
+                    // The cached address may be stale, resolve again next time
+                    forgetCached(self->m_serverConfig.host + ":" + self->m_serverConfig.port);
+                    self->fail("connect", ec);
+                }
+            }));
+}
+
+void TwitchClient::fail(const std::string& what, const boost::system::error_code& ec) {
+    if (m_stopped) return;
+    std::cerr << "Twitch " << what << " error: " << ec.message() << "\n";
+
+    {
+        std::lock_guard<std::mutex> lock(m_channelsMutex);
+        m_loggedIn = false;
+    }
+    // The manager moves what it can to healthy connections, once per drop
+    if (m_alive.exchange(false) && m_onDisconnected) {
+        m_onDisconnected(shared_from_this());
+    }
+    scheduleReconnect();
+}
+
+void TwitchClient::scheduleReconnect() {
+    boost::asio::post(m_strand, [self = shared_from_this()]() {
+        if (self->m_stopped) return;
+        if (self->channelCount() == 0) {
+            std::cout << "[INFO] Twitch connection for " << self->m_nick << " has no channels left, not reconnecting\n";
+            return;
+        }
+
+        boost::system::error_code ignored;
+        self->m_socket.close(ignored);
+
+        // Exponential backoff with jitter so dropped bots don't reconnect in lockstep
+        static thread_local std::mt19937 rng{ std::random_device{}() };
+        unsigned shift = std::min(self->m_reconnectAttempts, 16u);
+        auto cap = std::min(self->m_serverConfig.reconnectMax, self->m_serverConfig.reconnectBase * (1u << shift));
+        std::uniform_int_distribution<long long> jitter(cap.count() / 2, cap.count());
+        auto delay = std::chrono::milliseconds(jitter(rng));
+        ++self->m_reconnectAttempts;
+
+        std::cout << "[INFO] Reconnecting Twitch connection for " << self->m_nick
+            << " in " << delay.count() << "ms (attempt " << self->m_reconnectAttempts << ")\n";
+
+        self->m_reconnectTimer.expires_after(delay);
+        self->m_reconnectTimer.async_wait([self](boost::system::error_code ec) {
+            if (ec || self->m_stopped) return;
+            // Stale handshake lines and JOINs are rebuilt by login()
+            self->m_controlQueue.clear();
+            self->m_joinQueue.clear();
+            self->connect();
         });
+    });
 }
 
 void TwitchClient::login() {
     auto self = shared_from_this(); // keep alive
-    m_buffer.consume(m_buffer.size());
+    m_framer.reset();
 
     send("CAP REQ :twitch.tv/tags twitch.tv/commands twitch.tv/membership\r\n");
     send("PASS " + m_oauth + "\r\n");
     send("NICK " + m_nick + "\r\n");
-    send("JOIN " + m_channel + "\r\n");
 
+    std::vector<std::string> joins;
+    {
+        std::lock_guard<std::mutex> lock(m_channelsMutex);
+        m_loggedIn = true;
+        for (auto& channel : m_joined) {
+            joins.push_back("JOIN " + channel + "\r\n");
+        }
+    }
+    // Each JOIN is paced by the join bucket
+    for (auto& join : joins) send(std::move(join));
+
+    scheduleDedupFlush();
     doRead();
 }
 
-void TwitchClient::send(const std::string& msg) {
-    auto self = shared_from_this(); // keep alive
-    auto buffer = std::make_shared<std::string>(msg);
-    boost::asio::async_write(m_socket, boost::asio::buffer(*buffer),
-        [self, buffer](boost::system::error_code ec, std::size_t) {
-            if (ec) {
-                std::cerr << "Twitch send error: " << ec.message() << "\n";
-            }
+void TwitchClient::joinChannel(const std::string& channel) {
+    bool sendJoin;
+    {
+        std::lock_guard<std::mutex> lock(m_channelsMutex);
+        m_joined.insert(channel);
+        sendJoin = m_loggedIn;
+    }
+    // Before login the JOIN goes out with the rest of the handshake
+    if (sendJoin) send("JOIN " + channel + "\r\n");
+}
+
+void TwitchClient::partChannel(const std::string& channel) {
+    bool sendPart;
+    {
+        std::lock_guard<std::mutex> lock(m_channelsMutex);
+        sendPart = m_joined.erase(channel) > 0 && m_loggedIn;
+    }
+    if (sendPart) send("PART " + channel + "\r\n");
+    boost::asio::post(m_strand, [self = shared_from_this(), channel]() {
+        self->m_dedup.erase(channel);
+    });
+}
+
+void TwitchClient::scheduleDedupFlush() {
+    if (m_dedupTimerArmed || m_stopped) return;
+    m_dedupTimerArmed = true;
+    m_dedupTimer.expires_after(ChatDedup::Config().window);
+    m_dedupTimer.async_wait([self = shared_from_this()](boost::system::error_code ec) {
+        self->m_dedupTimerArmed = false;
+        if (ec || self->m_stopped) return;
+        self->flushDedup();
+        self->scheduleDedupFlush();
+    });
+}
+
+void TwitchClient::flushDedup() {
+    auto now = std::chrono::steady_clock::now();
+    ChannelRouter::Snapshot routes = m_server.routes().snapshot();
+    for (auto& [channel, dedup] : m_dedup) {
+        auto route = routes->channels.find(channel);
+        std::string room = route != routes->channels.end() && !route->second.room.empty()
+            ? route->second.room : channel.substr(1);
+        dedup.flush(now, [&](std::string_view text, uint32_t count) {
+            m_server.roomManager().post(ChatEvent{ room, "", std::string(text), count });
         });
+    }
+}
+
+size_t TwitchClient::channelCount() const {
+    std::lock_guard<std::mutex> lock(m_channelsMutex);
+    return m_joined.size();
 }
-void TwitchClient::disconnect() {
-    if (m_socket.is_open()) {
-        // Send PART so Twitch IRC knows we’re leaving the channel
-        std::string partCmd = "PART " + m_channel + "\r\n";
-        boost::asio::write(m_socket, boost::asio::buffer(partCmd));
 
-        std::string quitCmd = "QUIT\r\n";
-        boost::asio::write(m_socket, boost::asio::buffer(quitCmd));
+std::vector<std::string> TwitchClient::channels() const {
+    std::lock_guard<std::mutex> lock(m_channelsMutex);
+    return { m_joined.begin(), m_joined.end() };
+}
 
-        // Close the socket
-        boost::system::error_code ec;
-        m_socket.close(ec);
+bool TwitchClient::sameAccount(const std::string& oauth, const std::string& nick) const {
+    return m_oauth == oauth && m_nick == nick;
+}
 
-        if (!ec) {
-            std::cout << "[INFO] Disconnected from channel " << m_channel << "\n";
+void TwitchClient::send(std::string line) {
+    boost::asio::post(m_strand, [self = shared_from_this(), line = std::move(line)]() mutable {
+        self->enqueue(std::move(line));
+    });
+}
+
+void TwitchClient::enqueue(std::string line) {
+    if (m_closeAfterFlush) return;
+
+    std::deque<std::string>* queue = &m_messageQueue;
+    if (line.rfind("JOIN ", 0) == 0 || line.rfind("PART ", 0) == 0) {
+        queue = &m_joinQueue;
+    }
+    else if (line.rfind("PRIVMSG ", 0) != 0) {
+        queue = &m_controlQueue; // PONG, CAP, PASS, NICK, QUIT
+    }
+
+    // Smooth bursts, but never grow without bound
+    if (queue != &m_controlQueue && queue->size() >= m_sendLimits.maxQueuedLines) {
+        std::cerr << "[WARN] Twitch send queue full for " << m_nick << ", dropping oldest line\n";
+        queue->pop_front();
+    }
+
+    // PONG must beat everything else out of the door
+    if (line.rfind("PONG", 0) == 0) queue->push_front(std::move(line));
+    else queue->push_back(std::move(line));
+
+    doWrite();
+}
+
+void TwitchClient::doWrite() {
+    if (m_writing || !m_socket.is_open()) return;
+
+    auto now = std::chrono::steady_clock::now();
+    m_writeBuffer.clear();
+
+    auto take = [&](std::deque<std::string>& queue, TokenBucket* bucket) {
+        while (!queue.empty() && m_writeBuffer.size() < m_sendLimits.maxBatchBytes) {
+            if (bucket && !bucket->tryConsume(now)) break;
+            m_writeBuffer += queue.front();
+            queue.pop_front();
         }
-        else {
-            std::cout << "[ERROR] Failed to close socket for " << m_channel
-                << ": " << ec.message() << "\n";
+    };
+    take(m_controlQueue, nullptr);
+    take(m_joinQueue, &m_joinBucket);
+    take(m_messageQueue, &m_messageBucket);
+
+    if (m_writeBuffer.empty()) {
+        if (m_closeAfterFlush && m_controlQueue.empty()) {
+            boost::system::error_code ec;
+            m_socket.close(ec);
+            return;
         }
+        // Everything left is waiting on a bucket; wake up when one refills
+        if ((!m_joinQueue.empty() || !m_messageQueue.empty()) && !m_sendTimerArmed) {
+            auto wait = std::chrono::steady_clock::duration::max();
+            if (!m_joinQueue.empty()) wait = std::min(wait, m_joinBucket.timeUntil(now));
+            if (!m_messageQueue.empty()) wait = std::min(wait, m_messageBucket.timeUntil(now));
+
+            m_sendTimerArmed = true;
+            m_sendTimer.expires_after(wait);
+            m_sendTimer.async_wait([self = shared_from_this()](boost::system::error_code ec) {
+                self->m_sendTimerArmed = false;
+                if (!ec) self->doWrite();
+            });
+        }
+        return;
     }
+
+    m_writing = true;
+    boost::asio::async_write(m_socket, boost::asio::buffer(m_writeBuffer),
+        boost::asio::bind_executor(m_strand,
+            [self = shared_from_this()](boost::system::error_code ec, std::size_t) {
+                self->m_writing = false;
+                if (ec) {
+                    std::cerr << "Twitch send error: " << ec.message() << "\n";
+                    return;
+                }
+                self->doWrite();
+            }));
+}
+
+void TwitchClient::disconnect() {
+    m_alive = false; // deliberate, nobody needs to take our channels
+    m_stopped = true;
+    boost::asio::post(m_strand, [self = shared_from_this()]() { self->m_reconnectTimer.cancel(); });
+
+    // PART everything and QUIT through the queue, then close once it drains
+    for (auto& channel : channels()) {
+        send("PART " + channel + "\r\n");
+    }
+    boost::asio::post(m_strand, [self = shared_from_this()]() {
+        // Pending PARTs are not worth waiting on a bucket for
+        for (auto& line : self->m_joinQueue) self->m_controlQueue.push_back(std::move(line));
+        self->m_joinQueue.clear();
+        self->m_messageQueue.clear();
+        self->m_controlQueue.push_back("QUIT\r\n");
+        self->m_closeAfterFlush = true;
+        self->doWrite();
+        std::cout << "[INFO] Disconnecting Twitch connection for " << self->m_nick << "\n";
+    });
 }
 
 void TwitchClient::doRead() {
     auto self = shared_from_this(); // keep alive
-    boost::asio::async_read_until(m_socket, m_buffer, "\r\n",
-        [self](boost::system::error_code ec, std::size_t) {
-            if (!ec) {
-                std::istream is(&self->m_buffer);
-                std::string line;
-
-                while (std::getline(is, line)) {
-                    if (!line.empty() && line.back() == '\r')
-                        line.pop_back();
-                    if (line.empty()) continue;
-
-                    std::cout << "[RAW] " << line << "\n";
-
-                    // PING
-                    if (line.rfind("PING", 0) == 0) {
-                        self->send("PONG :tmi.twitch.tv\r\n");
-                        continue;
-                    }
-
-                    // Connected
-                    if (line.find(" 001 ") != std::string::npos) {
-                        json okMsg = {
-                            {"type","status"},
-                            {"status","ok"},
-                            {"message","Bot connected to Twitch IRC"},
-                            {"channel", self->m_channel}
-                        };
-                        std::cout << "[DEBUG] TwitchClient connected to channel "
-                            << self->m_channel << std::endl;
-                        self->m_server.onClientMessage(nullptr, okMsg.dump());
-                        continue;
-                    }
-
-                    // PRIVMSG (chat)
-                    if (line.find("PRIVMSG") != std::string::npos) {
-                        // --- Extract chatter username ---
-                        std::string username;
-
-                        // Modern Twitch IRC format: @display-name=username;login=username;...
-                        if (line[0] == '@') {
-                            // Look for display-name tag first
-                            size_t dnPos = line.find("display-name=");
-                            if (dnPos != std::string::npos) {
-                                size_t end = line.find(';', dnPos);
-                                if (end == std::string::npos) end = line.find(' ', dnPos);
-                                if (end != std::string::npos) {
-                                    username = line.substr(dnPos + 13, end - (dnPos + 13));
-                                }
-                            }
-
-                            // Fallback to login tag if display-name failed
-                            if (username.empty()) {
-                                size_t loginPos = line.find("login=");
-                                if (loginPos != std::string::npos) {
-                                    size_t end = line.find(';', loginPos);
-                                    if (end == std::string::npos) end = line.find(' ', loginPos);
-                                    if (end != std::string::npos) {
-                                        username = line.substr(loginPos + 6, end - (loginPos + 6));
-                                    }
-                                }
-                            }
-                        }
-
-                        // Legacy fallback: extract from IRC format
-                        if (username.empty()) {
-                            size_t exMark = line.find('!');
-                            if (exMark != std::string::npos && exMark > 1) {
-                                username = line.substr(1, exMark - 1);
-                            }
-                        }
-
-                        // --- Extract only the actual chat message (after the last ':') ---
-                        std::string message;
-                        size_t lastColon = line.rfind(':');
-                        if (lastColon != std::string::npos) {
-                            message = line.substr(lastColon + 1);  // after last colon → "!join"
-                        }
-
-                        std::cout << "[CHAT] " << username << ": " << message << "\n";
-                        std::cout << "[DEBUG] Raw IRC line: " << line << std::endl;
-                        std::cout << "[DEBUG] Extracted username: " << username << std::endl;
-                        std::cout << "[DEBUG] Extracted message: " << message << std::endl;
-                        std::cout << "[DEBUG] Username empty? " << (username.empty() ? "YES" : "NO") << std::endl;
-                        std::cout << "[DEBUG] Line starts with @? " << (line[0] == '@' ? "YES" : "NO") << std::endl;
-                        std::cout << "[DEBUG] Found display-name at: " << line.find("display-name=") << std::endl;
-                        std::cout << "[DEBUG] Found login at: " << line.find("login=") << std::endl;
-
-                        std::cout << "[DEBUG] Parsed message: " << message << std::endl;
-
-                        // --- Handle commands ---
-                        if (message.rfind("!join", 0) == 0) {
-                            // Get the current room for this specific channel
-                            std::string targetRoom;
-                            auto it = self->m_channelRooms.find(self->m_channel);
-                            if (it != self->m_channelRooms.end()) {
-                                targetRoom = it->second;
-                                std::cout << "[DEBUG] Using tracked room for channel " << self->m_channel << ": " << targetRoom << std::endl;
-                            } else {
-                                // Fallback: use channel name if no room is tracked
-                                targetRoom = self->m_channel.substr(1);
-                                std::cout << "[DEBUG] No room tracked for channel " << self->m_channel << ", using fallback: " << targetRoom << std::endl;
-                            }
-                            
-                            json joinMsg = {
-                                {"type","join"},
-                                {"room", targetRoom},
-                                {"payload", username}
-                            };
-                            std::cout << "[DEBUG] TwitchClient sending join event to room: "
-                                << targetRoom << " - " << joinMsg.dump() << std::endl;
-                            self->m_server.onClientMessage(nullptr, joinMsg.dump());
-                        }
-                        else if (message.rfind("!guess ", 0) == 0) {
-                            std::string guess = message.substr(7);
-                            json guessMsg = {
-                                {"type","chat"},
-                                {"room", self->m_channel.substr(1)},
-                                {"payload", username + " guessed: " + guess}
-                            };
-                            std::cout << "[DEBUG] TwitchClient sending guess event: "
-                                << guessMsg.dump() << std::endl;
-                            self->m_server.onClientMessage(nullptr, guessMsg.dump());
-                        }
-                        else {
-                            json chatMsg = {
-                                {"type","chat"},
-                                {"room", self->m_channel.substr(1)},
-                                {"payload", username + ": " + message}
-                            };
-                            std::cout << "[DEBUG] TwitchClient sending chat event: "
-                                << chatMsg.dump() << std::endl;
-                            self->m_server.onClientMessage(nullptr, chatMsg.dump());
-                        }
-                    }
-                }
-
-                self->doRead(); // keep reading
-            }
-            else {
-                std::cerr << "Twitch read error: " << ec.message() << "\n";
+    m_socket.async_read_some(m_framer.prepare(), boost::asio::bind_executor(m_strand,
+        [self](boost::system::error_code ec, std::size_t bytes) {
+            if (ec) {
+                self->fail("read", ec);
+                return;
             }
-        });
+
+            // One read usually carries many lines on a busy channel
+            self->m_framer.commit(bytes);
+            self->m_framer.consumeLines([&self](std::string_view line) {
+                self->handleLine(line);
+            });
+
+            self->doRead(); // keep reading
+        }));
 }
 
-void TwitchClient::setCurrentRoom(const std::string& channel, const std::string& roomName) {
-    m_channelRooms[channel] = roomName;
-    std::cout << "[DEBUG] TwitchClient set room for channel " << channel << " to: " << roomName << std::endl;
+void TwitchClient::handleLine(std::string_view line) {
+    IrcMessage& irc = m_message;
+    if (!parseIrcLine(line, irc)) return;
+
+    // PING
+    if (irc.command == "PING") {
+        std::string pong = "PONG :";
+        pong.append(irc.hasTrailing ? irc.trailing : std::string_view("tmi.twitch.tv"));
+        pong += "\r\n";
+        send(pong);
+        return;
+    }
+
+    // Connected
+    if (irc.command == "001") {
+        m_alive = true;
+        boost::asio::post(m_strand, [self = shared_from_this()]() { self->m_reconnectAttempts = 0; });
+        for (auto& channel : channels()) {
+            json okMsg = {
+                {"type","status"},
+                {"status","ok"},
+                {"message","Bot connected to Twitch IRC"},
+                {"channel", channel}
+            };
+            std::cout << "[DEBUG] TwitchClient connected to channel "
+                << channel << std::endl;
+            m_server.onClientMessage(nullptr, okMsg.dump());
+        }
+        return;
+    }
+
+    if (irc.command != "PRIVMSG" || !irc.hasTrailing) return;
+
+    // Lines stamped by a load generator report their latency once handled,
+    // whichever way this function returns
+    struct IngestRecorder {
+        int64_t sentNs = 0;
+        ~IngestRecorder() { if (sentNs) IngestStats::record(sentNs); }
+    } ingest;
+    if (std::string_view sent = irc.tag(IngestStats::kSentTag); !sent.empty()) {
+        std::from_chars(sent.data(), sent.data() + sent.size(), ingest.sentNs);
+    }
+
+    // Demultiplex by channel against one routing snapshot. Lines for
+    // channels we parted or that moved to another connection are dropped.
+    std::string_view channelView = irc.channel();
+    ChannelRouter::Snapshot routes = m_server.routes().snapshot();
+    auto route = routes->channels.find(channelView);
+    if (route == routes->channels.end() || route->second.connection.get() != this) return;
+    const std::string& channel = route->first;
+    const std::string& trackedRoom = route->second.room;
+
+    // --- Extract chatter username: display-name, then login, then prefix nick ---
+    std::string_view name = irc.tag("display-name");
+    if (name.empty()) name = irc.tag("login");
+    if (name.empty()) name = irc.nick();
+    if (name.empty()) return;
+
+    if (name.find('\\') != std::string_view::npos) {
+        unescapeTagValue(name, m_username);
+    }
+    else {
+        m_username.assign(name.data(), name.size());
+    }
+    const std::string& username = m_username;
+
+    // The whole trailing param is the message, colons included
+    std::string_view message = irc.trailing;
+
+    // --- Per chatter rate limit, before any JSON is built ---
+    MessageKind kind = classifyChatCommand(message);
+    if (!m_userLimiter.allow(username, kind)) {
+        RateLimitStats::recordThrottled(RateLimitStats::Scope::TwitchUser, kind);
+        return;
+    }
+
+    // Chat and guesses go to the room the streamer opened, else the channel's own
+    auto targetRoom = [&]() { return trackedRoom.empty() ? channel.substr(1) : trackedRoom; };
+
+    // --- Handle commands ---
+    if (message.rfind("!join", 0) == 0) {
+        if (trackedRoom.empty()) {
+            std::cout << "[DEBUG] No room tracked for channel " << channel << ", using fallback: " << channel.substr(1) << std::endl;
+        }
+        m_server.roomManager().post(JoinEvent{ targetRoom(), username });
+    }
+    else if (message.rfind("!guess ", 0) == 0) {
+        m_server.roomManager().post(GuessEvent{ targetRoom(), username, std::string(message.substr(7)) });
+    }
+    else {
+        // Collapse repeats before they fan out to every viewer
+        auto it = m_dedup.find(channelView);
+        if (it == m_dedup.end()) it = m_dedup.try_emplace(channel).first;
+        ChatDedup& dedup = it->second;
+
+        dedup.flush(std::chrono::steady_clock::now(), [&](std::string_view text, uint32_t count) {
+            m_server.roomManager().post(ChatEvent{ targetRoom(), "", std::string(text), count });
+        });
+        normalizeGuess(message, m_dedupKey);
+        if (dedup.offer(m_dedupKey, message) == ChatDedup::Verdict::Forward) {
+            m_server.roomManager().post(ChatEvent{ targetRoom(), username, std::string(message) });
+        }
+    }
 }
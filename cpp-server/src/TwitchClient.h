@@ -1,34 +1,120 @@
 ﻿#pragma once
 #include <boost/asio.hpp>
+#include <deque>
+#include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include "server.h"
+#include "RateLimiter.h"
+#include "IrcParser.h"
+#include "StringHash.h"
+#include "ChatDedup.h"
 #include <unordered_map>
+#include <unordered_set>
 
+// Outbound budgets, defaults match Twitch's limits for a regular account
+struct IrcSendLimits {
+    double messagesPer30s = 20;  // PRIVMSG
+    double joinsPer10s = 20;     // JOIN / PART
+    size_t maxQueuedLines = 1000;
+    size_t maxBatchBytes = 4096;
+};
+
+// Where to connect and how to back off when the connection drops
+struct IrcServerConfig {
+    std::string host = "irc.chat.twitch.tv";
+    std::string port = "6667";
+    std::chrono::milliseconds reconnectBase{ 1000 };
+    std::chrono::milliseconds reconnectMax{ 60000 };
+    std::chrono::seconds dnsTtl{ 300 };
+};
+
+// One IRC connection that can carry many channels. PRIVMSGs are
+// demultiplexed by their channel param.
 class TwitchClient : public std::enable_shared_from_this<TwitchClient> {
 public:
+    using DisconnectHandler = std::function<void(std::shared_ptr<TwitchClient>)>;
+
     TwitchClient(boost::asio::io_context& io,
         Server& server,
         const std::string& oauth,
-        const std::string& nick,
-        const std::string& channel);
+        const std::string& nick);
 
+    void setServerConfig(const IrcServerConfig& cfg) { m_serverConfig = cfg; }
     void connect();
     void disconnect();
-    void setCurrentRoom(const std::string& channel, const std::string& roomName);
+    void setOnDisconnected(DisconnectHandler handler) { m_onDisconnected = std::move(handler); }
+    void setSendLimits(const IrcSendLimits& limits);
+
+    // Which room a channel's chat goes to lives in the server's ChannelRouter
+    void joinChannel(const std::string& channel);
+    void partChannel(const std::string& channel);
+
+    size_t channelCount() const;
+    // Channels currently carried by this connection
+    std::vector<std::string> channels() const;
+    bool sameAccount(const std::string& oauth, const std::string& nick) const;
+    bool isAlive() const { return m_alive; }
+    const std::string& oauth() const { return m_oauth; }
+    const std::string& nick() const { return m_nick; }
 
 private:
     void login();
     void doRead();
-    void send(const std::string& msg);
+    void handleLine(std::string_view line);
+    // Queues one CRLF terminated line; safe from any thread
+    void send(std::string line);
+    void enqueue(std::string line);
+    void doWrite();
+    void connectTo(const boost::asio::ip::tcp::resolver::results_type& endpoints);
+    void fail(const std::string& what, const boost::system::error_code& ec);
+    void scheduleReconnect();
+    void scheduleDedupFlush();
+    void flushDedup();
 
     boost::asio::ip::tcp::resolver m_resolver;
     boost::asio::ip::tcp::socket m_socket;
-    boost::asio::streambuf m_buffer;
+    boost::asio::strand<boost::asio::io_context::executor_type> m_strand;
+
+    // Outbound queue, only touched on m_strand. A single writer drains it in
+    // batches; PONG and handshake lines jump ahead of rate limited traffic.
+    std::deque<std::string> m_controlQueue;
+    std::deque<std::string> m_joinQueue;
+    std::deque<std::string> m_messageQueue;
+    std::string m_writeBuffer;
+    bool m_writing = false;
+    bool m_closeAfterFlush = false;
+    IrcSendLimits m_sendLimits;
+    TokenBucket m_joinBucket;
+    TokenBucket m_messageBucket;
+    boost::asio::steady_timer m_sendTimer;
+    bool m_sendTimerArmed = false;
+    LineFramer m_framer;
+    IrcMessage m_message;   // reused for every line
+    std::string m_username; // reused unescape buffer
 
     Server& m_server;
     std::string m_oauth;
     std::string m_nick;
-    std::string m_channel;
-    std::unordered_map<std::string, std::string> m_channelRooms; // Track current room per channel
+
+    mutable std::mutex m_channelsMutex;
+    // Channels ("#name") to (re)JOIN on this connection
+    std::unordered_set<std::string, StringHash, std::equal_to<>> m_joined;
+    bool m_loggedIn = false;
+    std::atomic<bool> m_alive{ true };
+    std::atomic<bool> m_stopped{ false };
+    IrcServerConfig m_serverConfig;
+    boost::asio::steady_timer m_reconnectTimer;
+    unsigned m_reconnectAttempts = 0; // strand only
+    DisconnectHandler m_onDisconnected;
+
+    UserRateLimiter m_userLimiter; // per chatter budgets, read loop only
+
+    // Per channel spam collapsing, strand only
+    std::unordered_map<std::string, ChatDedup, StringHash, std::equal_to<>> m_dedup;
+    std::string m_dedupKey; // reused normalisation buffer
+    boost::asio::steady_timer m_dedupTimer;
+    bool m_dedupTimerArmed = false;
 };
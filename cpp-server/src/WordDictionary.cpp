@@ -0,0 +1,207 @@
+#include "WordDictionary.h"
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <numeric>
+#include <set>
+#include <vector>
+
+namespace bip = boost::interprocess;
+
+namespace {
+void setError(std::string* error, const std::string& message) {
+    if (error) *error = message;
+}
+}
+
+bool WordDictionary::open(const std::string& path, std::string* error) {
+    m_header = nullptr;
+    try {
+        bip::file_mapping file(path.c_str(), bip::read_only);
+        bip::mapped_region region(file, bip::read_only);
+        m_file.swap(file);
+        m_region.swap(region);
+    }
+    catch (const bip::interprocess_exception& e) {
+        setError(error, std::string("cannot map ") + path + ": " + e.what());
+        return false;
+    }
+
+    const char* base = static_cast<const char*>(m_region.get_address());
+    uint64_t fileSize = m_region.get_size();
+    if (fileSize < sizeof(Header)) {
+        setError(error, path + " is too small");
+        return false;
+    }
+
+    const Header* header = reinterpret_cast<const Header*>(base);
+    if (std::memcmp(header->magic, kMagic, sizeof(kMagic)) != 0 || header->version != kVersion) {
+        setError(error, path + " is not a version " + std::to_string(kVersion) + " word dictionary");
+        return false;
+    }
+
+    // Tables and blob must lie inside the file
+    auto fits = [&](uint64_t offset, uint64_t bytes) {
+        return offset <= fileSize && bytes <= fileSize - offset;
+    };
+    if (!fits(header->themesOffset, uint64_t(header->themeCount) * sizeof(ThemeEntry))
+        || !fits(header->wordsOffset, uint64_t(header->wordCount) * sizeof(WordEntry))
+        || !fits(header->stringsOffset, header->stringsSize)
+        || header->themesOffset % alignof(ThemeEntry) || header->wordsOffset % alignof(WordEntry)) {
+        setError(error, path + " is truncated or corrupt");
+        return false;
+    }
+
+    const ThemeEntry* themes = reinterpret_cast<const ThemeEntry*>(base + header->themesOffset);
+    for (uint32_t i = 0; i < header->themeCount; ++i) {
+        const ThemeEntry& t = themes[i];
+        if (uint64_t(t.nameOffset) + t.nameLength > header->stringsSize
+            || uint64_t(t.firstWord) + t.wordCount > header->wordCount) {
+            setError(error, path + " has a corrupt theme table");
+            return false;
+        }
+    }
+
+    m_themes = themes;
+    m_words = reinterpret_cast<const WordEntry*>(base + header->wordsOffset);
+    m_strings = base + header->stringsOffset;
+    m_header = header;
+    return true;
+}
+
+std::string_view WordDictionary::string(uint32_t offset, uint32_t length) const {
+    if (uint64_t(offset) + length > m_header->stringsSize) return {};
+    return std::string_view(m_strings + offset, length);
+}
+
+std::string_view WordDictionary::themeName(uint32_t theme) const {
+    if (!m_header || theme >= m_header->themeCount) return {};
+    return string(m_themes[theme].nameOffset, m_themes[theme].nameLength);
+}
+
+WordDictionary::Range WordDictionary::range(std::string_view theme) const {
+    if (!m_header) return {};
+    if (!theme.empty()) {
+        // Theme table is sorted by name
+        uint32_t lo = 0, hi = m_header->themeCount;
+        while (lo < hi) {
+            uint32_t mid = lo + (hi - lo) / 2;
+            std::string_view name = themeName(mid);
+            if (name == theme) return { m_themes[mid].firstWord, m_themes[mid].wordCount };
+            if (name < theme) lo = mid + 1;
+            else hi = mid;
+        }
+    }
+    return { 0, m_header->wordCount };
+}
+
+std::string_view WordDictionary::word(uint32_t index) const {
+    if (!m_header || index >= m_header->wordCount) return {};
+    return string(m_words[index].offset, m_words[index].length);
+}
+
+bool WordDictionary::build(const std::string& sourcePath, const std::string& outPath, std::string* error) {
+    std::ifstream in(sourcePath);
+    if (!in.is_open()) {
+        setError(error, "cannot open " + sourcePath);
+        return false;
+    }
+
+    auto trim = [](std::string_view s) {
+        while (!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))) s.remove_prefix(1);
+        while (!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))) s.remove_suffix(1);
+        return s;
+    };
+
+    // theme -> words, both sorted and de-duplicated
+    std::map<std::string, std::set<std::string>> themes;
+    std::string line;
+    while (std::getline(in, line)) {
+        std::string_view view = trim(line);
+        if (view.empty() || view.front() == '#') continue;
+        size_t tab = view.find('\t');
+        if (tab == std::string_view::npos) continue;
+        std::string_view theme = trim(view.substr(0, tab));
+        std::string_view word = trim(view.substr(tab + 1));
+        if (theme.empty() || word.empty()) continue;
+        themes[std::string(theme)].insert(std::string(word));
+    }
+
+    std::vector<ThemeEntry> themeTable;
+    std::vector<WordEntry> wordTable;
+    std::string strings;
+    for (auto& [name, words] : themes) {
+        ThemeEntry entry{ static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(name.size()),
+            static_cast<uint32_t>(wordTable.size()), static_cast<uint32_t>(words.size()) };
+        strings += name;
+        for (auto& word : words) {
+            wordTable.push_back({ static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(word.size()) });
+            strings += word;
+        }
+        themeTable.push_back(entry);
+    }
+    if (strings.size() > UINT32_MAX) {
+        setError(error, "dictionary strings exceed 4 GiB");
+        return false;
+    }
+
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.themeCount = static_cast<uint32_t>(themeTable.size());
+    header.wordCount = static_cast<uint32_t>(wordTable.size());
+    header.themesOffset = sizeof(Header);
+    header.wordsOffset = header.themesOffset + themeTable.size() * sizeof(ThemeEntry);
+    header.stringsOffset = header.wordsOffset + wordTable.size() * sizeof(WordEntry);
+    header.stringsSize = strings.size();
+
+    std::ofstream out(outPath, std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) {
+        setError(error, "cannot write " + outPath);
+        return false;
+    }
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(themeTable.data()), themeTable.size() * sizeof(ThemeEntry));
+    out.write(reinterpret_cast<const char*>(wordTable.data()), wordTable.size() * sizeof(WordEntry));
+    out.write(strings.data(), strings.size());
+    if (!out) {
+        setError(error, "short write to " + outPath);
+        return false;
+    }
+    return true;
+}
+
+WordSelector::WordSelector() : m_rng(std::random_device{}()) {}
+
+WordSelector::WordSelector(WordDictionary::Range range) : WordSelector() {
+    reset(range);
+}
+
+void WordSelector::reset(WordDictionary::Range range) {
+    m_range = range;
+    reshuffle();
+}
+
+void WordSelector::reshuffle() {
+    m_cursor = 0;
+    uint64_t n = m_range.count;
+    if (n <= 1) {
+        m_a = 1;
+        m_b = 0;
+        return;
+    }
+    // Any a coprime to n gives a permutation; a few tries find one
+    auto draw = [this]() { return (uint64_t(m_rng()) << 31) ^ m_rng(); };
+    do {
+        m_a = 1 + draw() % (n - 1);
+    } while (std::gcd(m_a, n) != 1);
+    m_b = draw() % n;
+}
+
+uint32_t WordSelector::next() {
+    if (m_cursor >= m_range.count) reshuffle();
+    uint64_t k = m_cursor++;
+    return m_range.first + static_cast<uint32_t>((m_a * k + m_b) % m_range.count);
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <string_view>
+
+// Themed word list in a compact read-only file that is memory-mapped as is.
+//
+// Layout, little endian, offsets from the start of the file:
+//   Header
+//   ThemeEntry[themeCount]  sorted by name, each a contiguous run of words
+//   WordEntry[wordCount]
+//   string blob (theme names and words, not terminated)
+//
+// Opening maps the file and checks the header and theme table only, so it
+// costs the same for a hundred words or millions, and every process that
+// maps the same file shares its pages. Build one with build().
+class WordDictionary {
+public:
+    static constexpr char kMagic[8] = { 'G', 'I', 'O', 'W', 'O', 'R', 'D', 'S' };
+    static constexpr uint32_t kVersion = 1;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t themeCount;
+        uint32_t wordCount;
+        uint32_t reserved;
+        uint64_t themesOffset;
+        uint64_t wordsOffset;
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+    };
+
+    struct ThemeEntry {
+        uint32_t nameOffset; // into the string blob
+        uint32_t nameLength;
+        uint32_t firstWord;
+        uint32_t wordCount;
+    };
+
+    struct WordEntry {
+        uint32_t offset; // into the string blob
+        uint32_t length;
+    };
+
+    // A range of word indices; the whole dictionary or one theme
+    struct Range {
+        uint32_t first = 0;
+        uint32_t count = 0;
+    };
+
+    // Maps `path`; returns false (and stays empty) if it is missing or malformed
+    bool open(const std::string& path, std::string* error = nullptr);
+    bool loaded() const { return m_header != nullptr; }
+
+    uint32_t size() const { return m_header ? m_header->wordCount : 0; }
+    uint32_t themeCount() const { return m_header ? m_header->themeCount : 0; }
+    std::string_view themeName(uint32_t theme) const;
+
+    // Words of `theme`, or of every theme if it is empty or unknown
+    Range range(std::string_view theme) const;
+    // Word `index` (0 <= index < size()); empty if the entry is corrupt
+    std::string_view word(uint32_t index) const;
+
+    // Reads "theme<TAB>word" lines (blank lines and '#' comments skipped)
+    // from `sourcePath` and writes a dictionary file to `outPath`.
+    static bool build(const std::string& sourcePath, const std::string& outPath, std::string* error = nullptr);
+
+private:
+    std::string_view string(uint32_t offset, uint32_t length) const;
+
+    boost::interprocess::file_mapping m_file;
+    boost::interprocess::mapped_region m_region;
+    const Header* m_header = nullptr;
+    const ThemeEntry* m_themes = nullptr;
+    const WordEntry* m_words = nullptr;
+    const char* m_strings = nullptr;
+};
+
+// Walks a word range in a random order without repeats: index k of a pass
+// is (a * k + b) mod n with a coprime to n, a permutation of the range that
+// needs no storage. A new pass draws new a and b. Each pick is O(1) and
+// never allocates.
+class WordSelector {
+public:
+    WordSelector();
+    explicit WordSelector(WordDictionary::Range range);
+
+    void reset(WordDictionary::Range range);
+    // Next index into the dictionary; only call when the range isn't empty
+    uint32_t next();
+    bool empty() const { return m_range.count == 0; }
+
+private:
+    void reshuffle();
+
+    WordDictionary::Range m_range;
+    uint64_t m_a = 1;
+    uint64_t m_b = 0;
+    uint32_t m_cursor = 0;
+    std::minstd_rand m_rng;
+};
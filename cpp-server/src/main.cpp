@@ -1,5 +1,11 @@
 ﻿#include "server.h"
 #include "TwitchBotManager.h"
+#include "FakeTwitchServer.h"
+#include "ResultWriter.h"
+#include "EventLog.h"
+#include "Handoff.h"
+#include "RoomArchive.h"
+#include "ClusterNode.h"
 #include <boost/asio.hpp>
 #include <thread>
 #include <vector>
@@ -28,7 +34,28 @@ void handleSignal(int) {
     running = false;
 }
 
-int main() {
+int main(int argc, char* argv[]) {
+    // offline tool: cpp-server --build-words words.tsv words.dict
+    if (argc == 4 && std::string(argv[1]) == "--build-words") {
+        std::string error;
+        if (!WordDictionary::build(argv[2], argv[3], &error)) {
+            std::cerr << "Building word dictionary failed: " << error << "\n";
+            return 1;
+        }
+        std::cout << "Wrote word dictionary " << argv[3] << "\n";
+        return 0;
+    }
+
+    // cpp-server --takeover: replace the running server without dropping its clients
+    // cpp-server --node <id>: run as that node of the CLUSTER in config.json
+    bool takeover = false;
+    std::string nodeId;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--takeover") takeover = true;
+        else if (arg == "--node" && i + 1 < argc) nodeId = argv[++i];
+    }
+
     try {
         std::cout << "Starting server...\n";
         signal(SIGINT, handleSignal);
@@ -37,33 +64,153 @@ int main() {
         std::cout << "Creating io_context...\n";
         boost::asio::io_context io;
 
+        // load secrets and tuning from config.json
+        auto cfg = loadConfig("config.json");
+
+        // sharded deployment: this process owns a slice of the room ids
+        ClusterConfig cluster = ClusterConfig::fromJson(cfg.value("CLUSTER", nlohmann::json::object()));
+        size_t nodeIndex = cluster.indexOf(nodeId);
+        if (cluster.enabled && nodeIndex == cluster.nodes.size()) {
+            std::cerr << "Cluster mode needs --node <id> naming one of CLUSTER.nodes\n";
+            return 1;
+        }
+        int port = cluster.enabled ? cluster.nodes[nodeIndex].wsPort : 9001;
+
         std::cout << "Creating server...\n";
-        Server server(io, 9001);
+        Server server(io, port);
+        server.setLimits(ServerLimits::fromJson(cfg.value("LIMITS", nlohmann::json::object())));
+        server.setRateLimits(RateLimitConfig::fromJson(cfg.value("RATE_LIMITS", nlohmann::json::object())));
+        server.roomManager().setRoundConfig(RoundConfig::fromJson(cfg.value("ROUNDS", nlohmann::json::object())));
+        std::string wordsFile = cfg.value("WORDS_FILE", "");
+        if (!wordsFile.empty()) server.roomManager().loadWords(wordsFile);
+
+        // scores and guess history go to the backend in the background
+        PersistConfig persist = PersistConfig::fromJson(cfg.value("PERSIST", nlohmann::json::object()));
+        std::unique_ptr<ResultWriter> results;
+        if (persist.enabled) {
+            results = std::make_unique<ResultWriter>(persist);
+            results->start();
+            server.roomManager().setResultWriter(results.get());
+        }
+
+        // upgrades: the old process hands over its sockets and rooms (POSIX only)
+        HandoffConfig handoff = HandoffConfig::fromJson(cfg.value("HANDOFF", nlohmann::json::object()));
+        if (cluster.enabled) handoff.path += "." + nodeId;
+#ifndef _WIN32
+        HandoffReceiver receiver;
+        HandoffState handedOver;
+        if (takeover) {
+            std::string error;
+            if (!receiver.receive(handoff.path, handedOver, &error)) {
+                std::cerr << "Takeover failed: " << error << "\n";
+                return 1;
+            }
+            std::cout << "[HANDOFF] Received " << handedOver.clients.size() << " connections\n";
+        }
+#else
+        if (takeover) {
+            std::cerr << "Takeover is not supported on this platform\n";
+            return 1;
+        }
+#endif
+
+        // rooms outlive a crash: rebuild them from their logs, then keep logging
+        EventLogConfig eventLogConfig = EventLogConfig::fromJson(cfg.value("EVENT_LOG", nlohmann::json::object()));
+        if (cluster.enabled) eventLogConfig.dir += "-" + nodeId;
+        std::unique_ptr<EventLog> eventLog;
+        if (eventLogConfig.enabled) {
+            // On a takeover the old process has just checkpointed every room
+            eventLog = std::make_unique<EventLog>(eventLogConfig);
+            server.roomManager().recover(*eventLog);
+            server.roomManager().setEventLog(eventLog.get());
+            eventLog->start();
+        }
+#ifndef _WIN32
+        else if (takeover) {
+            server.roomManager().restore(handedOver.rooms);
+        }
+#endif
+
+        // idle rooms are evicted to disk, compressed, and loaded again on demand
+        HibernateConfig hibernate = HibernateConfig::fromJson(cfg.value("HIBERNATE", nlohmann::json::object()));
+        if (cluster.enabled) hibernate.dir += "-" + nodeId;
+        std::unique_ptr<RoomArchive> archive;
+        if (hibernate.enabled) {
+            archive = std::make_unique<RoomArchive>(hibernate);
+            archive->scan();
+            server.roomManager().setArchive(archive.get());
+        }
 
         std::cout << "Creating TwitchBotManager...\n";
         TwitchBotManager botManager(io, server);
 
         std::cout << "Setting bot manager...\n";
         server.setBotManager(&botManager);
+        botManager.setChannelsPerConnection(cfg.value("TWITCH_CHANNELS_PER_CONNECTION", 50));
+        IrcSendLimits sendLimits;
+        sendLimits.messagesPer30s = cfg.value("TWITCH_MESSAGES_PER_30S", sendLimits.messagesPer30s);
+        sendLimits.joinsPer10s = cfg.value("TWITCH_JOINS_PER_10S", sendLimits.joinsPer10s);
+        botManager.setSendLimits(sendLimits);
+        IrcServerConfig ircServer;
+        ircServer.host = cfg.value("TWITCH_IRC_HOST", ircServer.host);
+        ircServer.port = cfg.value("TWITCH_IRC_PORT", ircServer.port);
 
+        // offline benchmark: bots talk to a local IRC stand-in instead of Twitch
+        FakeIrcConfig fakeIrc = FakeIrcConfig::fromJson(cfg.value("FAKE_IRC", nlohmann::json::object()));
+        std::unique_ptr<FakeTwitchServer> fakeServer;
+        if (fakeIrc.enabled) {
+            // one stand-in serves every node of a cluster
+            if (!cluster.enabled || nodeIndex == 0) {
+                fakeServer = std::make_unique<FakeTwitchServer>(fakeIrc);
+                fakeServer->start();
+            }
+            ircServer.host = "127.0.0.1";
+            ircServer.port = std::to_string(fakeIrc.port);
+        }
+        botManager.setServerConfig(ircServer);
+
+        std::unique_ptr<ClusterNode> clusterNode;
+        if (cluster.enabled) {
+            clusterNode = std::make_unique<ClusterNode>(io, server, cluster, nodeIndex);
+            server.setCluster(clusterNode.get());
+        }
+
+#ifndef _WIN32
+        if (takeover) server.importHandoff(handedOver);
+#endif
         std::cout << "Starting server...\n";
         server.start();
-        std::cout << "Server started successfully on port 9001\n";
+        if (clusterNode) clusterNode->start();
+        std::cout << "Server started successfully on port " << port << "\n";
 
-        // load secrets from config.json
-        auto cfg = loadConfig("config.json");
         std::string oauth = cfg.value("TWITCH_OAUTH", "");
         std::string nick = cfg.value("TWITCH_NICK", "");
         std::string channel = cfg.value("TWITCH_CHANNEL", "");
 
-        // spawn bot
-        std::cout << "Spawning Twitch bot for channel " << channel << "...\n";
-        bool botSpawned = server.spawnBot(oauth, nick, channel);
+        // spawn bot; in a cluster the first node spawns them all and each
+        // goes to the node owning its room
+        bool botSpawned = false;
+        if (cluster.enabled && nodeIndex != 0) {
+            std::cout << "Bots are spawned by node " << cluster.nodes[0].id << "\n";
+        }
+        else if (fakeIrc.enabled) {
+            // one bot per fake channel, packed onto connections by the manager
+            std::cout << "Spawning Twitch bots for " << fakeIrc.channels << " fake channels...\n";
+            botSpawned = true;
+            for (size_t i = 0; i < fakeIrc.channels; ++i) {
+                botSpawned &= server.spawnBot(oauth.empty() ? "oauth:fake" : oauth,
+                    nick.empty() ? "guessio_bench" : nick, fakeIrc.channelName(i));
+            }
+        }
+        else {
+            std::cout << "Spawning Twitch bot for channel " << channel << "...\n";
+            botSpawned = server.spawnBot(oauth, nick, channel);
+        }
 
         if (botSpawned) {
             std::cout << "Twitch bot spawned successfully!\n";
         }
-        else {
+        else if (!cluster.enabled || nodeIndex == 0) {
             std::cout << "Failed to spawn Twitch bot!\n";
         }
 
@@ -75,15 +222,67 @@ int main() {
         for (unsigned int i = 0; i < numThreads; ++i)
             pool.emplace_back([&io]() { io.run(); });
 
+#ifndef _WIN32
+        // The old process exits once we serve its clients; the path is ours after that
+        if (takeover) receiver.acknowledge();
+        std::unique_ptr<HandoffListener> handoffListener;
+        if (handoff.enabled) handoffListener = std::make_unique<HandoffListener>(io, handoff.path);
+#endif
+
         // main loop
-        while (running) {
+        auto handoffRequested = [&]() {
+#ifndef _WIN32
+            return handoffListener && handoffListener->requested();
+#else
+            return false;
+#endif
+        };
+        while (running && !handoffRequested()) {
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
         }
 
-        server.broadcast(R"({"type":"system","payload":"server shutting down"})");
+        bool handedOff = false;
+#ifndef _WIN32
+        if (handoffRequested()) {
+            // Let writes reach a message boundary, then freeze everything
+            server.beginHandoff();
+            auto deadline = std::chrono::steady_clock::now() + handoff.drainTimeout;
+            while (!server.handoffDrained() && std::chrono::steady_clock::now() < deadline)
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+            io.stop();
+            for (auto& t : pool) t.join();
+            pool.clear();
+
+            HandoffState state;
+            server.exportHandoff(state);
+            if (eventLog) {
+                // The new process recovers rooms from disk
+                server.roomManager().checkpoint();
+                eventLog->stop();
+            }
+            else {
+                state.rooms = server.roomManager().snapshots();
+            }
+            // The new process binds the bus port as soon as it has the state
+            if (clusterNode) clusterNode->stop();
+            std::string error;
+            handedOff = handoffListener->send(state, &error);
+            if (!handedOff) std::cerr << "[HANDOFF] Failed, shutting down instead: " << error << "\n";
+        }
+#endif
+
+        if (!handedOff) server.broadcast(R"({"type":"system","payload":"server shutting down"})");
+        if (clusterNode) clusterNode->stop();
 
         io.stop();
         for (auto& t : pool) t.join();
+        if (fakeServer) fakeServer->stop();
+        if (results) results->stop();
+        if (eventLog && !handoffRequested()) {
+            // A restart then maps one snapshot per room instead of replaying logs
+            server.roomManager().checkpoint();
+            eventLog->stop();
+        }
     }
     catch (const std::exception& e) {
         std::cerr << "Fatal error: " << e.what() << "\n";
@@ -1,11 +1,37 @@
 ﻿#include "room.h"
 #include "session.h"   // full definition of Session
+#include "MessageFormat.h"
 #include <iostream>
 #include <unordered_map>
 #include <chrono>
+#include <algorithm>
 using json = nlohmann::json;
 
-Room::Room() : nextPlayerId(1), m_lastActivity(std::chrono::steady_clock::now()) {}
+namespace {
+constexpr MessageTemplate<3> kPlayersJoinedMsg{ R"({"type":"players_joined","payload":{"count":$,"first":$,"total":$,"players":[)" };
+constexpr MessageTemplate<2> kJoinedPlayer{ R"({"id":$,"username":$})" };
+constexpr MessageTemplate<6> kRankChangeMsg{
+    R"({"type":"rank_change","payload":{"scope":$,"username":$,"score":$,"rank":$,"previous":$,"players":$}})" };
+}
+
+Room::Room(boost::asio::io_context& io, const std::string& name, RoundScheduler& scheduler, const RoundConfig& rounds,
+    std::function<void()> onRoundTimer, std::function<void()> onJoinTick)
+    : m_scheduler(scheduler),
+    m_strand(boost::asio::make_strand(io)),
+    m_roomName(name),
+    m_drawPrefix(R"({"type":"draw","room":)" + json(name).dump() + R"(,"payload":)"),
+    m_joinTimer([ex = m_strand, onJoinTick = std::move(onJoinTick)]() {
+        boost::asio::post(ex, onJoinTick);
+    }),
+    // The wheel only posts; the round itself advances on this room's executor
+    m_game(scheduler, rounds, [ex = m_strand, onRoundTimer = std::move(onRoundTimer)]() {
+        boost::asio::post(ex, onRoundTimer);
+    }),
+    m_lastActivity(std::chrono::steady_clock::now()) {}
+
+Room::~Room() {
+    m_scheduler.cancel(m_joinTimer);
+}
 
 void Room::updateActivity() {
     m_lastActivity = std::chrono::steady_clock::now();
@@ -15,143 +41,427 @@ std::chrono::steady_clock::time_point Room::getLastActivity() const {
     return m_lastActivity;
 }
 
-// Default constructor is now defined in header
+void Room::setEventLog(EventLog* log) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_log = log;
+    m_loggedRound = m_game.round();
+}
+
+void Room::replay(const EventLog::Entry& entry) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    switch (entry.type) {
+    case EventLog::Event::Join:
+        if (!m_players.contains(entry.text)) {
+            m_players.add(entry.text);
+            m_leaderboard.set(entry.text, 0);
+        }
+        break;
+    case EventLog::Event::Draw:
+        m_history->append(drawMessage(entry.text));
+        break;
+    case EventLog::Event::Score: {
+        PlayerTable::Id id = m_players.add(entry.text);
+        int total = static_cast<int>(entry.number);
+        m_players.addScore(id, total - m_players.score(id));
+        m_leaderboard.set(entry.text, total);
+        break;
+    }
+    case EventLog::Event::Reset:
+        m_players.clear();
+        m_leaderboard.clear();
+        break;
+    case EventLog::Event::Round:
+        m_game.resumeRounds(static_cast<uint32_t>(entry.number));
+        break;
+    }
+    m_restored = true;
+    updateActivity();
+}
+
+void Room::restore(const RoomSnapshot& snapshot) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (uint32_t i = 0; i < snapshot.playerCount(); ++i) {
+        std::string_view name = snapshot.playerName(i);
+        if (name.empty()) continue;
+        PlayerTable::Id id = m_players.add(name);
+        int score = static_cast<int>(snapshot.playerScore(i));
+        m_players.addScore(id, score - m_players.score(id));
+        m_leaderboard.set(name, score);
+    }
+    for (uint32_t i = 0; i < snapshot.strokeCount(); ++i) {
+        std::string_view payload = snapshot.stroke(i);
+        if (!payload.empty()) m_history->append(drawMessage(payload));
+    }
+    m_game.resumeRounds(snapshot.round());
+    m_restored = true;
+    updateActivity();
+}
+
+void Room::checkpoint() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_log) m_log->checkpoint(m_roomName, buildSnapshot());
+}
+
+std::string Room::snapshot() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return buildSnapshot();
+}
+
+std::string Room::buildSnapshot() const {
+    RoomSnapshot::Builder snapshot;
+    m_players.page(1, m_players.size(), [&](PlayerTable::Id, std::string_view name, int score) {
+        snapshot.player(name, score);
+    });
+    // History entries are whole draw messages; only the payload is kept
+    m_history->forEach([&](const std::string& msg) {
+        snapshot.stroke(std::string_view(msg).substr(m_drawPrefix.size(), msg.size() - m_drawPrefix.size() - 1));
+    });
+    snapshot.round(m_game.round());
+    return snapshot.finish();
+}
+
+void Room::logRound() {
+    if (!m_log || m_game.round() == m_loggedRound) return;
+    m_loggedRound = m_game.round();
+    m_log->round(m_roomName, m_loggedRound);
+}
 
-void Room::join(std::shared_ptr<Session> s, const std::string& username) {
-    nlohmann::json joinMsg;
-    bool isNewPlayer = false;
+// Default constructor is now defined in header
 
+void Room::join(std::shared_ptr<Session> s, const std::string& username, bool withState) {
+    bool attached = false;
+    StrokeHistory::Mark mark;
     {
         std::lock_guard<std::mutex> lock(m_mutex);
 
-        if (players.find(username) == players.end()) {
-            Player p{ nextPlayerId++, username, 0 };
-            players[username] = p;
-            isNewPlayer = true;
-
-            joinMsg = {
-                {"type", "join"},
-                {"payload", {
-                    {"id", p.id},
-                    {"username", p.username}
-                }}
-            };
+        bool isNewPlayer = false;
+        PlayerTable::Id id = m_players.add(username, &isNewPlayer);
+        if (isNewPlayer) {
+            m_leaderboard.set(username, 0);
+            if (m_log) m_log->join(m_roomName, username);
+            // Announced with everyone else who joins this tick
+            m_pendingJoins.push_back(id);
+            if (!m_joinTickArmed) {
+                m_joinTickArmed = true;
+                m_scheduler.schedule(m_joinTimer, kJoinTick);
+            }
         }
 
         if (s) {
             m_sessions.insert(s);
+            m_restored = false;
+            auto [user, inserted] = m_sessionUsers.try_emplace(s, username);
+            // A repeated join from the same session already has the state
+            attached = inserted || user->second != username;
+            user->second = username;
+            // Taken with the session attached, so no draw is sent twice or missed
+            mark = m_history->mark();
         }
         
         // Update activity timestamp
         updateActivity();
     }
 
-    // Broadcast outside of mutex lock to avoid deadlock
-    if (isNewPlayer) {
-        broadcast(joinMsg.dump());
-    }
+    if (attached && withState) sendState(s, mark);
+}
+
+void Room::flushJoins() {
+    MessageBuffer buf;
+    std::string& msg = buf.str();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_joinTickArmed = false;
+        if (m_pendingJoins.empty()) return;
 
-    if (s) {
-        replayPlayers(s);
-        replayHistory(s);
+        kPlayersJoinedMsg.write(msg, m_pendingJoins.size(), m_pendingJoins.front(), m_players.size());
+        // A sample of names; clients page the rest from `first` if they care
+        size_t shown = std::min(m_pendingJoins.size(), kJoinSample);
+        for (size_t i = 0; i < shown; ++i) {
+            PlayerTable::Id id = m_pendingJoins[i];
+            if (i > 0) msg += ',';
+            kJoinedPlayer.write(msg, id, m_players.name(id));
+        }
+        msg += "]}}";
+        m_pendingJoins.clear();
     }
+    broadcast(msg);
+}
+
+json Room::rosterPage(PlayerTable::Id cursor, size_t limit) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    json players = json::array();
+    PlayerTable::Id next = m_players.page(cursor, std::min(limit, kRosterPage),
+        [&](PlayerTable::Id id, std::string_view name, int score) {
+            players.push_back({ {"id", id}, {"username", name}, {"score", score} });
+        });
+    return {
+        {"total", m_players.size()},
+        {"cursor", cursor},
+        {"next", next},
+        {"players", std::move(players)}
+    };
+}
+
+void Room::sendState(const std::shared_ptr<Session>& s) {
+    sendState(s, m_history->mark());
+}
+
+void Room::sendState(const std::shared_ptr<Session>& s, const StrokeHistory::Mark& mark) {
+    if (!s) return;
+
+    // The roster page is small; the strokes are what can run to megabytes
+    std::string head = R"({"type":"current_state","payload":{"roster":)";
+    head += rosterPage(1, kRosterPage).dump();
+    head += R"(,"strokes":[)";
+
+    std::shared_ptr<StrokeHistory> history = m_history;
+    size_t next = 0;
+    s->sendStream([history, mark, next, head = std::move(head)](std::string& chunk) mutable {
+        if (!head.empty()) {
+            chunk += head;
+            std::string().swap(head);
+        }
+        next = history->write(chunk, next, mark, Session::kStreamChunk);
+        if (next < mark.end) return true;
+        chunk += "]}}";
+        return false;
+    });
 }
 
 
 bool Room::leave(std::shared_ptr<Session> s) {
-    std::lock_guard<std::mutex> lock(m_mutex);
+    GameProtocol::Outbox out;
+    bool empty;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
 
-    // just remove the session
-    auto it = m_sessions.find(s);
-    if (it != m_sessions.end()) {
-        m_sessions.erase(it);
-    }
+        // just remove the session
+        auto it = m_sessions.find(s);
+        if (it != m_sessions.end()) {
+            m_sessions.erase(it);
+        }
+
+        auto user = m_sessionUsers.find(s);
+        if (user != m_sessionUsers.end()) {
+            std::string username = std::move(user->second);
+            m_sessionUsers.erase(user);
+            // A drawer with another tab still open keeps drawing
+            bool stillHere = false;
+            for (auto& [session, name] : m_sessionUsers) stillHere |= name == username;
+            if (!stillHere) m_game.drawerLeft(username, out);
+            logRound();
+        }
 
-    return m_sessions.empty();
+        empty = m_sessions.empty();
+        if (empty) m_game.stop(out);
+    }
+    deliver(out);
+    return empty;
 }
 
 void Room::resetLobby() {
     std::lock_guard<std::mutex> lock(m_mutex);
-    players.clear();
-    nextPlayerId = 1;
+    m_players.clear();
+    m_leaderboard.clear();
+    m_pendingJoins.clear();
+    if (m_log) m_log->reset(m_roomName);
 }
 
-void Room::broadcast(const std::string& msg) {
+void Room::broadcast(const std::string& msg, SendPriority priority) {
     for (auto& s : m_sessions) {
-        if (s) s->send(msg);
+        if (s) s->send(msg, priority);
     }
 }
 
 bool Room::empty() {
     std::lock_guard<std::mutex> lock(m_mutex);
-    return m_sessions.empty();
+    return m_sessions.empty() && !m_restored;
 }
 
-void Room::endRound() {
-    json msg = { {"type","round_end"}, {"payload","Round finished!"} };
-    broadcast(msg.dump());
+size_t Room::sessionCount() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_sessions.size();
 }
 
-bool Room::hasPlayer(const std::string& username) {
+size_t Room::connectedCount() const {
     std::lock_guard<std::mutex> lock(m_mutex);
-    return players.find(username) != players.end();
+    return std::count_if(m_sessions.begin(), m_sessions.end(),
+        [](const std::shared_ptr<Session>& s) { return s && s->connected(); });
 }
 
-// room.cpp
-void Room::addStroke(const json& stroke) {
+bool Room::hasSession(const std::shared_ptr<Session>& s) const {
     std::lock_guard<std::mutex> lock(m_mutex);
-    strokeHistory.push_back(stroke);
-    updateActivity();
+    return m_sessions.count(s) > 0;
 }
 
-void Room::clearHistory() {
-    std::lock_guard<std::mutex> lock(m_mutex);
-    strokeHistory.clear();
+void Room::endRound() {
+    GameProtocol::Outbox out;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_game.endRound(out);
+    }
+    deliver(out);
 }
 
-void Room::replayHistory(std::shared_ptr<Session> s) {
-    std::vector<json> strokesCopy;
+void Room::startGame() {
+    GameProtocol::Outbox out;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_game.start(drawers(), out);
+        logRound();
+        updateActivity();
+    }
+    deliver(out);
+}
 
+void Room::stopGame() {
+    GameProtocol::Outbox out;
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        strokesCopy = strokeHistory; // Copy the strokes
+        m_game.stop(out);
     }
+    deliver(out);
+}
+
+void Room::onRoundTimer() {
+    GameProtocol::Outbox out;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_game.onTimer(drawers(), out);
+        logRound();
+    }
+    deliver(out);
+}
+
+void Room::setWordSource(const WordDictionary& words, std::string_view theme) {
+    WordSelector selector(words.range(theme));
+    if (selector.empty()) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_game.setWordPicker([&words, selector]() mutable { return words.word(selector.next()); });
+}
+
+std::vector<std::string> Room::drawers() const {
+    std::vector<std::string> names;
+    names.reserve(m_sessionUsers.size());
+    for (auto& [session, username] : m_sessionUsers) names.push_back(username);
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    return names;
+}
 
-    // Send strokes outside of mutex lock
-    for (auto& stroke : strokesCopy) {
-        std::cout << "[DEBUG] Replaying stroke to " << (s ? "session" : "null") << "\n";
-        if (s) s->send(stroke.dump());
+void Room::deliver(GameProtocol::Outbox& out) {
+    for (auto& msg : out) {
+        if (msg.onlyTo.empty()) {
+            broadcast(msg.text);
+            continue;
+        }
+        // e.g. the word, which only the drawer may see
+        std::vector<std::shared_ptr<Session>> targets;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto& [session, username] : m_sessionUsers) {
+                if (username == msg.onlyTo) targets.push_back(session);
+            }
+        }
+        for (auto& s : targets) s->send(msg.text);
     }
 }
 
-void Room::replayPlayers(std::shared_ptr<Session> s) {
-    std::vector<std::pair<int, std::string>> playerData;
+bool Room::hasPlayer(const std::string& username) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_players.contains(username);
+}
+
+// room.cpp
+std::string Room::drawMessage(std::string_view payload) const {
+    // Envelope and payload spliced, never parsed or re-serialised
+    std::string msg;
+    msg.reserve(m_drawPrefix.size() + payload.size() + 1);
+    msg += m_drawPrefix;
+    msg += payload;
+    msg += '}';
+    return msg;
+}
+
+void Room::addDraw(std::string_view payload) {
+    std::string msg = drawMessage(payload);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_history->append(msg);
+    if (m_log) m_log->draw(m_roomName, payload);
+    updateActivity();
+    broadcast(msg, SendPriority::Draw);
+}
 
+void Room::clearHistory() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_history->clear();
+    if (!m_log) return;
+    // Only the lobby is left worth keeping; start the log over from it
+    EventLog::Records snapshot;
+    m_players.page(1, m_players.size(), [&](PlayerTable::Id, std::string_view name, int score) {
+        snapshot.join(name);
+        if (score != 0) snapshot.score(name, score);
+    });
+    if (m_game.round() != 0) snapshot.round(m_game.round());
+    m_log->rewrite(m_roomName, snapshot);
+}
+
+bool Room::setWord(const std::shared_ptr<Session>& s, const std::string& word) {
+    GameProtocol::Outbox out;
+    bool accepted;
     {
         std::lock_guard<std::mutex> lock(m_mutex);
-        for (auto& [username, p] : players) {
-            playerData.push_back({ p.id, p.username });
-        }
+        auto it = m_sessionUsers.find(s);
+        if (it == m_sessionUsers.end()) return false;
+        accepted = m_game.setWord(it->second, word, out);
     }
+    deliver(out);
+    return accepted;
+}
 
-    // Send player data outside of mutex lock
-    for (auto& [id, username] : playerData) {
-        nlohmann::json joinMsg = {
-            {"type", "join"},
-            {"payload", {
-                {"id", id},
-                {"username", username}
-            }}
-        };
-        if (s) s->send(joinMsg.dump());
+GuessResult Room::checkGuess(const std::string& username, std::string_view normalizedGuess,
+    std::string* word, GameProtocol::Outbox& out, std::vector<GameProtocol::ScoreChange>* scored) {
+    thread_local std::vector<GameProtocol::ScoreChange> changes;
+    changes.clear();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    GuessResult result = m_game.guess(username, normalizedGuess, m_players, out, word, &changes);
+    // Only the movers are announced; everyone between their old and new
+    // place slid down one, which clients work out for themselves
+    for (auto& change : changes) {
+        Leaderboard::Move move = m_leaderboard.set(change.username, change.total);
+        if (m_log) m_log->score(m_roomName, change.username, change.total);
+        if (move.changed()) {
+            out.push_back({ rankChangeMessage("room", change.username, change.total, move, m_leaderboard.size()), {} });
+        }
     }
+    if (scored) scored->insert(scored->end(), changes.begin(), changes.end());
+    return result;
 }
 
-std::unordered_set<std::string> Room::getPlayerUsernames() const {
+json Room::leaderboard(size_t limit, const std::string& username) const {
     std::lock_guard<std::mutex> lock(m_mutex);
-    std::unordered_set<std::string> usernames;
-    for (const auto& [username, p] : players) {
-        usernames.insert(username);
+    return leaderboardJson("room", m_leaderboard, limit, username);
+}
+
+std::string Room::rankChangeMessage(const char* scope, const std::string& username, int64_t score,
+    Leaderboard::Move move, size_t players) {
+    return kRankChangeMsg.str(scope, username, score, move.rank, move.previous, players);
+}
+
+json Room::leaderboardJson(const char* scope, const Leaderboard& board, size_t limit,
+    const std::string& username) {
+    json entries = json::array();
+    board.top(limit, [&](uint32_t rank, std::string_view name, int64_t score) {
+        entries.push_back({ {"rank", rank}, {"username", name}, {"score", score} });
+    });
+    json payload = {
+        {"scope", scope},
+        {"entries", std::move(entries)},
+        {"players", board.size()}
+    };
+    if (!username.empty()) {
+        payload["you"] = { {"rank", board.rank(username)}, {"score", board.score(username)} };
     }
-    return usernames;
-}
\ No newline at end of file
+    return { {"type", "leaderboard"}, {"payload", std::move(payload)} };
+}
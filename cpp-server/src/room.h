@@ -1,52 +1,157 @@
 #pragma once
+#include <boost/asio.hpp>
 #include <unordered_map>
 #include <unordered_set>
 #include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <chrono>
 #include <nlohmann/json.hpp>
+#include "Overload.h"
+#include "GuessEngine.h"
+#include "GameProtocol.h"
+#include "WordDictionary.h"
+#include "Leaderboard.h"
+#include "StrokeHistory.h"
+#include "EventLog.h"
 
 // forward declare only
 class Session;
-struct Player {
-    int id;
-    std::string username;
-    int score;
-};
 
 class Room {
 public:
-    Room(); // Constructor declaration only
-    void join(std::shared_ptr<Session> s, const std::string& username);  // match .cpp
+    // Roster pages and join announcements are capped at these
+    static constexpr size_t kRosterPage = 200;
+    static constexpr size_t kJoinSample = 50;
+    static constexpr std::chrono::milliseconds kJoinTick{ 250 };
+
+    // `onRoundTimer` runs on this room's executor when a round deadline
+    // passes, `onJoinTick` when queued join announcements are due
+    Room(boost::asio::io_context& io, const std::string& name, RoundScheduler& scheduler, const RoundConfig& rounds,
+        std::function<void()> onRoundTimer, std::function<void()> onJoinTick);
+    ~Room();
+
+    // Serialises work posted for this room (bot events)
+    using Executor = boost::asio::strand<boost::asio::io_context::executor_type>;
+    const Executor& executor() const { return m_strand; }
+    // Adds the player and attaches the session. A session that is new here
+    // (or rejoins as someone else) gets one current_state; repeats get nothing.
+    // A session handed over from another process already has it: `withState` false.
+    void join(std::shared_ptr<Session> s, const std::string& username, bool withState = true);
     bool leave(std::shared_ptr<Session> s);
-    void broadcast(const std::string& msg);
+    void broadcast(const std::string& msg, SendPriority priority = SendPriority::Critical);
+    // No sessions, and not waiting for its players to come back after a restart
     bool empty();
+    size_t sessionCount() const;
+    // Sessions whose connection is still open
+    size_t connectedCount() const;
+    bool hasSession(const std::shared_ptr<Session>& s) const;
     void endRound();
+    // Round engine (see GameProtocol); messages are sent before returning
+    void startGame();
+    void stopGame();
+    void onRoundTimer();
+    // Words the server picks when the drawer doesn't, without repeats
+    void setWordSource(const WordDictionary& words, std::string_view theme);
     void resetLobby();
     bool hasPlayer(const std::string& username);
-    const std::unordered_map<std::string, Player>& getPlayers() const { return players; }
-    std::unordered_set<std::string> getPlayerUsernames() const;
-    void addStroke(const nlohmann::json& stroke);
+    // `payload` must have passed validDrawPayload(); its bytes are stored
+    // and broadcast as they are, inside this room's draw envelope
+    void addDraw(std::string_view payload);
     void clearHistory();
-    void replayHistory(std::shared_ptr<Session> s);
-    void replayPlayers(std::shared_ptr<Session> s); // NEW
-    
-    // NEW: Simple getters for persistence
-    const std::vector<nlohmann::json>& getStrokeHistory() const { return strokeHistory; }
+
+    // Roster payload {total, cursor, next, players}; `next` is 0 at the end
+    nlohmann::json rosterPage(PlayerTable::Id cursor, size_t limit) const;
+    // current_state: first roster page and the whole canvas as one message,
+    // streamed in chunks straight from the history (see Session::sendStream)
+    void sendState(const std::shared_ptr<Session>& s);
+    // Broadcasts the joins queued since the last tick as one players_joined
+    void flushJoins();
+
+    // Word the chat is guessing. During a game only the drawer may set it,
+    // while they are choosing; returns false if `s` may not.
+    bool setWord(const std::shared_ptr<Session>& s, const std::string& word);
+    // `normalizedGuess` must come from normalizeGuess(); `word` is filled on an
+    // exact hit. Round messages it causes land in `out`, for deliver(), along
+    // with a rank_change for each scorer who moved; `scored` gets the points.
+    GuessResult checkGuess(const std::string& username, std::string_view normalizedGuess,
+        std::string* word, GameProtocol::Outbox& out, std::vector<GameProtocol::ScoreChange>* scored = nullptr);
+    // Top `limit` of the room plus `username`'s own place
+    nlohmann::json leaderboard(size_t limit, const std::string& username) const;
+    // Shared by the room and global boards
+    static std::string rankChangeMessage(const char* scope, const std::string& username, int64_t score,
+        Leaderboard::Move move, size_t players);
+    static nlohmann::json leaderboardJson(const char* scope, const Leaderboard& board, size_t limit,
+        const std::string& username);
+    // Sends engine messages; call without holding the room lock
+    void deliver(GameProtocol::Outbox& out);
+
+    // Changes from here on are recorded in `log`
+    void setEventLog(EventLog* log);
+    // Applies one recovered event; nothing is sent or logged
+    void replay(const EventLog::Entry& entry);
+    // Loads a saved snapshot into this (new) room; nothing is sent or logged
+    void restore(const RoomSnapshot& snapshot);
+    // Hands the log a snapshot of the room as it is now
+    void checkpoint();
+    // The room as it is now, as a RoomSnapshot image
+    std::string snapshot() const;
+    // f(session, username) for every attached session
+    template <class F>
+    void forEachSession(F&& f) const;
+    // f(name, score) for every player; used to rebuild the global board
+    template <class F>
+    void forEachPlayer(F&& f) const;
 
     // Activity tracking
     void updateActivity();
     std::chrono::steady_clock::time_point getLastActivity() const;
 
 private:
+    // Usernames with a session here, sorted; caller holds m_mutex
+    std::vector<std::string> drawers() const;
+    // Strokes before `mark` go in the state, later ones arrive as live draws
+    void sendState(const std::shared_ptr<Session>& s, const StrokeHistory::Mark& mark);
+    std::string drawMessage(std::string_view payload) const;
+    // Log the round counter if the engine moved it; caller holds m_mutex
+    void logRound();
+    // Caller holds m_mutex
+    std::string buildSnapshot() const;
+
+    RoundScheduler& m_scheduler;
+    Executor m_strand;
     std::string m_roomName;
+    std::string m_drawPrefix; // {"type":"draw","room":"<name>","payload":
     std::unordered_set<std::shared_ptr<Session>> m_sessions;
+    std::unordered_map<std::shared_ptr<Session>, std::string> m_sessionUsers; // who joined on each session
     mutable std::mutex m_mutex;
-    std::unordered_map<std::string, Player> players;
-    int nextPlayerId = 1;
+    PlayerTable m_players;
+    Leaderboard m_leaderboard; // players by score, kept in step with m_players
+    std::vector<PlayerTable::Id> m_pendingJoins; // not announced yet
+    RoundScheduler::Timer m_joinTimer;
+    bool m_joinTickArmed = false;
 
     // NEW: store all strokes for this room
-    std::vector<nlohmann::json> strokeHistory;
+    std::shared_ptr<StrokeHistory> m_history = std::make_shared<StrokeHistory>();
+    GameProtocol m_game;
     std::chrono::steady_clock::time_point m_lastActivity; // Track last activity
+
+    EventLog* m_log = nullptr;
+    uint32_t m_loggedRound = 0;
+    bool m_restored = false; // rebuilt from the log, nobody has rejoined yet
 };
+
+template <class F>
+void Room::forEachPlayer(F&& f) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_players.page(1, m_players.size(), [&](PlayerTable::Id, std::string_view name, int score) {
+        f(name, score);
+    });
+}
+
+template <class F>
+void Room::forEachSession(F&& f) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& [session, username] : m_sessionUsers) f(session, username);
+}
@@ -2,13 +2,338 @@
 #include "session.h"
 #include "server.h"
 #include "TwitchClient.h"      // fixes TwitchClient errors
+#include "ResultWriter.h"
+#include "DrawMessage.h"
+#include "RateLimiter.h"
+#include "MessageFormat.h"
+#include "ClusterNode.h"
+#include <algorithm>
 #include <iostream>
 
 using json = nlohmann::json;
 
+namespace {
+constexpr MessageTemplate<2> kChatMsg{ R"({"type":"chat","room":$,"payload":$})" };
+constexpr MessageTemplate<2> kSystemMsg{ R"({"type":"system","room":$,"payload":$})" };
+constexpr MessageTemplate<1> kClearMsg{ R"({"type":"clear","room":$})" };
+constexpr MessageTemplate<3> kCorrectGuessMsg{ R"({"type":"correct_guess","room":$,"payload":{"username":$,"word":$}})" };
+constexpr MessageTemplate<3> kCloseGuessMsg{ R"({"type":"close_guess","room":$,"payload":{"username":$,"guess":$}})" };
+}
+
+Room& RoomManager::roomFor(const std::string& roomId) {
+    auto it = m_rooms.find(roomId);
+    if (it != m_rooms.end()) return it->second;
+    Room& room = m_rooms.try_emplace(roomId, m_io, roomId, m_scheduler, m_roundConfig,
+        [this, roomId]() { onRoundTimer(roomId); },
+        [this, roomId]() { onJoinTick(roomId); }).first->second;
+    room.setEventLog(m_log);
+    // An evicted room comes back as it was
+    if (m_archive && m_archive->contains(roomId)) rehydrate(roomId, room);
+    return room;
+}
+
+void RoomManager::rehydrate(const std::string& roomId, Room& room) {
+    auto started = std::chrono::steady_clock::now();
+    std::string image;
+    std::string error;
+    RoomSnapshot snapshot;
+    if (!m_archive->take(roomId, image, &error) || !snapshot.load(std::move(image), &error)) {
+        std::cerr << "[HIBERNATE] Room " << roomId << " could not be restored: " << error << "\n";
+        return;
+    }
+    room.restore(snapshot);
+    auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - started);
+    std::cout << "[HIBERNATE] Room " << roomId << " restored (" << snapshot.playerCount() << " players, "
+        << snapshot.strokeCount() << " strokes) in " << elapsed.count() / 1000.0 << "ms\n";
+}
+
+std::unordered_map<std::string, Room>::iterator RoomManager::hibernate(std::unordered_map<std::string, Room>::iterator it) {
+    if (!m_archive->save(it->first, it->second.snapshot())) return ++it;
+    // The event log stays: the room still exists, it is just not in memory
+    return m_rooms.erase(it);
+}
+
+void RoomManager::setArchive(RoomArchive* archive) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_archive = archive;
+    if (!archive) return;
+    // Rooms recovered from their logs that were hibernated go back to sleep
+    for (auto it = m_rooms.begin(); it != m_rooms.end();) {
+        if (archive->contains(it->first)) it = m_rooms.erase(it);
+        else ++it;
+    }
+}
+
+void RoomManager::start() {
+    m_scheduler.start();
+    if (m_archive) scheduleSweep();
+}
+
+void RoomManager::scheduleSweep() {
+    auto interval = std::clamp<std::chrono::seconds>(m_archive->config().idleAfter / 4, std::chrono::seconds(1), std::chrono::seconds(60));
+    m_sweepTimer.expires_after(interval);
+    m_sweepTimer.async_wait([this](boost::system::error_code ec) {
+        if (ec) return;
+        cleanupAbandonedRooms();
+        cleanupExpiredRooms();
+        scheduleSweep();
+    });
+}
+
+std::unordered_map<std::string, Room>::iterator RoomManager::dropRoom(std::unordered_map<std::string, Room>::iterator it) {
+    if (m_log) m_log->remove(it->first);
+    return m_rooms.erase(it);
+}
+
+size_t RoomManager::recover(EventLog& log) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t rooms = log.replay(
+        [this](const std::string& roomId, const RoomSnapshot& snapshot) { roomFor(roomId).restore(snapshot); },
+        [this](const std::string& roomId, const EventLog::Entry& entry) { roomFor(roomId).replay(entry); });
+    rebuildGlobalBoard();
+    return rooms;
+}
+
+void RoomManager::rebuildGlobalBoard() {
+    // The global board is the sum of every room's scores
+    std::lock_guard<std::mutex> globalLock(m_globalMutex);
+    for (auto& [id, room] : m_rooms) {
+        room.forEachPlayer([this](std::string_view name, int score) {
+            if (score != 0) m_globalBoard.add(name, score);
+        });
+    }
+}
+
+std::vector<std::pair<std::string, std::string>> RoomManager::snapshots() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::pair<std::string, std::string>> images;
+    images.reserve(m_rooms.size());
+    for (auto& [id, room] : m_rooms) images.emplace_back(id, room.snapshot());
+    return images;
+}
+
+std::unordered_map<std::shared_ptr<Session>, RoomManager::Memberships> RoomManager::memberships() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::unordered_map<std::shared_ptr<Session>, Memberships> joined;
+    for (auto& [id, room] : m_rooms) {
+        room.forEachSession([&](const std::shared_ptr<Session>& s, const std::string& username) {
+            joined[s].emplace_back(id, username);
+        });
+    }
+    return joined;
+}
+
+size_t RoomManager::restore(const std::vector<std::pair<std::string, std::string>>& snapshots) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    size_t rooms = 0;
+    for (auto& [roomId, image] : snapshots) {
+        RoomSnapshot snapshot;
+        std::string error;
+        if (!snapshot.load(image, &error)) {
+            std::cerr << "[HANDOFF] Skipping room " << roomId << ": " << error << "\n";
+            continue;
+        }
+        roomFor(roomId).restore(snapshot);
+        ++rooms;
+    }
+    rebuildGlobalBoard();
+    return rooms;
+}
+
+void RoomManager::rejoin(std::shared_ptr<Session> s, const std::string& roomId, const std::string& username) {
+    Room* room;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        room = &roomFor(roomId);
+    }
+    room->join(s, username, false);
+}
+
+void RoomManager::setEventLog(EventLog* log) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_log = log;
+    for (auto& [id, room] : m_rooms) room.setEventLog(log);
+    if (log) log->setSnapshotSource([this](const std::vector<std::string>& rooms) { checkpointRooms(rooms); });
+}
+
+void RoomManager::checkpoint() {
+    if (m_log) checkpointRooms(m_log->dirtyRooms());
+}
+
+void RoomManager::checkpointRooms(const std::vector<std::string>& rooms) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (const std::string& roomId : rooms) {
+        auto it = m_rooms.find(roomId);
+        if (it != m_rooms.end()) it->second.checkpoint();
+    }
+}
+
+void RoomManager::onRoundTimer(const std::string& roomId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_rooms.find(roomId);
+    // The room may have been cleaned up since the deadline was posted
+    if (it != m_rooms.end()) it->second.onRoundTimer();
+}
+
+void RoomManager::onJoinTick(const std::string& roomId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_rooms.find(roomId);
+    if (it != m_rooms.end()) it->second.flushJoins();
+}
+
+Room::Executor RoomManager::executorFor(const std::string& roomId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_rooms.find(roomId);
+    return it != m_rooms.end() ? it->second.executor() : m_strand;
+}
+
+void RoomManager::post(ChatEvent ev) {
+    if (m_server && m_server->cluster() && m_server->cluster()->forward(ev)) return;
+    auto ex = executorFor(ev.room);
+    boost::asio::post(ex, [this, ev = std::move(ev)]() {
+        if (!ev.username.empty()) broadcastChat(ev.room, ev.username + ": " + ev.text);
+        else if (ev.count > 1) broadcastChat(ev.room, ev.text + " \xC3\x97" + std::to_string(ev.count));
+        else broadcastChat(ev.room, ev.text);
+    });
+}
+
+void RoomManager::post(JoinEvent ev) {
+    if (m_server && m_server->cluster() && m_server->cluster()->forward(ev)) return;
+    auto ex = executorFor(ev.room);
+    boost::asio::post(ex, [this, ev = std::move(ev)]() {
+        joinAs(nullptr, ev.room, ev.username, "");
+    });
+}
+
+void RoomManager::post(GuessEvent ev) {
+    if (m_server && m_server->cluster() && m_server->cluster()->forward(ev)) return;
+    auto ex = executorFor(ev.room);
+    boost::asio::post(ex, [this, ev = std::move(ev)]() {
+        handleGuess(ev);
+    });
+}
+
+void RoomManager::handleGuess(const GuessEvent& ev) {
+    // Normalised once per guess into a per-thread buffer
+    thread_local std::string normalized;
+    normalizeGuess(ev.guess, normalized);
+
+    std::string word;
+    GuessResult result = GuessResult::Miss;
+    GameProtocol::Outbox roundMessages;
+    std::vector<GameProtocol::ScoreChange> scored;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_rooms.find(ev.room);
+        if (it != m_rooms.end()) result = it->second.checkGuess(ev.username, normalized, &word, roundMessages, &scored);
+    }
+
+    // Global moves are announced in the room the points were won in
+    if (!scored.empty()) {
+        std::lock_guard<std::mutex> lock(m_globalMutex);
+        for (auto& change : scored) {
+            Leaderboard::Move move = m_globalBoard.add(change.username, change.points);
+            if (move.changed()) {
+                roundMessages.push_back({ Room::rankChangeMessage("global", change.username,
+                    m_globalBoard.score(change.username), move, m_globalBoard.size()), {} });
+            }
+        }
+    }
+
+    // Queued only; the writer's own thread talks to the backend
+    if (m_results) {
+        for (auto& change : scored) m_results->recordScore(change.username, ev.room, change.total);
+        if (result == GuessResult::Exact) m_results->recordGuess(ev.username, ev.room, word, true);
+    }
+
+    if (result == GuessResult::Exact) {
+        MessageBuffer buf;
+        kCorrectGuessMsg.write(buf.str(), ev.room, ev.username, word);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Room& room = roomFor(ev.room);
+        room.broadcast(buf.str());
+        // round_end follows the announcement
+        room.deliver(roundMessages);
+    }
+    else if (result == GuessResult::Close) {
+        MessageBuffer buf;
+        kCloseGuessMsg.write(buf.str(), ev.room, ev.username, ev.guess);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        roomFor(ev.room).broadcast(buf.str(), SendPriority::Chat);
+    }
+    else {
+        broadcastChat(ev.room, ev.username + " guessed: " + ev.guess);
+    }
+}
+
+void RoomManager::handleSetWord(std::shared_ptr<Session> s, const json& j, const std::string& roomId) {
+    if (!s || roomId.empty()) return;
+    std::string word = j.value("payload", "");
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_rooms.find(roomId);
+    // Only someone in the room, and during a game only the drawer, may pick its word
+    if (it == m_rooms.end() || !it->second.setWord(s, word)) {
+        std::cout << "[ROUND] Ignoring set_word for room " << roomId << "\n";
+    }
+}
+
+void RoomManager::handleStartGame(std::shared_ptr<Session> s, const std::string& roomId) {
+    if (!s || roomId.empty()) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_rooms.find(roomId);
+    if (it == m_rooms.end() || !it->second.hasSession(s)) return;
+    std::cout << "[ROUND] Starting game in room " << roomId << "\n";
+    it->second.startGame();
+}
+
+void RoomManager::handleStopGame(std::shared_ptr<Session> s, const std::string& roomId) {
+    if (!s || roomId.empty()) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_rooms.find(roomId);
+    if (it == m_rooms.end() || !it->second.hasSession(s)) return;
+    std::cout << "[ROUND] Stopping game in room " << roomId << "\n";
+    it->second.stopGame();
+}
+
+void RoomManager::handleGetLeaderboard(std::shared_ptr<Session> s, const json& j, const std::string& roomId) {
+    if (!s) return;
+    size_t limit = std::clamp<int64_t>(j.value("limit", 10), 1, 100);
+    std::string username = j.value("username", "");
+
+    json reply;
+    if (j.value("scope", "room") == "global") {
+        std::lock_guard<std::mutex> lock(m_globalMutex);
+        reply = Room::leaderboardJson("global", m_globalBoard, limit, username);
+    }
+    else {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_rooms.find(roomId);
+        if (it == m_rooms.end()) return;
+        reply = it->second.leaderboard(limit, username);
+    }
+    reply["room"] = roomId;
+    s->send(reply.dump());
+}
+
+void RoomManager::handleGetRoster(std::shared_ptr<Session> s, const json& j, const std::string& roomId) {
+    if (!s) return;
+    PlayerTable::Id cursor = j.value("cursor", 1u);
+    size_t limit = std::clamp<int64_t>(j.value("limit", static_cast<int64_t>(Room::kRosterPage)), 1, Room::kRosterPage);
+
+    json reply;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_rooms.find(roomId);
+        if (it == m_rooms.end()) return;
+        reply = { {"type", "roster"}, {"room", roomId}, {"payload", it->second.rosterPage(cursor, limit)} };
+    }
+    s->send(reply.dump());
+}
+
 void RoomManager::joinRoom(const std::string& roomId, std::shared_ptr<Session> s, const std::string& username) {
     std::lock_guard<std::mutex> lock(m_mutex);
-    m_rooms[roomId].join(s, username);
+    roomFor(roomId).join(s, username);
 }
 
 void RoomManager::leaveAll(std::shared_ptr<Session> s) {
@@ -18,12 +343,8 @@ void RoomManager::leaveAll(std::shared_ptr<Session> s) {
         Room& room = pair.second;
 
         if (room.leave(s)) {
-            json sysMsg = {
-                {"type", "system"},
-                {"room", id},
-                {"payload", "Streamer disconnected, lobby cleared"}
-            };
-            room.broadcast(sysMsg.dump());
+            MessageBuffer buf;
+            room.broadcast(kSystemMsg.write(buf.str(), id, "Streamer disconnected, lobby cleared"));
 
             // clear players too if streamer disconnects
             room.resetLobby();
@@ -37,12 +358,6 @@ static std::string normalizeRoom(const std::string& roomId) {
     return roomId;
 }
 void RoomManager::handleJoin(std::shared_ptr<Session> s, const nlohmann::json& j, const std::string& roomId) {
-    // Clean up any abandoned rooms first
-    cleanupAbandonedRooms();
-    
-    // Also clean up expired rooms (inactive for 1+ hours)
-    cleanupExpiredRooms();
-
     std::string username;
 
     // Accept both string and object payloads
@@ -53,28 +368,57 @@ void RoomManager::handleJoin(std::shared_ptr<Session> s, const nlohmann::json& j
         username = j["payload"].value("username", "");
     }
 
+    joinAs(s, roomId, username, j.value("channel", ""), j.value("theme", ""));
+}
+
+bool RoomManager::loadWords(const std::string& path) {
+    std::string error;
+    if (!m_words.open(path, &error)) {
+        std::cerr << "[WORDS] " << error << "\n";
+        return false;
+    }
+    std::cout << "[WORDS] Mapped " << m_words.size() << " words in "
+        << m_words.themeCount() << " themes from " << path << "\n";
+    return true;
+}
+
+void RoomManager::joinAs(std::shared_ptr<Session> s, const std::string& roomId, const std::string& username,
+    const std::string& channel, const std::string& theme) {
+    // Clean up any abandoned rooms first
+    cleanupAbandonedRooms();
+    
+    // Also clean up expired rooms (inactive for 1+ hours)
+    cleanupExpiredRooms();
+
     if (username.empty()) return;
 
+    const ServerLimits* limits = m_server ? &m_server->limits() : nullptr;
+
     Room* room;
     bool isNewRoom = false;
     {
         std::lock_guard<std::mutex> lock(m_mutex);
         auto it = m_rooms.find(roomId);
         if (it == m_rooms.end()) {
+            if (limits && m_rooms.size() >= limits->maxRooms) {
+                std::cout << "[LIMIT] Refusing new room " << roomId << ", room limit reached\n";
+                if (s) s->close(boost::beast::websocket::close_code::try_again_later, "room limit reached");
+                return;
+            }
             // This is a new room being created
             isNewRoom = true;
-            std::cout << "[ROOM] Creating new room: " << roomId << std::endl;
+            if (m_archive && m_archive->contains(roomId))
+                std::cout << "[ROOM] Waking hibernated room: " << roomId << std::endl;
+            else
+                std::cout << "[ROOM] Creating new room: " << roomId << std::endl;
         }
-        room = &m_rooms[roomId];
+        room = &roomFor(roomId);
+        if (isNewRoom && m_words.loaded()) room->setWordSource(m_words, theme);
     }
     
     // If this is a new room, set it as the current room for the Twitch bot
     if (isNewRoom && m_server) {
-        // Extract channel from the join message
-        std::string channel = j.value("channel", "");
         if (!channel.empty()) {
-            // Store the channel this room belongs to
-            m_roomChannels[roomId] = channel;
             std::cout << "[ROOM] Room " << roomId << " belongs to channel " << channel << std::endl;
             
             // Set this as the current room for that channel's Twitch bot
@@ -84,17 +428,17 @@ void RoomManager::handleJoin(std::shared_ptr<Session> s, const nlohmann::json& j
         }
     }
 
-    if (room->hasPlayer(username)) {
-        std::cout << "[SPAM] Duplicate join from " << username << " (replaying state)\n";
-        if (s) {
-            room->join(s, username);     // attach new session
-            room->replayPlayers(s);      // send full player list
-            room->replayHistory(s);      // send all strokes
-        }
+    if (s && limits && !room->hasSession(s) && room->sessionCount() >= limits->maxSessionsPerRoom) {
+        std::cout << "[LIMIT] Room " << roomId << " is full\n";
+        s->close(boost::beast::websocket::close_code::try_again_later, "room full");
         return;
     }
 
-    // First-time join
+    if (room->hasPlayer(username)) {
+        std::cout << "[ROOM] Rejoin from " << username << "\n";
+    }
+
+    // Idempotent: the state goes out once per session, whatever the join count
     room->join(s, username);
 }
 
@@ -105,38 +449,32 @@ void RoomManager::handleLeave(std::shared_ptr<Session> s, const nlohmann::json&
     auto it = m_rooms.find(roomId);
     if (it != m_rooms.end()) {
         Room& room = it->second;
-
-        for (auto& [uname, p] : room.getPlayers()) {
-            if (room.leave(s)) {
-                nlohmann::json leaveMsg = {
-                    {"type", "leave"},
-                    {"payload", {
-                        {"id", p.id},
-                        {"username", uname}
-                    }}
-                };
-                room.broadcast(leaveMsg.dump());
-            }
-        }
+        room.leave(s);
 
         // Clean up abandoned rooms
         if (room.empty()) {
             std::cout << "[ROOM] Room " << roomId << " is empty, removing it" << std::endl;
-            m_rooms.erase(it);
+            dropRoom(it);
         }
     }
 }
 
 
 void RoomManager::handleChat(std::shared_ptr<Session>, const json& j, const std::string& roomId) {
-    std::string payload = j.value("payload", "");
-    if (!roomId.empty() && !payload.empty()) {
-        json chatMsg = { {"type","chat"}, {"room",roomId}, {"payload",payload} };
-        m_rooms[roomId].broadcast(chatMsg.dump());
-    }
+    broadcastChat(roomId, j.value("payload", ""));
+}
+
+void RoomManager::broadcastChat(const std::string& roomId, const std::string& text) {
+    if (roomId.empty() || text.empty()) return;
+    MessageBuffer buf;
+    kChatMsg.write(buf.str(), roomId, text);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    roomFor(roomId).broadcast(buf.str(), SendPriority::Chat);
 }
 
 void RoomManager::handleEndRound(const std::string& roomId) {
+    std::lock_guard<std::mutex> lock(m_mutex);
     auto it = m_rooms.find(roomId);
     if (it != m_rooms.end()) {
         it->second.endRound();
@@ -174,79 +512,72 @@ void RoomManager::handleStatus(const std::string& jsonMsg) {
 }
 
 void RoomManager::handleDraw(std::shared_ptr<Session> s, const json& j, const std::string& roomId) {
-    if (roomId.empty()) return;
-
-    json drawMsg = {
-        {"type", "draw"},
-        {"room", roomId},
-        {"payload", j["payload"]}
-    };
-
-    // store in room history
-    m_rooms[roomId].addStroke(drawMsg);
+    // Only reached when the fast path in onMessage couldn't scan the message
+    if (roomId.empty() || !j.contains("payload")) return;
+    std::string payload = j["payload"].dump();
+    if (!validDrawPayload(payload)) return;
+    handleRawDraw(roomId, payload);
+}
 
-    // broadcast to all
-    m_rooms[roomId].broadcast(drawMsg.dump());
+void RoomManager::handleRawDraw(const std::string& roomId, std::string_view payload) {
+    if (roomId.empty()) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    roomFor(roomId).addDraw(payload);
 }
 
 void RoomManager::handleClear(std::shared_ptr<Session> s, const json& j, const std::string& roomId) {
     if (roomId.empty()) return;
 
-    json clearMsg = {
-        {"type", "clear"},
-        {"room", roomId}
-    };
+    MessageBuffer buf;
+    kClearMsg.write(buf.str(), roomId);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Room& room = roomFor(roomId);
 
     // clear room history
-    m_rooms[roomId].clearHistory();
+    room.clearHistory();
 
     // broadcast clear
-    m_rooms[roomId].broadcast(clearMsg.dump());
+    room.broadcast(buf.str());
 }
 
 void RoomManager::handleRestoreState(std::shared_ptr<Session> s, const std::string& roomId) {
     std::cout << "[DEBUG] handleRestoreState called for room: " << roomId << std::endl;
     if (roomId.empty() || !s) return;
 
+    // Joining already sends this; kept for clients that still ask
+    std::lock_guard<std::mutex> lock(m_mutex);
     auto it = m_rooms.find(roomId);
-    if (it != m_rooms.end()) {
-        const Room& room = it->second;
-
-        // Get data outside of any potential locks
-        std::vector<std::string> playerUsernames;
-        std::vector<json> strokeHistory;
-
-        {
-            std::lock_guard<std::mutex> lock(m_mutex);
-            // Fix: Get the data first, then copy it properly
-            auto usernames = room.getPlayerUsernames();
-            playerUsernames.assign(usernames.begin(), usernames.end());
-            strokeHistory = room.getStrokeHistory();
-        }
-
-        // Send current state back to client
-        json response;
-        response["type"] = "current_state";
-        response["payload"]["players"] = playerUsernames;
-        response["payload"]["strokes"] = strokeHistory;
-
-        std::cout << "[DEBUG] About to send state with " << strokeHistory.size() << " strokes" << std::endl;
-        s->send(response.dump());
-        std::cout << "[STATE] Sent current state to client for room: " << roomId << std::endl;
+    // A hibernated room wakes up for this too
+    if (it == m_rooms.end() && m_archive && m_archive->contains(roomId)) {
+        roomFor(roomId);
+        it = m_rooms.find(roomId);
     }
-    else {
+    if (it == m_rooms.end()) {
         std::cout << "[DEBUG] Room not found: " << roomId << std::endl;
+        return;
     }
+    // Only queues a stream; the canvas is serialised as the socket drains
+    it->second.sendState(s);
+    std::cout << "[STATE] Sent current state to client for room: " << roomId << std::endl;
 }
 
 void RoomManager::cleanupAbandonedRooms() {
     std::lock_guard<std::mutex> lock(m_mutex);
 
+    auto now = std::chrono::steady_clock::now();
     auto it = m_rooms.begin();
     while (it != m_rooms.end()) {
-        if (it->second.empty()) {
+        if (m_archive) {
+            // Nobody here for a while: keep the canvas on disk, not in memory
+            if (it->second.connectedCount() == 0 && now - it->second.getLastActivity() > m_archive->config().idleAfter)
+                it = hibernate(it);
+            else
+                ++it;
+        }
+        else if (it->second.empty()) {
             std::cout << "[ROOM] Cleaning up abandoned room: " << it->first << std::endl;
-            it = m_rooms.erase(it);
+            it = dropRoom(it);
         }
         else {
             ++it;
@@ -267,18 +598,40 @@ void RoomManager::cleanupExpiredRooms() {
             std::cout << "[ROOM] Cleaning up expired room: " << it->first 
                       << " (inactive for " << std::chrono::duration_cast<std::chrono::minutes>(now - lastActivity).count() << " minutes)" << std::endl;
             
-            // Remove from room channels tracking
-            m_roomChannels.erase(it->first);
+            if (m_archive) {
+                it = hibernate(it);
+                continue;
+            }
+            // The channel's chat falls back to its own room
+            if (m_server) m_server->routes().removeRoom(it->first);
             
-            it = m_rooms.erase(it);
+            it = dropRoom(it);
         } else {
             ++it;
         }
     }
+
+    // Hibernated rooms nobody came back to are deleted for good
+    if (!m_archive) return;
+    for (const std::string& roomId : m_archive->expired(std::chrono::system_clock::now())) {
+        std::cout << "[HIBERNATE] Deleting room " << roomId << ", not used for "
+            << m_archive->config().expireAfter.count() << " hours" << std::endl;
+        m_archive->remove(roomId);
+        if (m_log) m_log->remove(roomId);
+        if (m_server) m_server->routes().removeRoom(roomId);
+    }
 }
 
 
 void RoomManager::onMessage(std::shared_ptr<Session> s, const std::string& jsonMsg) {
+    // Draws go straight through as bytes; anything odd takes the slow path
+    DrawEnvelope draw;
+    if (classifyMessage(jsonMsg) == MessageKind::Draw && parseDrawEnvelope(jsonMsg, draw)) {
+        if (validDrawPayload(draw.payload))
+            handleRawDraw(normalizeRoom(std::string(draw.room)), draw.payload);
+        return;
+    }
+
     try {
         auto j = json::parse(jsonMsg);
         std::string type = j.value("type", "");
@@ -295,6 +648,11 @@ void RoomManager::onMessage(std::shared_ptr<Session> s, const std::string& jsonM
         else if (type == "draw")      handleDraw(s, j, roomId);
         else if (type == "clear")     handleClear(s, j, roomId);
         else if (type == "get_state") handleRestoreState(s, roomId);
+        else if (type == "set_word")  handleSetWord(s, j, roomId);
+        else if (type == "start_game") handleStartGame(s, roomId);
+        else if (type == "stop_game") handleStopGame(s, roomId);
+        else if (type == "get_leaderboard") handleGetLeaderboard(s, j, roomId);
+        else if (type == "get_roster") handleGetRoster(s, j, roomId);
         else {
             std::cerr << "[WARN] Unknown type: " << type << " msg=" << jsonMsg << "\n";
         }
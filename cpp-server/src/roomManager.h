@@ -6,40 +6,117 @@
 #include <string>
 #include <nlohmann/json.hpp>
 #include "room.h"
+#include "BotEvents.h"
+#include "WordDictionary.h"
+#include "RoomArchive.h"
 
 class Server;   // forward declare
+class ResultWriter;
 class Session;  // forward declare
 
 class RoomManager {
 public:
-    RoomManager() : m_server(nullptr) {}
+    explicit RoomManager(boost::asio::io_context& io)
+        : m_io(io), m_strand(boost::asio::make_strand(io)), m_scheduler(io), m_sweepTimer(io), m_server(nullptr) {}
     void setServer(Server* server) { m_server = server; }
+    // Scores and correct guesses are queued here for the backend, if set
+    void setResultWriter(ResultWriter* writer) { m_results = writer; }
+    // Rebuilds rooms from what `log` has on disk; call before setEventLog
+    size_t recover(EventLog& log);
+    // Room changes are appended to `log` from now on, if set, and rooms
+    // are snapshotted on its schedule
+    void setEventLog(EventLog* log);
+    // Snapshots every room that changed since its last one (e.g. at shutdown)
+    void checkpoint();
+    // Rooms left idle are evicted to `archive` and brought back when someone
+    // joins or asks for their state; call after recover() and before start()
+    void setArchive(RoomArchive* archive);
+
+    // Handoff to a new process (see Handoff.h): every room as a RoomSnapshot
+    // image, and the rooms and usernames each session is in
+    using Memberships = std::vector<std::pair<std::string, std::string>>; // room, username
+    std::vector<std::pair<std::string, std::string>> snapshots() const;
+    std::unordered_map<std::shared_ptr<Session>, Memberships> memberships() const;
+    // Rebuilds rooms from snapshots() of the old process, like recover()
+    size_t restore(const std::vector<std::pair<std::string, std::string>>& snapshots);
+    // Re-attaches a handed-over session; it already has the room's state
+    void rejoin(std::shared_ptr<Session> s, const std::string& roomId, const std::string& username);
+    // Round timings for rooms created from now on
+    void setRoundConfig(const RoundConfig& cfg) { m_roundConfig = cfg; }
+    void start();
+    // Maps the themed word dictionary new rooms draw from (see WordDictionary)
+    bool loadWords(const std::string& path);
+
+    // Bot events, run on the target room's executor (safe from any thread)
+    void post(ChatEvent ev);
+    void post(JoinEvent ev);
+    void post(GuessEvent ev);
+
     void joinRoom(const std::string& roomId, std::shared_ptr<Session> s, const std::string& username);
     void leaveAll(std::shared_ptr<Session> s);
     void onMessage(std::shared_ptr<Session> s, const std::string& jsonMsg);
 
 private:
     void handleJoin(std::shared_ptr<Session> s, const nlohmann::json& j, const std::string& roomId);
+    void joinAs(std::shared_ptr<Session> s, const std::string& roomId, const std::string& username,
+        const std::string& channel, const std::string& theme = "");
+    void broadcastChat(const std::string& roomId, const std::string& text);
+    void handleGuess(const GuessEvent& ev);
+    void handleSetWord(std::shared_ptr<Session> s, const nlohmann::json& j, const std::string& roomId);
     void handleLeave(std::shared_ptr<Session> s, const nlohmann::json& j, const std::string& roomId);
 
     void handleChat(std::shared_ptr<Session> s, const nlohmann::json& j, const std::string& roomId);
     void handleEndRound(const std::string& roomId);
+    void handleStartGame(std::shared_ptr<Session> s, const std::string& roomId);
+    void handleStopGame(std::shared_ptr<Session> s, const std::string& roomId);
+    void handleGetLeaderboard(std::shared_ptr<Session> s, const nlohmann::json& j, const std::string& roomId);
+    void handleGetRoster(std::shared_ptr<Session> s, const nlohmann::json& j, const std::string& roomId);
+    void onRoundTimer(const std::string& roomId);
+    void onJoinTick(const std::string& roomId);
     void handleStopBot(const nlohmann::json& j);
     void handleSpawnBot(const nlohmann::json& j);
     void handleStatus(const std::string& jsonMsg);
 
 
     void handleDraw(std::shared_ptr<Session> s, const nlohmann::json& j, const std::string& roomId);
+    // `payload` is already validated; its bytes are stored and sent unchanged
+    void handleRawDraw(const std::string& roomId, std::string_view payload);
     void handleClear(std::shared_ptr<Session> s, const nlohmann::json& j, const std::string& roomId);
 
     // NEW: Handle state restoration
     void handleRestoreState(std::shared_ptr<Session> s, const std::string& roomId);
     void cleanupAbandonedRooms(); // NEW: Clean up empty rooms
     void cleanupExpiredRooms(); // NEW: Clean up rooms inactive for 1+ hours
+    void scheduleSweep();       // idle rooms are looked for between joins too
+
+    Room& roomFor(const std::string& roomId); // find or create, caller holds m_mutex
+    // Adds every room's players to the global board; caller holds m_mutex
+    void rebuildGlobalBoard();
+    void checkpointRooms(const std::vector<std::string>& rooms);
+    // Erases a room on purpose, log and all; caller holds m_mutex
+    std::unordered_map<std::string, Room>::iterator dropRoom(std::unordered_map<std::string, Room>::iterator it);
+    // Moves a room to the archive, or leaves it if that fails; caller holds m_mutex
+    std::unordered_map<std::string, Room>::iterator hibernate(std::unordered_map<std::string, Room>::iterator it);
+    // Loads an archived room into `room`, just created; caller holds m_mutex
+    void rehydrate(const std::string& roomId, Room& room);
+    // The room's executor, or the manager's own strand if the room doesn't exist yet
+    Room::Executor executorFor(const std::string& roomId);
+
+    boost::asio::io_context& m_io;
+    Room::Executor m_strand;
+    RoundScheduler m_scheduler; // one timing wheel for every room's rounds, outlives the rooms
+    boost::asio::steady_timer m_sweepTimer;
+    RoundConfig m_roundConfig;
+    WordDictionary m_words; // read-only once loaded, shared by every room
 
     std::unordered_map<std::string, Room> m_rooms;
     std::unordered_map<std::string, std::unordered_set<std::string>> m_joinedUsers;
-    std::unordered_map<std::string, std::string> m_roomChannels; // Track which channel each room belongs to
     mutable std::mutex m_mutex;
+    // Points across every room; own lock so guesses never wait on m_mutex for it
+    Leaderboard m_globalBoard;
+    std::mutex m_globalMutex;
     Server* m_server;
+    ResultWriter* m_results = nullptr;
+    EventLog* m_log = nullptr;
+    RoomArchive* m_archive = nullptr;
 };
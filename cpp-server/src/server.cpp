@@ -1,13 +1,17 @@
 #include "server.h"
 #include "session.h"
 #include "TwitchBotManager.h"
+#include "Handoff.h"
+#include "ClusterNode.h"
 #include <iostream>
 
 Server::Server(boost::asio::io_context& io, int port)
-    : m_acceptor(io, boost::asio::ip::tcp::endpoint(boost::asio::ip::tcp::v4(), port)),
+    : m_port(port),
+    m_acceptor(io),
     m_acceptSocket(io),
-    m_roomManager(),
-    m_botManager(nullptr) {
+    m_roomManager(io),
+    m_botManager(nullptr),
+    m_overload(io, m_limits) {
     m_roomManager.setServer(this);
 }
 
@@ -18,35 +22,93 @@ void Server::setBotManager(TwitchBotManager* botManager) {
 bool Server::spawnBot(const std::string& oauth,
     const std::string& nick,
     const std::string& channel) {
-    if (m_botManager) {
-        return m_botManager->spawnBot(oauth, nick, channel);
+    if (m_cluster) {
+        // Until a room claims the channel, its own name is the room it feeds
+        std::string room = m_routes.find(channel).room;
+        std::string feeds = room.empty() ? channel : room;
+        if (!m_cluster->ownsRoom(feeds)) {
+            m_cluster->command(m_cluster->ownerOf(feeds), { {"type", "spawn_bot"}, {"oauth", oauth}, {"nick", nick}, {"channel", channel}, {"room", room} });
+            return true;
+        }
     }
-    return false;
+    return spawnLocalBot(oauth, nick, channel);
 }
 bool Server::stopBot(const std::string& channel) {
+    if (m_cluster) m_cluster->broadcastCommand({ {"type", "stop_bot"}, {"channel", channel} });
     if (m_botManager) {
-        m_botManager->stopBot(channel);
+        stopLocalBot(channel);
         return true;
     }
     return false;
 }
 
-void Server::setCurrentRoom(const std::string& channel, const std::string& roomName) {
-    if (m_botManager) {
-        m_botManager->setCurrentRoom(channel, roomName);
+bool Server::spawnLocalBot(const std::string& oauth, const std::string& nick, const std::string& channel) {
+    if (!m_botManager || !m_botManager->spawnBot(oauth, nick, channel)) return false;
+    std::lock_guard<std::mutex> lock(m_botAccountsMutex);
+    m_botAccounts[channel] = { oauth, nick };
+    return true;
+}
+
+void Server::stopLocalBot(const std::string& channel) {
+    if (m_botManager) m_botManager->stopBot(channel);
+    std::lock_guard<std::mutex> lock(m_botAccountsMutex);
+    m_botAccounts.erase(channel);
+}
+
+bool Server::takeLocalBot(const std::string& channel, std::string& oauth, std::string& nick) {
+    {
+        std::lock_guard<std::mutex> lock(m_botAccountsMutex);
+        auto it = m_botAccounts.find(channel);
+        if (it == m_botAccounts.end()) return false;
+        oauth = it->second.first;
+        nick = it->second.second;
     }
+    stopLocalBot(channel);
+    return true;
+}
+
+void Server::setCurrentRoom(const std::string& channel, const std::string& roomName) {
+    m_routes.setRoom(channel, roomName);
+    std::cout << "[DEBUG] Set current room for channel " << channel << " to: " << roomName << std::endl;
+    // The room opened here; whichever node runs the channel's bot passes it over
+    if (m_cluster && !m_routes.find(channel).connection)
+        m_cluster->broadcastCommand({ {"type", "claim_bot"}, {"channel", channel}, {"room", roomName} });
 }
 void Server::start() {
+    m_overload.start();
+    m_roomManager.start();
+    if (!m_acceptor.is_open()) {
+        boost::asio::ip::tcp::endpoint endpoint(boost::asio::ip::tcp::v4(), m_port);
+        m_acceptor.open(endpoint.protocol());
+        m_acceptor.set_option(boost::asio::socket_base::reuse_address(true));
+        m_acceptor.bind(endpoint);
+        m_acceptor.listen();
+    }
     doAccept();
 }
 
+bool Server::admitSession() {
+    if (m_overload.level() >= OverloadLevel::ShedChat) return false;
+    std::lock_guard<std::mutex> lock(m_sessionsMutex);
+    return m_sessions.size() < m_limits.maxSessions;
+}
+
 void Server::doAccept() {
     m_acceptor.async_accept(m_acceptSocket,
         [this](boost::system::error_code ec) {
+            // Connections still in the backlog are accepted by the new process
+            if (m_handingOff) return;
             if (!ec) {
                 auto session = std::make_shared<Session>(std::move(m_acceptSocket), *this);
-                addSession(session);
-                session->start();
+                if (admitSession()) {
+                    addSession(session);
+                    session->start();
+                }
+                else {
+                    // Tell the client to back off instead of resetting the TCP connection
+                    m_overload.recordRejected();
+                    session->reject(boost::beast::websocket::close_code::try_again_later, "server busy");
+                }
             }
             doAccept();
         });
@@ -61,6 +123,8 @@ void Server::addSession(std::shared_ptr<Session> session) {
 }
 
 void Server::removeSession(std::shared_ptr<Session> session) {
+    session->markDisconnected();
+    if (m_cluster) m_cluster->clientClosed(session);
     std::lock_guard<std::mutex> lock(m_sessionsMutex);
     if (m_sessions.find(session) != m_sessions.end()) {
         m_sessions.erase(session);
@@ -81,5 +145,67 @@ void Server::onClientMessage(std::shared_ptr<Session> s, const std::string& msg)
         m_roomManager.onMessage(nullptr, msg);
         return;
     }
+    // Rooms owned by another node are played there
+    if (m_cluster && m_cluster->forward(s, msg)) return;
     m_roomManager.onMessage(s, msg);
 }
+
+#ifndef _WIN32
+void Server::beginHandoff() {
+    m_handingOff = true;
+    boost::asio::post(m_acceptor.get_executor(), [this]() { m_acceptor.cancel(); });
+    std::lock_guard<std::mutex> lock(m_sessionsMutex);
+    for (auto& s : m_sessions) s->beginHandoff();
+}
+
+bool Server::handoffDrained() {
+    std::lock_guard<std::mutex> lock(m_sessionsMutex);
+    for (auto& s : m_sessions) {
+        if (!s->writeIdle()) return false;
+    }
+    return true;
+}
+
+void Server::exportHandoff(HandoffState& state) {
+    state.listener = m_acceptor.native_handle();
+    auto memberships = m_roomManager.memberships();
+    {
+        std::lock_guard<std::mutex> lock(m_sessionsMutex);
+        for (auto& s : m_sessions) {
+            // Mid-handshake connections, and any still writing when the drain
+            // timed out, are dropped; their clients reconnect
+            if (!s->established() || !s->writeIdle()) continue;
+            HandoffState::Client client;
+            client.fd = s->nativeHandle();
+            client.queued = s->takeQueued(client.needsState);
+            auto joined = memberships.find(s);
+            if (joined != memberships.end()) client.rooms = std::move(joined->second);
+            state.clients.push_back(std::move(client));
+        }
+    }
+    for (auto& [room, channel] : m_routes.snapshot()->roomChannels) state.routes.emplace_back(room, channel);
+}
+
+void Server::importHandoff(const HandoffState& state) {
+    using boost::asio::ip::tcp;
+    m_acceptor.assign(tcp::v4(), state.listener);
+    for (auto& [room, channel] : state.routes) m_routes.setRoom(channel, room);
+
+    for (auto& client : state.clients) {
+        auto session = std::make_shared<Session>(tcp::socket(m_acceptor.get_executor(), tcp::v4(), client.fd), *this);
+        try {
+            session->adopt(client.queued);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "[HANDOFF] Dropping a connection: " << e.what() << "\n";
+            continue;
+        }
+        addSession(session);
+        for (auto& [room, username] : client.rooms) {
+            // A current_state that never went out is sent again from scratch
+            if (client.needsState) m_roomManager.joinRoom(room, session, username);
+            else m_roomManager.rejoin(session, room, username);
+        }
+    }
+}
+#endif
@@ -1,13 +1,19 @@
 #pragma once
 #include <boost/asio.hpp>
 #include <memory>
+#include <atomic>
 #include <unordered_set>
 #include <mutex>
 #include "session.h"
 #include "roomManager.h"
+#include "RateLimiter.h"
+#include "Overload.h"
+#include "ChannelRouter.h"
 
 // Forward declarations to avoid circular dependency
 class TwitchBotManager; 
+class ClusterNode;
+struct HandoffState;
 
 class Server {
 
@@ -21,20 +27,61 @@ public:
 	void broadcast(std::string msg);
 	void onClientMessage(std::shared_ptr<Session> s, const std::string& msg);
 	void setBotManager(TwitchBotManager* botManager);
+	// Sharded deployment (see ClusterNode.h), if set; before start()
+	void setCluster(ClusterNode* cluster) { m_cluster = cluster; }
+	ClusterNode* cluster() { return m_cluster; }
+	// In a cluster the bot runs on the node that owns its channel's room
 	bool spawnBot(const std::string& oauth,
 		const std::string& nick,
 		const std::string& channel);
 	bool stopBot(const std::string& channel);
+	// This node's bots only
+	bool spawnLocalBot(const std::string& oauth, const std::string& nick, const std::string& channel);
+	void stopLocalBot(const std::string& channel);
+	// Stops the bot if it runs here and returns the account it used
+	bool takeLocalBot(const std::string& channel, std::string& oauth, std::string& nick);
 	void setCurrentRoom(const std::string& channel, const std::string& roomName); // Set current room for specific channel
+	RoomManager& roomManager() { return m_roomManager; }
+	// Channel -> room/bot routes shared by bots and rooms
+	ChannelRouter& routes() { return m_routes; }
+
+	// Ingest limits, set once before start()
+	void setRateLimits(const RateLimitConfig& cfg) { m_rateLimits = cfg; }
+	const RateLimitConfig& rateLimits() const { return m_rateLimits; }
+
+	// Admission limits, set once before start()
+	void setLimits(const ServerLimits& limits) { m_limits = limits; }
+	const ServerLimits& limits() const { return m_limits; }
+	OverloadMonitor& overload() { return m_overload; }
+
+#ifndef _WIN32
+	// Handoff to a new process (see Handoff.h). The old one calls
+	// beginHandoff(), waits for handoffDrained(), stops the io_context and
+	// exports; the new one imports before start() and before running it.
+	void beginHandoff();
+	bool handoffDrained();
+	void exportHandoff(HandoffState& state);
+	void importHandoff(const HandoffState& state);
+#endif
 private:
 	void doAccept();
+	bool admitSession();
 
-	boost::asio::ip::tcp::acceptor m_acceptor;
+	int m_port;
+	boost::asio::ip::tcp::acceptor m_acceptor; // bound in start() unless handed over
 	boost::asio::ip::tcp::socket m_acceptSocket;
+	std::atomic<bool> m_handingOff{ false };
 
 	std::unordered_set<std::shared_ptr<Session>> m_sessions;
 	std::mutex m_sessionsMutex;
 
 	RoomManager m_roomManager;
+	ChannelRouter m_routes;
 	TwitchBotManager* m_botManager;
+	ClusterNode* m_cluster = nullptr;
+	std::mutex m_botAccountsMutex;
+	std::unordered_map<std::string, std::pair<std::string, std::string>> m_botAccounts; // channel -> oauth, nick of bots here
+	RateLimitConfig m_rateLimits;
+	ServerLimits m_limits;
+	OverloadMonitor m_overload;
 };
\ No newline at end of file
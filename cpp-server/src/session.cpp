@@ -1,11 +1,38 @@
 ﻿#include "session.h"
 #include "server.h"
 #include <iostream>
+#include <boost/beast/http.hpp>
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+std::atomic<uint64_t> g_nextSessionId{ 1 };
+}
 
 Session::Session(boost::asio::ip::tcp::socket socket, Server& server)
     : m_ws(std::move(socket)),
+    m_id(g_nextSessionId.fetch_add(1, std::memory_order_relaxed)),
     m_pingTimer(m_ws.get_executor()),
     m_server(server) {
+    m_rateLimiter.configure(server.rateLimits().session);
+}
+
+Session::~Session() {
+    // Whatever never made it to the wire no longer counts as queued
+    int64_t pending = 0;
+    for (auto& msg : m_writeQueue) pending += static_cast<int64_t>(msg.data.size());
+    if (pending) m_server.overload().addQueuedBytes(-pending);
+}
+
+void Session::reject(boost::beast::websocket::close_code code, const std::string& reason) {
+    auto self = shared_from_this();
+    m_ws.async_accept([this, self, code, reason](boost::system::error_code ec) {
+        if (ec) return;
+        m_ws.async_close(boost::beast::websocket::close_reason(code, reason),
+            [self](boost::system::error_code) {});
+    });
 }
 
 
@@ -18,19 +45,87 @@ void Session::start() {
             return;
         }
         std::cout << "Handshake complete!\n";
-        
-        // Set up pong handler before starting ping
-        m_ws.control_callback([this, self](boost::beast::websocket::frame_type kind, boost::string_view payload) {
-            if (kind == boost::beast::websocket::frame_type::pong) {
-                markPongReceived();
-            }
-        });
-        
-        startPing();
-        doRead();
+        onEstablished();
+    });
+}
+
+void Session::onEstablished() {
+    auto self = shared_from_this();
+    m_established = true;
+
+    // Set up pong handler before starting ping
+    m_ws.control_callback([this, self](boost::beast::websocket::frame_type kind, boost::string_view payload) {
+        if (kind == boost::beast::websocket::frame_type::pong) {
+            markPongReceived();
+        }
     });
+
+    startPing();
+    doRead();
+}
+
+void Session::beginHandoff() {
+    m_handingOff = true;
+    // Keep the heartbeat from putting a ping between two messages
+    boost::asio::post(m_ws.get_executor(), [self = shared_from_this()]() { self->m_pingTimer.cancel(); });
+}
+
+bool Session::writeIdle() {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    return !m_writing && !m_pinging;
 }
 
+std::vector<std::string> Session::takeQueued(bool& needsState) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    std::vector<std::string> queued;
+    needsState = false;
+    for (auto& out : m_writeQueue) {
+        if (out.source) needsState = true;
+        else queued.push_back(std::move(out.data));
+    }
+    m_writeQueue.clear();
+    return queued;
+}
+
+#ifndef _WIN32
+void Session::adopt(const std::vector<std::string>& queued) {
+    namespace http = boost::beast::http;
+    using boost::asio::ip::tcp;
+
+    // The client finished its handshake with the old process. Beast still
+    // has to see one, so replay a canned upgrade over a throwaway socket
+    // pair, then put the real connection underneath the open stream.
+    tcp::socket real = std::move(m_ws.next_layer());
+    int pair[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0)
+        throw std::runtime_error("socketpair failed");
+    m_ws.next_layer() = tcp::socket(m_ws.get_executor(), tcp::v4(), pair[0]);
+
+    http::request<http::empty_body> upgrade{ http::verb::get, "/", 11 };
+    upgrade.set(http::field::host, "localhost");
+    upgrade.set(http::field::upgrade, "websocket");
+    upgrade.set(http::field::connection, "Upgrade");
+    upgrade.set(http::field::sec_websocket_key, "dGhlIHNhbXBsZSBub25jZQ==");
+    upgrade.set(http::field::sec_websocket_version, "13");
+    boost::system::error_code ec;
+    m_ws.accept(upgrade, ec);
+    ::close(pair[1]);
+    if (ec) throw boost::system::system_error(ec);
+    m_ws.next_layer() = std::move(real);
+
+    OverloadMonitor& overload = m_server.overload();
+    for (auto& msg : queued) {
+        m_writeQueue.push_back({ msg, nullptr });
+        overload.addQueuedBytes(static_cast<int64_t>(msg.size()));
+    }
+    onEstablished();
+    if (!m_writeQueue.empty()) {
+        m_writing = true;
+        doWrite();
+    }
+}
+#endif
+
 void Session::doRead() {
     auto self = shared_from_this();
     m_ws.async_read(m_buffer, [this, self](boost::system::error_code ec, std::size_t bytes) {
@@ -39,10 +134,22 @@ void Session::doRead() {
             m_server.removeSession(self);
             return;
         }
-        std::string msg(boost::asio::buffer_cast<const char*>(m_buffer.data()), bytes);
+        std::string_view raw(boost::asio::buffer_cast<const char*>(m_buffer.data()), bytes);
+
+        // Drop over-budget messages before paying for a JSON parse
+        MessageKind kind = classifyMessage(raw);
+        if (!m_rateLimiter.allow(kind)) {
+            RateLimitStats::recordThrottled(RateLimitStats::Scope::Session, kind);
+            m_buffer.consume(bytes);
+            if (!m_handingOff) doRead();
+            return;
+        }
+
+        std::string msg(raw);
         m_buffer.consume(bytes);
         handleMessage(msg);
-        doRead();
+        // What the client sends next stays in the kernel for the new process
+        if (!m_handingOff) doRead();
         });
 }
 
@@ -51,12 +158,50 @@ void Session::handleMessage(const std::string& msg) {
     m_server.onClientMessage(shared_from_this(), msg);
 }
 
-void Session::send(const std::string& msg) {
+void Session::send(const std::string& msg, SendPriority priority) {
+    OverloadMonitor& overload = m_server.overload();
+    if (overload.shouldShed(priority)) {
+        overload.recordShed(priority);
+        return;
+    }
+    if (m_remote.send) {
+        // Rooms keep dropped stand-ins; their client id may belong to someone new
+        if (connected()) m_remote.send(msg, priority);
+        return;
+    }
+
     auto self = shared_from_this();
     {
         std::lock_guard<std::mutex> lock(m_writeMutex);
-        m_writeQueue.push_back(msg);
-        if (m_writing) return;
+        m_writeQueue.push_back({ msg, nullptr });
+        overload.addQueuedBytes(static_cast<int64_t>(msg.size()));
+        // Held for the new process during a handoff
+        if (m_writing || m_handingOff) return;
+        m_writing = true;
+    }
+    doWrite();
+}
+
+void Session::sendStream(FrameSource source, SendPriority priority) {
+    OverloadMonitor& overload = m_server.overload();
+    if (overload.shouldShed(priority)) {
+        overload.recordShed(priority);
+        return;
+    }
+    if (m_remote.send) {
+        if (!connected()) return;
+        // Goes over the bus as one message; the client's node streams nothing
+        std::string whole;
+        while (source(whole)) {}
+        m_remote.send(whole, priority);
+        return;
+    }
+
+    auto self = shared_from_this();
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        m_writeQueue.push_back({ {}, std::move(source) });
+        if (m_writing || m_handingOff) return;
         m_writing = true;
     }
     doWrite();
@@ -64,26 +209,55 @@ void Session::send(const std::string& msg) {
 
 void Session::doWrite() {
     auto self = shared_from_this();
-    std::string& msg = m_writeQueue.front();
+    Outgoing& out = m_writeQueue.front();
+
+    if (!out.source) {
+        m_ws.async_write(boost::asio::buffer(out.data), [this, self](boost::system::error_code ec, std::size_t) {
+            std::lock_guard<std::mutex> lock(m_writeMutex);
+            if (ec) {
+                std::cerr << "Send error: " << ec.message() << "\n";
+                m_server.removeSession(self);
+                return;
+            }
+            m_server.overload().addQueuedBytes(-static_cast<int64_t>(m_writeQueue.front().data.size()));
+            m_writeQueue.pop_front();
+            if (!m_writeQueue.empty() && !m_handingOff)
+                doWrite();
+            else
+                m_writing = false;
+            });
+        return;
+    }
 
-    m_ws.async_write(boost::asio::buffer(msg), [this, self](boost::system::error_code ec, std::size_t) {
+    // Streamed message: nothing else may go out until its last fragment has
+    out.data.clear();
+    bool more = out.source(out.data);
+    m_server.overload().addQueuedBytes(static_cast<int64_t>(out.data.size()));
+    m_ws.async_write_some(!more, boost::asio::buffer(out.data), [this, self, more](boost::system::error_code ec, std::size_t) {
         std::lock_guard<std::mutex> lock(m_writeMutex);
         if (ec) {
             std::cerr << "Send error: " << ec.message() << "\n";
             m_server.removeSession(self);
             return;
         }
-        m_writeQueue.pop_front();
-        if (!m_writeQueue.empty())
+        m_server.overload().addQueuedBytes(-static_cast<int64_t>(m_writeQueue.front().data.size()));
+        if (!more) m_writeQueue.pop_front();
+        // A stream is finished even during a handoff, so no message is cut
+        if (!m_writeQueue.empty() && (more || !m_handingOff))
             doWrite();
         else
             m_writing = false;
         });
 }
 
-void Session::close() {
+void Session::close(boost::beast::websocket::close_code code, const std::string& reason) {
+    if (m_remote.close) {
+        if (connected()) m_remote.close(code, reason);
+        markDisconnected();
+        return;
+    }
     auto self = shared_from_this();
-    m_ws.async_close(boost::beast::websocket::close_code::normal, [this, self](boost::system::error_code ec) {
+    m_ws.async_close(boost::beast::websocket::close_reason(code, reason), [this, self](boost::system::error_code ec) {
         if (ec)
             std::cerr << "Close error: " << ec.message() << "\n";
         m_server.removeSession(self);
@@ -103,8 +277,10 @@ void Session::startPing() {
             m_pongReceived = false;
 
             // Send ping only if connection is still open
-            if (m_ws.is_open()) {
+            if (m_ws.is_open() && !m_handingOff) {
+                m_pinging = true;
                 m_ws.async_ping({}, [this, self](boost::system::error_code ec) {
+                    m_pinging = false;
                     if (ec) {
                         std::cerr << "Ping error: " << ec.message() << "\n";
                         close();
@@ -3,40 +3,102 @@
 #include <boost/beast/core.hpp>
 #include <boost/beast/websocket.hpp>
 #include <deque>
+#include <functional>
 #include <mutex>
 #include <string>
 #include <memory>
+#include <vector>
+#include <atomic>
 #include "session.h"
 #include "server.h"
+#include "RateLimiter.h"
+#include "Overload.h"
 #include <iostream>
 
 class Server; // forward declaration
 
+// Where a stand-in session's output goes when its client is connected to
+// another node (see ClusterNode.h)
+struct RemoteLink {
+    std::function<void(const std::string& msg, SendPriority priority)> send;
+    std::function<void(boost::beast::websocket::close_code code, const std::string& reason)> close;
+};
+
 class Session : public std::enable_shared_from_this<Session> {
 public:
     Session(boost::asio::ip::tcp::socket socket, Server& server);
+    ~Session();
 
     void start();
-    void send(const std::string& msg);
-    void close();
+    // Completes the WebSocket handshake only to close it with `code`
+    void reject(boost::beast::websocket::close_code code, const std::string& reason);
+    void send(const std::string& msg, SendPriority priority = SendPriority::Critical);
+
+    // Produces one long text message a piece at a time: appends the next
+    // chunk to `chunk` and returns false once that was the last one
+    using FrameSource = std::function<bool(std::string& chunk)>;
+    static constexpr size_t kStreamChunk = 64 * 1024;
+    // Sent as a fragmented message, one chunk per frame, so only a chunk is
+    // ever buffered. It is produced lazily when it reaches the queue head.
+    void sendStream(FrameSource source, SendPriority priority = SendPriority::Critical);
+    void close(boost::beast::websocket::close_code code = boost::beast::websocket::close_code::normal,
+        const std::string& reason = "");
     void startPing();
     void markPongReceived();
+    // False once the server has dropped the connection; rooms may still hold it
+    bool connected() const { return !m_disconnected.load(std::memory_order_relaxed); }
+    void markDisconnected() { m_disconnected.store(true, std::memory_order_relaxed); }
+    // Unique within this process, never reused
+    uint64_t id() const { return m_id; }
+    // Turns this into a stand-in for a client on another node: everything
+    // sent or closed goes through `link`, and the socket is never used
+    void makeRemote(RemoteLink link) { m_remote = std::move(link); }
+    bool remote() const { return static_cast<bool>(m_remote.send); }
+
+    // Handoff to a new process (see Handoff.h). After beginHandoff() the
+    // session stops reading and stops writing at the next message boundary;
+    // once writeIdle() the socket can move without cutting a frame in half.
+    void beginHandoff();
+    bool writeIdle();
+    bool established() const { return m_established; }
+    boost::asio::ip::tcp::socket::native_handle_type nativeHandle() { return m_ws.next_layer().native_handle(); }
+    // Whole messages still queued; `needsState` is set if a streamed
+    // current_state was among them (it is rebuilt, not carried over)
+    std::vector<std::string> takeQueued(bool& needsState);
+#ifndef _WIN32
+    // Picks up a connection whose handshake the old process completed, and
+    // queues what it had not sent yet. Call before the io_context runs.
+    void adopt(const std::vector<std::string>& queued);
+#endif
 
 private:
     void doRead();
     void doWrite();
     void handleMessage(const std::string& msg);
+    void onEstablished();
 
 
     boost::beast::websocket::stream<boost::asio::ip::tcp::socket> m_ws;
     boost::beast::flat_buffer m_buffer;
 
-    std::deque<std::string> m_writeQueue;
+    struct Outgoing {
+        std::string data;     // whole message, or the current chunk of a stream
+        FrameSource source;   // set for streamed messages
+    };
+    std::deque<Outgoing> m_writeQueue;
     bool m_writing = false;
     std::mutex m_writeMutex;
+    bool m_established = false;              // handshake done
+    std::atomic<bool> m_handingOff{ false };
+    std::atomic<bool> m_pinging{ false };    // a ping frame is being written
+    std::atomic<bool> m_disconnected{ false };
+    uint64_t m_id;
+    RemoteLink m_remote;
 
     boost::asio::steady_timer m_pingTimer;
     bool m_pongReceived = true;
 
+    SessionRateLimiter m_rateLimiter; // only touched from the read loop
+
     Server& m_server;
 };
\ No newline at end of file
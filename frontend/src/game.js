@@ -80,6 +80,7 @@ function setupEventListeners() {
     
     // Clear player list
     state.players.clear();
+    state.playerTotal = 0;
     
     // Clear stroke history
     if (typeof setAllStrokes === 'function') {
@@ -239,15 +240,21 @@ async function getWordByTheme(theme) {
 }
 
 // Function to start a new round with theme-based word
-async function startNewRound() {
+export async function startNewRound() {
     const params = new URLSearchParams(window.location.search);
     const theme = params.get('theme');
     if (theme) {
         const word = await getWordByTheme(theme);
         if (word) {
             console.log(`[GAME] Starting round with ${theme} theme word: ${word}`);
-            // Here you would integrate with your C++ server to start the round
-            // For now, just log the word
+            // Tell the C++ server which word chat is guessing
+            if (state.ws) {
+                state.ws.send(JSON.stringify({
+                    type: "set_word",
+                    room: params.get('room'),
+                    payload: word
+                }));
+            }
         }
     }
 }
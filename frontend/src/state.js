@@ -1,5 +1,8 @@
 export default {
   user: null,
   ws: null,
-  players: new Set()
+  players: new Map(), // id -> username, the first few hundred only
+  playerTotal: 0,
+  // Top of each board, kept current from rank_change deltas
+  leaderboard: { room: [], global: [] }
 };
\ No newline at end of file
@@ -8,4 +8,8 @@ export function renderPlayers() {
     li.textContent = p;
     ul.appendChild(li);
   });
+
+  const total = Math.max(state.playerTotal, state.players.size);
+  const count = document.getElementById("playerCount");
+  if (count) count.textContent = `${total} player${total === 1 ? "" : "s"}`;
 }
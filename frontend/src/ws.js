@@ -1,6 +1,9 @@
 import state from "./state.js";
 import { renderPlayers } from "./ui/gameUI.js";
 import { replayStroke, clearCanvas, setAllStrokes, clearAllState } from "./drawing.js";
+import { startNewRound } from "./game.js";
+
+let roundTimer = null;
 
 export function connectWebSocket(user) {
   // Get the actual room code from URL parameters
@@ -42,18 +45,21 @@ export function connectWebSocket(user) {
         type: "join",
         room: roomCode,
         channel: user.username, // Include channel info
+        theme: params.get('theme') || "", // words the server picks from
         payload: user.username
       }));
       console.log("join sent!");
-      
-      setTimeout(() => {
-        console.log("About to send get_state...");
-        ws.send(JSON.stringify({
-          type: "get_state",
-          room: roomCode
-        }));
-        console.log("get_state sent!");
-      }, 200);
+      // The join answers with current_state (roster and canvas) by itself
+
+      // Seed the boards once; rank_change keeps them current
+      ["room", "global"].forEach(scope => {
+        ws.send(JSON.stringify({ type: "get_leaderboard", room: roomCode, scope, username: user.username }));
+      });
+
+      // The streamer's room runs rounds on the server
+      if (params.get('type') === 'create') {
+        ws.send(JSON.stringify({ type: "start_game", room: roomCode }));
+      }
     }, 100);
   };
 
@@ -108,35 +114,24 @@ export function connectWebSocket(user) {
 }
 
 function handleServerMessage(msg) {
-  if (msg.type === "join") {
-    console.log("[DEBUG] Join message received:", msg);
-    console.log("[DEBUG] Full payload:", msg.payload);
-    
-    // Handle both payload formats: direct username or {username: "..."}
-    let username;
-    if (typeof msg.payload === 'string') {
-      // Direct username string (from C++ bot)
-      username = msg.payload;
-    } else if (msg.payload && msg.payload.username) {
-      // Object with username property
-      username = msg.payload.username;
-    }
-    
-    console.log("[DEBUG] Extracted username:", username);
-    
-    if (username) {
-      state.players.add(username);
-      renderPlayers();
-      console.log("[DEBUG] Added player:", username, "Total players:", state.players.size);
-    } else {
-      console.log("[ERROR] Could not extract username from join message");
-    }
+  if (msg.type === "roster") {
+    applyRoster(msg.payload);
+  }
+
+  // Joins arrive batched per server tick with a sample of the names
+  else if (msg.type === "players_joined") {
+    console.log(`[ROSTER] ${msg.payload.count} players joined, ${msg.payload.total} total`);
+    state.playerTotal = msg.payload.total;
+    msg.payload.players.forEach(p => {
+      if (state.players.size < ROSTER_VISIBLE) state.players.set(p.id, p.username);
+    });
+    renderPlayers();
   }
 
   else if (msg.type === "leave") {
-    const { username } = msg.payload;
-    if (username) {
-      state.players.delete(username);
+    const { id } = msg.payload;
+    if (id !== undefined) {
+      state.players.delete(id);
       renderPlayers();
     }
   }
@@ -156,7 +151,56 @@ function handleServerMessage(msg) {
   else if (msg.type === "system") {
     console.log("[SYSTEM]", msg.payload);
   }
+
+  else if (msg.type === "correct_guess") {
+    console.log("[GUESS] Correct:", msg.payload.username, "guessed", msg.payload.word);
+    showError(`${msg.payload.username} guessed the word: ${msg.payload.word}!`, "success");
+  }
+
+  else if (msg.type === "close_guess") {
+    console.log("[GUESS] Close:", msg.payload.username, msg.payload.guess);
+  }
+
+  else if (msg.type === "round_choose") {
+    console.log("[ROUND]", msg.payload.round, "drawer:", msg.payload.drawer);
+    startCountdown(msg.payload.ms);
+    // Our turn: pick a themed word before the server picks one for us
+    if (state.user && msg.payload.drawer === state.user.username) {
+      startNewRound();
+    }
+  }
+
+  else if (msg.type === "round_word") {
+    showError(`Your word: ${msg.payload.word}`, "success");
+  }
+
+  else if (msg.type === "round_start" || msg.type === "round_hint") {
+    console.log("[ROUND] Hint:", msg.payload.hint);
+    startCountdown(msg.payload.ms);
+  }
+
+  else if (msg.type === "round_end") {
+    console.log("[ROUND] End:", msg.payload);
+    if (msg.payload && msg.payload.word) {
+      const who = msg.payload.winner ? `${msg.payload.winner} got it` : "Nobody got it";
+      showError(`${who}! The word was ${msg.payload.word}`, msg.payload.winner ? "success" : "error");
+    }
+    startCountdown(msg.payload && msg.payload.ms ? msg.payload.ms : 0);
+  }
   
+  else if (msg.type === "leaderboard") {
+    state.leaderboard[msg.payload.scope] = msg.payload.entries;
+    console.log(`[RANK] ${msg.payload.scope} top:`, msg.payload.entries);
+  }
+
+  else if (msg.type === "rank_change") {
+    applyRankChange(msg.payload);
+    if (state.user && msg.payload.username === state.user.username) {
+      const where = msg.payload.scope === "global" ? " overall" : "";
+      showError(`You moved to #${msg.payload.rank}${where}!`, "success");
+    }
+  }
+
   // Handle state response - now uses instant drawing
   else if (msg.type === "current_state") {
     console.log("[CURRENT STATE]", msg.payload);
@@ -164,12 +208,9 @@ function handleServerMessage(msg) {
     console.log("[DEBUG] Strokes count:", msg.payload.strokes ? msg.payload.strokes.length : 0);
     
     // Restore players
-    if (msg.payload.players) {
+    if (msg.payload.roster) {
       state.players.clear();
-      msg.payload.players.forEach(player => {
-        state.players.add(player);
-      });
-      renderPlayers();
+      applyRoster(msg.payload.roster);
     }
     
     // Restore drawing strokes INSTANTLY
@@ -183,6 +224,56 @@ function handleServerMessage(msg) {
   }
 }
 
+// Big lobbies list only the first names; the count shows the rest
+const ROSTER_VISIBLE = 200;
+
+// One page of players; more pages are fetched only while the list has room
+function applyRoster({ total, next, players }) {
+  state.playerTotal = total;
+  players.forEach(p => {
+    if (state.players.size < ROSTER_VISIBLE) state.players.set(p.id, p.username);
+  });
+  renderPlayers();
+
+  if (next && state.players.size < ROSTER_VISIBLE && state.ws && state.ws.readyState === WebSocket.OPEN) {
+    const room = new URLSearchParams(window.location.search).get('room');
+    state.ws.send(JSON.stringify({ type: "get_roster", room, cursor: next }));
+  }
+}
+
+// Only the mover is sent; everyone between their old and new place drops one
+function applyRankChange({ scope, username, score, rank, previous }) {
+  const board = state.leaderboard[scope];
+  if (!board) return;
+  const limit = Math.max(board.length, 10);
+  const others = board.filter(e => e.username !== username);
+  others.forEach(e => {
+    if (e.rank >= rank && (previous === 0 || e.rank < previous)) e.rank += 1;
+  });
+  others.push({ rank, username, score });
+  others.sort((a, b) => a.rank - b.rank);
+  state.leaderboard[scope] = others.slice(0, limit);
+}
+
+// Counts the round timer down locally from the server's remaining time
+function startCountdown(ms) {
+  const timerEl = document.getElementById("gameTimer");
+  if (!timerEl) return;
+  if (roundTimer) clearInterval(roundTimer);
+
+  const endsAt = Date.now() + ms;
+  const render = () => {
+    const left = Math.max(0, Math.ceil((endsAt - Date.now()) / 1000));
+    timerEl.textContent = `⏱️ ${Math.floor(left / 60)}:${String(left % 60).padStart(2, "0")}`;
+    if (left === 0 && roundTimer) {
+      clearInterval(roundTimer);
+      roundTimer = null;
+    }
+  };
+  render();
+  roundTimer = setInterval(render, 250);
+}
+
 // Reconnection function
 function reconnectWebSocket(user) {
   console.log("[WS] Attempting to reconnect...");